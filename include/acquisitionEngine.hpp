@@ -0,0 +1,352 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file acquisitionEngine.hpp
+ *   \brief Dedicated acquisition thread feeding decoded marker frames to a
+ *   lock-free ring.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "fiducialStore.hpp"
+#include "frameAccounting.hpp"
+#include "framePool.hpp"
+#include "frameRecorder.hpp"
+#include "frameSource.hpp"
+#include "imageCapture.hpp"
+#include "latencyHistogram.hpp"
+#include "poseStore.hpp"
+#include "reservationTuner.hpp"
+#include "spscRing.hpp"
+
+#include <ftkInterface.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+/** \brief Class running ftkGetLastFrame on its own thread.
+ *
+ * Frames are read from a FrameSource: a live device by default, or e.g. a
+ * ReplayFrameSource to run the pipeline without camera.
+ *
+ * The engine owns the ftkFrameQuery instances, drains the device as fast as
+ * it delivers frames and pushes the decoded markers, as PoseStore, in a
+ * fixed-capacity lock-free ring. Consumers pop frames from any \e single other thread,
+ * without locks nor allocations. When the consumer is too slow, new frames
+ * are dropped and counted instead of delaying the device I/O.
+ *
+ * When Settings::PublishedFrames is not zero, the complete frame queries are
+ * also handed to the consumer through a FramePool: the device fills frame
+ * k+1 while frame k is still being processed. If the consumer holds all the
+ * published frames, the engine keeps acquiring in a private frame and only
+ * the decoded markers are delivered. An ImageCapture gets the frame queries
+ * the same way, Settings::CapturedFrames of them, instead of copies of their
+ * images; those frames are not published.
+ *
+ * When FrameOptions::ThreeDFiducialsSize is not zero, the triangulated
+ * fiducials of every frame are decoded as well, into FiducialStore, and
+ * pushed in a second ring with its own consumer calls, e.g. frontFiducials().
+ * The fiducial stream is independent of the marker one: frames with a marker
+ * overflow still deliver their fiducials, and a slow fiducial consumer only
+ * drops fiducial frames.
+ *
+ * With Settings::AdaptiveReservations, the reservations of the frame queries
+ * follow the demand, see ReservationTuner: they start from Settings::Options
+ * and a frame query is set up again with the new reservations just before
+ * its next ftkGetLastFrame call, on the acquisition thread.
+ *
+ * \code
+ * AcquisitionEngine engine( lib, sn );
+ * if ( engine.start() )
+ * {
+ *     const PoseStore* frame( engine.front() );
+ *     if ( frame != nullptr )
+ *     {
+ *         // ...
+ *         engine.popFront();
+ *     }
+ *     engine.stop();
+ * }
+ * \endcode
+ */
+class AcquisitionEngine
+{
+public:
+
+    /** \brief Number of frames the ring can hold.
+    */
+    static const uint32 RING_CAPACITY = 256u;
+
+    /** \brief Number of fiducial frames the fiducial ring can hold.
+    */
+    static const uint32 FIDUCIAL_RING_CAPACITY = 64u;
+
+    /** \brief Acquisition parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor, sets the values used by the samples.
+        */
+        Settings()
+            : TimeoutMS( 100u )
+            , PublishedFrames( 0u )
+            , CapturedFrames( 0u )
+            , Core( -1 )
+            , LostFramesPeriodMS( 1000u )
+            , LostFramesOptionId( 0u )
+            , AdaptiveReservations( false )
+        {}
+
+        /** \brief Timeout given to ftkGetLastFrame, in milliseconds.
+        */
+        uint32 TimeoutMS;
+
+        /** \brief Reservations of every frame query.
+        */
+        FrameOptions Options;
+
+        /** \brief Number of frame queries which can be handed to the
+        * consumer, at most FramePool::MAX_FRAMES - 1.
+        */
+        uint32 PublishedFrames;
+
+        /** \brief Number of frame queries which can be held by the image
+        * capture while their images are compressed, PublishedFrames +
+        * CapturedFrames being at most FramePool::MAX_FRAMES - 1.
+        */
+        uint32 CapturedFrames;
+
+        /** \brief Core the acquisition thread is pinned to, -1 to let the
+        * scheduler move it.
+        */
+        int32 Core;
+
+        /** \brief Period at which the device lost frames counter is read,
+        * in milliseconds, 0 to never read it.
+        */
+        uint32 LostFramesPeriodMS;
+
+        /** \brief ID of the read-only device option counting the lost
+        * frames, 0 when it is not known: FrameAccountingSnapshot::DeviceLostFrames
+        * then stays 0 and the gaps of the frame counter are the only measure
+        * of the frames lost by the device.
+        */
+        uint32 LostFramesOptionId;
+
+        /** \brief Whether the reservations of the frame queries follow the
+        * demand, Options being the initial ones.
+        */
+        bool AdaptiveReservations;
+
+        /** \brief Parameters of the adaptive reservations, the caps are
+        * lowered to the PoseStore and FiducialStore capacities.
+        */
+        ReservationTuner::Settings Reservations;
+    };
+
+    /** \brief Constructor acquiring from a live device, does not start the
+    * thread.
+    *
+    * \param[in] lib initialised library handle.
+    * \param[in] sn serial number of the device to acquire from.
+    * \param[in] settings acquisition parameters.
+    */
+    AcquisitionEngine( ftkLibrary lib, uint64 sn, const Settings& settings = Settings() );
+
+    /** \brief Constructor acquiring from any frame source, does not start the
+    * thread.
+    *
+    * \param[in] source frame source, must outlive the engine.
+    * \param[in] settings acquisition parameters.
+    */
+    explicit AcquisitionEngine( FrameSource& source, const Settings& settings = Settings() );
+
+    /** \brief Destructor, stops the thread.
+    */
+    ~AcquisitionEngine();
+
+    AcquisitionEngine( const AcquisitionEngine& ) = delete;
+    AcquisitionEngine& operator=( const AcquisitionEngine& ) = delete;
+
+    /** \brief Creates the frame queries and starts the acquisition thread.
+    *
+    * \retval true if the thread is running,
+    * \retval false if the frame queries could not be created or set up.
+    */
+    bool start();
+
+    /** \brief Stops and joins the acquisition thread.
+    *
+    * Frames obtained from acquireFrame() must have been released, as the
+    * frame queries are deleted; the ones held by the image capture are
+    * waited for, see ImageCapture::flush().
+    */
+    void stop();
+
+    /** \brief Getter for the state of the acquisition thread.
+    */
+    bool isRunning() const;
+
+    /** \brief Consumer side, gives access to the oldest acquired frame.
+    *
+    * \return a pointer on the frame, \c nullptr if no frame is pending.
+    */
+    const PoseStore* front();
+
+    /** \brief Consumer side, releases the frame obtained from front().
+    */
+    void popFront();
+
+    /** \brief Consumer side, copies the oldest acquired frame.
+    *
+    * \param[out] frame where the frame is copied.
+    *
+    * \retval true if a frame was popped,
+    * \retval false if no frame is pending.
+    */
+    bool tryPop( PoseStore& frame );
+
+    /** \brief Fiducial consumer side, gives access to the oldest decoded
+    * fiducials.
+    *
+    * \return a pointer on the fiducials, \c nullptr if none are pending or
+    * if FrameOptions::ThreeDFiducialsSize is zero.
+    */
+    const FiducialStore* frontFiducials();
+
+    /** \brief Fiducial consumer side, releases the fiducials obtained from
+    * frontFiducials().
+    */
+    void popFrontFiducials();
+
+    /** \brief Fiducial consumer side, copies the oldest decoded fiducials.
+    *
+    * \param[out] fiducials where the fiducials are copied.
+    *
+    * \retval true if fiducials were popped,
+    * \retval false if none are pending.
+    */
+    bool tryPopFiducials( FiducialStore& fiducials );
+
+    /** \brief Consumer side, gets the oldest published frame query.
+    *
+    * The frame belongs to the consumer until releaseFrame() is called.
+    * Published frames carry the same counter as the corresponding
+    * PoseStore.
+    *
+    * \return the index of the frame, FramePool::INVALID_INDEX if none is
+    * pending or if Settings::PublishedFrames is zero.
+    */
+    uint32 acquireFrame();
+
+    /** \brief Consumer side, getter for a published frame query.
+    *
+    * \param[in] index index returned by acquireFrame().
+    */
+    const ftkFrameQuery* frame( uint32 index ) const;
+
+    /** \brief Consumer side, gives a published frame query back.
+    *
+    * \param[in] index index returned by acquireFrame().
+    */
+    void releaseFrame( uint32 index );
+
+    /** \brief Sets the recorder every acquired frame is given to.
+    *
+    * The recorder is called from the acquisition thread, it can be set or
+    * removed while the engine is running.
+    *
+    * \param[in] recorder opened recorder, \c nullptr to stop recording.
+    */
+    void setRecorder( FrameRecorder* recorder );
+
+    /** \brief Sets the image capture the frame queries are given to.
+    *
+    * The capture is called from the acquisition thread, it can be set or
+    * removed while the engine is running; a capture removed while running
+    * must be closed before stop() is called, as it may still hold frames.
+    * Settings::Options::Pixels must be set; Settings::CapturedFrames adds
+    * frames to the pool for the capture, which otherwise takes the
+    * published ones.
+    *
+    * \param[in] capture opened capture, \c nullptr to stop capturing.
+    */
+    void setImageCapture( ImageCapture* capture );
+
+    /** \brief Getter for the number of frames pushed in the ring.
+    */
+    uint64 acquiredFrames() const;
+
+    /** \brief Getter for the number of frames dropped because the ring was
+    * full.
+    */
+    uint64 droppedFrames() const;
+
+    /** \brief Getter for the number of fiducial frames dropped because the
+    * fiducial ring was full.
+    */
+    uint64 droppedFiducialFrames() const;
+
+    /** \brief Getter for the number of times the adaptive reservations
+    * changed.
+    */
+    uint64 reservationChanges() const;
+
+    /** \brief Getter for the counters of lost, skipped and failed frames.
+    */
+    const FrameAccounting& accounting() const;
+
+    /** \brief Getter for the last error returned by ftkGetLastFrame.
+    */
+    ftkError lastError() const;
+
+    /** \brief Getter for the marker status of the last frame not delivered
+    * because its marker query was not valid, e.g.
+    * ftkQueryStatus::QS_ERR_INVALID_RESERVED_SIZE.
+    *
+    * \return the status, ftkQueryStatus::QS_OK if every frame was valid.
+    */
+    ftkQueryStatus skippedStatus() const;
+
+    /** \brief Getter for the per-stage latencies of the acquired frames.
+    *
+    * The Consumer and EndToEnd stages end when the consumer calls
+    * popFront() or tryPop().
+    */
+    LatencyStats& latency();
+
+private:
+    AcquisitionEngine( std::unique_ptr< DeviceFrameSource > device, const Settings& settings );
+    void run();
+
+    std::unique_ptr< DeviceFrameSource > _DeviceSource;
+    FrameSource* _Source;
+    Settings _Settings;
+    FramePool _Pool;
+    uint32 _ScratchIndex;
+
+    /** Frame held by the acquisition thread when it stopped. */
+    uint32 _HeldIndex;
+
+    /** Whether the source lost frames counter is read. */
+    bool _ReadLostFrames;
+    SpscRing< uint32, FramePool::MAX_FRAMES > _Published;
+    std::thread _Thread;
+    std::atomic< bool > _Running;
+    std::atomic< uint64 > _Acquired;
+    std::atomic< int32 > _LastError;
+    std::atomic< int32 > _SkippedStatus;
+    std::atomic< FrameRecorder* > _Recorder;
+    std::atomic< ImageCapture* > _ImageCapture;
+    std::atomic< uint64 > _FiducialDrops;
+    std::atomic< uint64 > _ReservationChanges;
+    ReservationTuner _Tuner;
+    FrameAccounting _Accounting;
+    LatencyStats _Latency;
+    SpscRing< PoseStore, RING_CAPACITY > _Ring;
+    SpscRing< FiducialStore, FIDUCIAL_RING_CAPACITY > _Fiducials;
+};
@@ -0,0 +1,94 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file fiducialStore.hpp
+ *   \brief Struct-of-arrays storage of the 3D fiducials of one frame.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "poseStore.hpp"
+
+#include <ftkInterface.h>
+
+/** \brief Maximum number of 3D fiducials kept for one frame.
+ */
+#define MAX_TRACKED_FIDUCIALS 64u
+
+/** \brief Triangulated fiducials of one frame, stored attribute by
+ * attribute.
+ *
+ * This is the raw input of the marker matching, for consumers doing their
+ * own matching or studying the triangulation quality. Like PoseStore, the
+ * store is filled once per frame from the ftkFrameQuery: fiducial \c i has
+ * its position in \c positionMM[ 0..2 ][ i ], its errors in
+ * \c epipolarErrorPixels[ i ] and \c triangulationErrorMM[ i ], and the
+ * indices of its left and right raw data in \c leftIndex[ i ] and
+ * \c rightIndex[ i ]. Every array starts on a cache line.
+ *
+ * \code
+ * FiducialStore store;
+ * store.fill( *frame );
+ * const float32 tipMM[ 3u ] = { 0.0f, 0.0f, 1000.0f };
+ * int32 i( store.nearest( tipMM, 5.0f ) );
+ * if ( i >= 0 )
+ * {
+ *     float32 p( store.probability[ i ] );
+ * }
+ * \endcode
+ */
+struct alignas( POSE_STORE_ALIGNMENT ) FiducialStore
+{
+    /** \brief Device timestamp of the frame, in microseconds.
+    */
+    uint64 timestampUS;
+
+    /** \brief Device counter of the frame.
+    */
+    uint32 counter;
+
+    /** \brief Status of the 3D fiducials query of the frame.
+    */
+    ftkQueryStatus fiducialsStat;
+
+    /** \brief Number of valid entries in the arrays.
+    */
+    uint32 count;
+
+    /** \brief Host time ftkGetLastFrame returned this frame, see
+    * latencyClockNS(), 0 if unknown.
+    */
+    int64 receivedNS;
+
+    alignas( POSE_STORE_ALIGNMENT ) float32 positionMM[ 3u ][ MAX_TRACKED_FIDUCIALS ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 epipolarErrorPixels[ MAX_TRACKED_FIDUCIALS ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 triangulationErrorMM[ MAX_TRACKED_FIDUCIALS ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 probability[ MAX_TRACKED_FIDUCIALS ];
+    alignas( POSE_STORE_ALIGNMENT ) uint32 leftIndex[ MAX_TRACKED_FIDUCIALS ];
+    alignas( POSE_STORE_ALIGNMENT ) uint32 rightIndex[ MAX_TRACKED_FIDUCIALS ];
+
+    /** \brief Empties the store and resets the frame metadata.
+    */
+    void clear();
+
+    /** \brief Fills the store from a frame query.
+    *
+    * Fiducials beyond MAX_TRACKED_FIDUCIALS are ignored.
+    *
+    * \param[in] frame frame query filled by ftkGetLastFrame.
+    */
+    void fill( const ftkFrameQuery& frame );
+
+    /** \brief Looks for the fiducial closest to a point.
+    *
+    * \param[in] pointMM point to look around.
+    * \param[in] maxDistanceMM largest accepted distance.
+    *
+    * \return the index of the fiducial, -1 if none is within
+    * \c maxDistanceMM.
+    */
+    int32 nearest( const float32 pointMM[ 3u ], float32 maxDistanceMM ) const;
+};
@@ -0,0 +1,195 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file frameAccounting.hpp
+ *   \brief Counters of lost, skipped and failed frames of one device.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkInterface.h>
+
+#include <atomic>
+
+/** \brief Values of the FrameAccounting counters at a given time.
+ */
+struct FrameAccountingSnapshot
+{
+    /** \brief Default constructor, all counters are zero.
+    */
+    FrameAccountingSnapshot()
+        : TimeNS( 0 )
+        , Frames( 0u )
+        , CounterGaps( 0u )
+        , MissedFrames( 0u )
+        , DeviceLostFrames( 0u )
+        , Timeouts( 0u )
+        , Errors( 0u )
+        , Overflows( 0u )
+        , SkippedQueries( 0u )
+        , RingDrops( 0u )
+    {}
+
+    /** \brief Time of the snapshot, see latencyClockNS().
+    */
+    int64 TimeNS;
+
+    /** \brief Frames returned by ftkGetLastFrame.
+    */
+    uint64 Frames;
+
+    /** \brief Number of times the frame counter did not increase by one.
+    */
+    uint64 CounterGaps;
+
+    /** \brief Frames missing from the frame counter sequence.
+    */
+    uint64 MissedFrames;
+
+    /** \brief Lost frames reported by the device, 0 if it does not report
+    * them.
+    */
+    uint64 DeviceLostFrames;
+
+    /** \brief ftkGetLastFrame calls returning ftkError::FTK_WAR_NO_FRAME.
+    */
+    uint64 Timeouts;
+
+    /** \brief ftkGetLastFrame calls returning an error.
+    */
+    uint64 Errors;
+
+    /** \brief Frames whose markers status is ftkQueryStatus::QS_ERR_OVERFLOW.
+    */
+    uint64 Overflows;
+
+    /** \brief Frames ignored because of their markers status, e.g.
+    * ftkQueryStatus::QS_WAR_SKIPPED.
+    */
+    uint64 SkippedQueries;
+
+    /** \brief Frames dropped because the consumer ring was full.
+    */
+    uint64 RingDrops;
+};
+
+/** \brief Per-second rates between two FrameAccountingSnapshot.
+ */
+struct FrameAccountingRates
+{
+    /** \brief Default constructor, all rates are zero.
+    */
+    FrameAccountingRates()
+        : Frames( 0.0 )
+        , MissedFrames( 0.0 )
+        , DeviceLostFrames( 0.0 )
+        , Timeouts( 0.0 )
+        , Errors( 0.0 )
+        , Overflows( 0.0 )
+        , SkippedQueries( 0.0 )
+        , RingDrops( 0.0 )
+    {}
+
+    float64 Frames;
+    float64 MissedFrames;
+    float64 DeviceLostFrames;
+    float64 Timeouts;
+    float64 Errors;
+    float64 Overflows;
+    float64 SkippedQueries;
+    float64 RingDrops;
+};
+
+/** \brief Counters of the acquisition thread of one device.
+ *
+ * The counters are written by the acquisition thread only and may be read
+ * from any thread; nothing is parsed from the console output.
+ *
+ * \code
+ * FrameAccountingSnapshot previous( engine.accounting().snapshot() );
+ * // one second later
+ * FrameAccountingSnapshot current( engine.accounting().snapshot() );
+ * FrameAccountingRates rates( FrameAccounting::rates( previous, current ) );
+ * \endcode
+ */
+class FrameAccounting
+{
+public:
+
+    /** \brief Default constructor, all counters are zero.
+    */
+    FrameAccounting();
+
+    FrameAccounting( const FrameAccounting& ) = delete;
+    FrameAccounting& operator=( const FrameAccounting& ) = delete;
+
+    /** \brief Acquisition thread, counts a frame and the gap in the device
+    * counter since the previous one.
+    *
+    * \param[in] frame frame returned by ftkGetLastFrame, gaps are only
+    * detected when its image header is retrieved.
+    */
+    void onFrame( const ftkFrameQuery& frame );
+
+    /** \brief Acquisition thread, counts an ftkGetLastFrame call which did
+    * not return a frame.
+    *
+    * \param[in] err error returned by ftkGetLastFrame.
+    */
+    void onNoFrame( ftkError err );
+
+    /** \brief Acquisition thread, counts a frame from its markers status.
+    *
+    * \param[in] status markers status of the frame.
+    *
+    * \retval true if the markers can be used,
+    * \retval false if the frame is skipped.
+    */
+    bool onMarkersStatus( ftkQueryStatus status );
+
+    /** \brief Acquisition thread, counts a frame dropped because the
+    * consumer was too slow.
+    */
+    void onRingDrop();
+
+    /** \brief Acquisition thread, sets the device lost frames counter.
+    */
+    void setDeviceLostFrames( uint64 count );
+
+    /** \brief Getter for the number of frames dropped because the consumer
+    * was too slow.
+    */
+    uint64 ringDrops() const;
+
+    /** \brief Reads all the counters.
+    */
+    FrameAccountingSnapshot snapshot() const;
+
+    /** \brief Writes the rates since a previous snapshot through the Logger.
+    *
+    * \param[in] sn serial number of the device.
+    * \param[in,out] previous previous snapshot, replaced by the current one.
+    */
+    void log( uint64 sn, FrameAccountingSnapshot& previous ) const;
+
+    /** \brief Computes the per-second rates between two snapshots.
+    */
+    static FrameAccountingRates rates( const FrameAccountingSnapshot& previous,
+                                       const FrameAccountingSnapshot& current );
+
+private:
+    std::atomic< uint64 > _Frames;
+    std::atomic< uint64 > _CounterGaps;
+    std::atomic< uint64 > _MissedFrames;
+    std::atomic< uint64 > _DeviceLostFrames;
+    std::atomic< uint64 > _Timeouts;
+    std::atomic< uint64 > _Errors;
+    std::atomic< uint64 > _Overflows;
+    std::atomic< uint64 > _SkippedQueries;
+    std::atomic< uint64 > _RingDrops;
+    uint32 _LastCounter;
+    bool _HasCounter;
+};
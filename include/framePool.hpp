@@ -0,0 +1,175 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file framePool.hpp
+ *   \brief Preallocated pool of ftkFrameQuery instances.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "mpscRing.hpp"
+
+#include <ftkInterface.h>
+
+/** \brief Reservations given to ftkSetFrameOptions, in the same order.
+ */
+struct FrameOptions
+{
+    /** \brief Default constructor, sets the reservations used by the samples.
+    */
+    FrameOptions()
+        : Pixels( false )
+        , EventsSize( 0u )
+        , LeftRawDataSize( 16u )
+        , RightRawDataSize( 16u )
+        , ThreeDFiducialsSize( 0u )
+        , MarkersSize( 16u )
+    {}
+
+    /** \brief Compares all the reservations.
+    */
+    bool operator==( const FrameOptions& other ) const
+    {
+        return Pixels == other.Pixels && EventsSize == other.EventsSize &&
+               LeftRawDataSize == other.LeftRawDataSize && RightRawDataSize == other.RightRawDataSize &&
+               ThreeDFiducialsSize == other.ThreeDFiducialsSize && MarkersSize == other.MarkersSize;
+    }
+
+    /** \brief Compares all the reservations.
+    */
+    bool operator!=( const FrameOptions& other ) const
+    {
+        return !( *this == other );
+    }
+
+    bool Pixels;
+    uint32 EventsSize;
+    uint32 LeftRawDataSize;
+    uint32 RightRawDataSize;
+    uint32 ThreeDFiducialsSize;
+    uint32 MarkersSize;
+};
+
+/** \brief Applies the reservations to a frame query.
+ *
+ * \param[in] options reservations to apply.
+ * \param[in,out] frame frame query to set up.
+ *
+ * \return the value returned by ftkSetFrameOptions.
+ */
+ftkError setFrameOptions( const FrameOptions& options, ftkFrameQuery* frame );
+
+/** \brief Class holding N frame queries created once at startup.
+ *
+ * All frames are created with identical reservations, which can later be
+ * changed frame by frame with setOptions(). They are handed out
+ * and back by index: one thread acquire()s free frames, the threads
+ * processing them release() them, e.g. the consumer and the image capture
+ * workers. The free list is a lock-free ring, so there is no allocation nor
+ * lock in steady state.
+ *
+ * \code
+ * FramePool pool;
+ * if ( pool.create( 4u, FrameOptions() ) )
+ * {
+ *     uint32 index( pool.acquire() );
+ *     if ( index != FramePool::INVALID_INDEX )
+ *     {
+ *         ftkGetLastFrame( lib, sn, pool.frame( index ), 100u );
+ *         // ... hand the index to the consumer, which calls
+ *         pool.release( index );
+ *     }
+ * }
+ * \endcode
+ */
+class FramePool
+{
+public:
+
+    /** \brief Maximum number of frames in a pool.
+    */
+    static const uint32 MAX_FRAMES = 16u;
+
+    /** \brief Value returned by acquire() when no frame is available.
+    */
+    static const uint32 INVALID_INDEX = 0xFFFFFFFFu;
+
+    /** \brief Default constructor, the pool is empty.
+    */
+    FramePool();
+
+    /** \brief Destructor, deletes the frames.
+    */
+    ~FramePool();
+
+    FramePool( const FramePool& ) = delete;
+    FramePool& operator=( const FramePool& ) = delete;
+
+    /** \brief Creates the frames, must be called before any acquire().
+    *
+    * \param[in] count number of frames, at most MAX_FRAMES.
+    * \param[in] options reservations applied to every frame.
+    *
+    * \retval true if all frames could be created,
+    * \retval false otherwise, the pool is then left empty.
+    */
+    bool create( uint32 count, const FrameOptions& options );
+
+    /** \brief Deletes the frames, no frame may be in use.
+    */
+    void destroy();
+
+    /** \brief Gets a free frame, to be called from a single thread.
+    *
+    * \return the index of the frame, INVALID_INDEX if all are in use.
+    */
+    uint32 acquire();
+
+    /** \brief Gives a frame back, can be called from any thread.
+    *
+    * \param[in] index index previously returned by acquire().
+    */
+    void release( uint32 index );
+
+    /** \brief Getter for a frame.
+    *
+    * \param[in] index index previously returned by acquire().
+    */
+    ftkFrameQuery* frame( uint32 index ) const;
+
+    /** \brief Getter for the number of frames.
+    */
+    uint32 size() const;
+
+    /** \brief Getter for the reservations used at creation.
+    */
+    const FrameOptions& options() const;
+
+    /** \brief Getter for the current reservations of a frame.
+    *
+    * \param[in] index index of the frame, less than size().
+    */
+    const FrameOptions& options( uint32 index ) const;
+
+    /** \brief Changes the reservations of a frame, which must not be in use
+    * by another thread.
+    *
+    * \param[in] index index of the frame, less than size().
+    * \param[in] options new reservations.
+    *
+    * \retval true if the reservations were applied,
+    * \retval false if ftkSetFrameOptions failed, the frame keeps its
+    * previous reservations as far as the SDK allows.
+    */
+    bool setOptions( uint32 index, const FrameOptions& options );
+
+private:
+    ftkFrameQuery* _Frames[ MAX_FRAMES ];
+    FrameOptions _FrameOptions[ MAX_FRAMES ];
+    uint32 _Count;
+    FrameOptions _Options;
+    MpscRing< uint32, MAX_FRAMES > _Free;
+};
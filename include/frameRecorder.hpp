@@ -0,0 +1,151 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file frameRecorder.hpp
+ *   \brief Background recording of the acquired frames to disk.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "poseStore.hpp"
+#include "recordingFormat.hpp"
+#include "spscRing.hpp"
+
+#include <ftkInterface.h>
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** \brief Maximum number of 3D fiducials recorded for one frame.
+ */
+#define MAX_RECORDED_FIDUCIALS 128u
+
+/** \brief Class streaming every recorded frame to a file, see
+ * recordingFormat.hpp for the layout.
+ *
+ * record() only copies the markers and fiducials of the frame in a
+ * preallocated lock-free ring, it is meant to be called from the
+ * acquisition thread. A background thread packs the frames in large chunks
+ * and writes each chunk with a single unbuffered write, then appends the
+ * index and the footer on close(). If the disk cannot keep up, frames are
+ * dropped and counted instead of blocking the acquisition.
+ *
+ * \code
+ * FrameRecorder recorder;
+ * if ( recorder.open( "session.stkrec", sn ) )
+ * {
+ *     engine.setRecorder( &recorder );
+ *     // ...
+ *     engine.stop();
+ *     recorder.close();
+ * }
+ * \endcode
+ */
+class FrameRecorder
+{
+public:
+
+    /** \brief Number of frames waiting to be written the ring can hold.
+    */
+    static const uint32 RING_CAPACITY = 512u;
+
+    /** \brief Default size of the write chunks, in bytes.
+    */
+    static const uint32 DEFAULT_CHUNK_SIZE = 4u * 1024u * 1024u;
+
+    /** \brief Default constructor, no file is opened.
+    */
+    FrameRecorder();
+
+    /** \brief Destructor, closes the recording.
+    */
+    ~FrameRecorder();
+
+    FrameRecorder( const FrameRecorder& ) = delete;
+    FrameRecorder& operator=( const FrameRecorder& ) = delete;
+
+    /** \brief Creates the recording file and starts the writer thread.
+    *
+    * \param[in] path path of the file, overwritten if it exists.
+    * \param[in] sn serial number of the recorded device, stored in the
+    * header.
+    * \param[in] chunkSize size of the write chunks, in bytes.
+    *
+    * \retval true if the recording is started,
+    * \retval false if the file could not be created.
+    */
+    bool open( const std::string& path, uint64 sn, uint32 chunkSize = DEFAULT_CHUNK_SIZE );
+
+    /** \brief Writes the pending frames, the index and the footer, then
+    * closes the file.
+    *
+    * \retval true if the recording is complete,
+    * \retval false if a write failed.
+    */
+    bool close();
+
+    /** \brief Getter for the state of the recording.
+    */
+    bool isOpen() const;
+
+    /** \brief Queues a frame for writing, to be called from a single thread.
+    *
+    * Markers beyond MAX_TRACKED_MARKERS and fiducials beyond
+    * MAX_RECORDED_FIDUCIALS are not recorded.
+    *
+    * \param[in] frame frame query filled by ftkGetLastFrame.
+    *
+    * \retval true if the frame is queued,
+    * \retval false if the recording is closed or the ring is full.
+    */
+    bool record( const ftkFrameQuery& frame );
+
+    /** \brief Getter for the number of frames written to the file.
+    */
+    uint64 recordedFrames() const;
+
+    /** \brief Getter for the number of frames dropped because the ring was
+    * full.
+    */
+    uint64 droppedFrames() const;
+
+    /** \brief Getter for the number of bytes written to the file.
+    */
+    uint64 writtenBytes() const;
+
+private:
+    struct Slot
+    {
+        RecordedFrame frame;
+        RecordedMarker markers[ MAX_TRACKED_MARKERS ];
+        RecordedFiducial fiducials[ MAX_RECORDED_FIDUCIALS ];
+    };
+
+    RecordingHeader makeHeader() const;
+    void run();
+    void append( const Slot& slot );
+    void append( const void* data, uint32 size );
+    void flush();
+
+    FILE* _File;
+    uint64 _SerialNumber;
+    uint64 _StartTimestampUS;
+    std::vector< char > _Chunk;
+    uint32 _ChunkUsed;
+    uint64 _Offset;
+    std::vector< RecordingIndexEntry > _Index;
+    bool _Failed;
+    std::thread _Thread;
+    std::atomic< bool > _Running;
+    std::atomic< uint64 > _Recorded;
+    std::atomic< uint64 > _Dropped;
+    std::atomic< uint64 > _Written;
+    std::unique_ptr< SpscRing< Slot, RING_CAPACITY > > _Ring;
+};
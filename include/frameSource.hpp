@@ -0,0 +1,171 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file frameSource.hpp
+ *   \brief Abstraction of where the acquired frames come from.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "recordingReader.hpp"
+
+#include <ftkInterface.h>
+
+#include <chrono>
+#include <string>
+
+/** \brief Interface of the frame providers used by AcquisitionEngine.
+ *
+ * The semantic of getLastFrame() is the one of ::ftkGetLastFrame: it blocks
+ * at most \c timeoutMS milliseconds and fills the given frame query within
+ * its reservations.
+ */
+class FrameSource
+{
+public:
+
+    /** \brief Destructor, does nothing fancy.
+    */
+    virtual ~FrameSource()
+    {}
+
+    /** \brief Fills a frame query with the next frame.
+    *
+    * \param[in,out] frame frame query, created with ftkCreateFrame.
+    * \param[in] timeoutMS maximum waiting time, in milliseconds.
+    *
+    * \return the same codes as ::ftkGetLastFrame.
+    */
+    virtual ftkError getLastFrame( ftkFrameQuery* frame, uint32 timeoutMS ) = 0;
+
+    /** \brief Getter for the serial number of the device providing the
+    * frames.
+    */
+    virtual uint64 serialNumber() const = 0;
+
+    /** \brief Turns the counting of the lost frames on, must be called
+    * before lostFrames().
+    *
+    * \param[in] optionId ID of the read-only option counting the lost frames.
+    *
+    * \retval true if lostFrames() can be called,
+    * \retval false if the source does not report lost frames.
+    */
+    virtual bool enableLostFrames( uint32 /* optionId */ )
+    {
+        return false;
+    }
+
+    /** \brief Reads the number of frames lost by the device.
+    *
+    * \param[out] count lost frames since the device started.
+    *
+    * \retval true if \c count was read,
+    * \retval false if the source does not report lost frames.
+    */
+    virtual bool lostFrames( uint64& /* count */ )
+    {
+        return false;
+    }
+};
+
+/** \brief Frame source reading a live device through ::ftkGetLastFrame.
+ */
+class DeviceFrameSource : public FrameSource
+{
+public:
+
+    /** \brief Constructor.
+    *
+    * \param[in] lib initialised library handle.
+    * \param[in] sn serial number of the device.
+    */
+    DeviceFrameSource( ftkLibrary lib, uint64 sn );
+
+    ftkError getLastFrame( ftkFrameQuery* frame, uint32 timeoutMS ) override;
+
+    uint64 serialNumber() const override;
+
+    /** \brief Turns the copy of the lost frames counter on, as the SDK
+    * samples do with OPTION_ID_COPY_LOST_FRAMES, then checks the counter can
+    * be read.
+    *
+    * A warning is logged if it cannot, so that no loss is not assumed.
+    */
+    bool enableLostFrames( uint32 optionId ) override;
+
+    /** \brief Reads the option given to enableLostFrames(), with a single
+    * ::ftkGetInt32 call.
+    */
+    bool lostFrames( uint64& count ) override;
+
+private:
+    ftkLibrary _Library;
+    uint64 _SerialNumber;
+    uint32 _LostFramesId;
+};
+
+/** \brief Frame source playing back a recording written by FrameRecorder.
+ *
+ * Frames are served at their original timing, at a multiple of it, or as
+ * fast as the consumer asks for them. The frame queries must have been
+ * created with ftkCreateFrame and ftkSetFrameOptions, as for a live device;
+ * markers and fiducials exceeding the reservations are truncated and the
+ * corresponding status is set to ftkQueryStatus::QS_ERR_OVERFLOW.
+ *
+ * \code
+ * ReplayFrameSource replay;
+ * if ( replay.open( "session.stkrec", 4.0 ) )
+ * {
+ *     AcquisitionEngine engine( replay );
+ *     engine.start();
+ *     // ...
+ * }
+ * \endcode
+ */
+class ReplayFrameSource : public FrameSource
+{
+public:
+
+    /** \brief Default constructor, no recording is opened.
+    */
+    ReplayFrameSource();
+
+    /** \brief Opens a recording.
+    *
+    * \param[in] path path of the recording.
+    * \param[in] speed playback speed, 1 for the original timing, 2 for twice
+    * as fast, 0 or less for as fast as possible.
+    * \param[in] loop setting to \c true to restart at the end of the
+    * recording.
+    *
+    * \retval true if the recording could be opened,
+    * \retval false otherwise.
+    */
+    bool open( const std::string& path, float64 speed = 1.0, bool loop = false );
+
+    /** \brief Getter for the end of the playback.
+    *
+    * \retval true if all frames were served and looping is disabled,
+    * \retval false otherwise.
+    */
+    bool finished() const;
+
+    ftkError getLastFrame( ftkFrameQuery* frame, uint32 timeoutMS ) override;
+
+    uint64 serialNumber() const override;
+
+private:
+    void restart();
+    void fill( const RecordedFrame& recorded, ftkFrameQuery* frame ) const;
+
+    RecordingReader _Reader;
+    float64 _Speed;
+    bool _Loop;
+    uint64 _Next;
+    uint64 _FirstTimestampUS;
+    std::chrono::steady_clock::time_point _Start;
+};
@@ -0,0 +1,151 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file geometryCache.hpp
+ *   \brief On-disk cache of parsed geometries, keyed by file contents.
+ *
+ *   A cache file is made of one GeometryCacheHeader followed by
+ *   GeometryCacheHeader::count GeometryCacheEntry, sorted by hash. It is
+ *   mapped read-only and searched in place.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "mappedFile.hpp"
+
+#include <ftkInterface.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** \brief Magic value starting a geometry cache, "STKGEO" followed by 0x00
+ * 0x01.
+ */
+#define GEOMETRY_CACHE_MAGIC 0x01004f45474b5453uLL
+
+/** \brief Current version of the geometry cache layout.
+ */
+#define GEOMETRY_CACHE_VERSION 1u
+
+/** \brief Cache file header, at offset 0.
+ */
+struct GeometryCacheHeader
+{
+    uint64 magic;
+    uint32 version;
+
+    /** \brief sizeof( GeometryCacheEntry ) when the cache was written, a
+    * cache written with another SDK layout is ignored.
+    */
+    uint32 entrySize;
+    uint64 count;
+    uint64 reserved;
+};
+
+/** \brief One parsed geometry.
+ */
+struct GeometryCacheEntry
+{
+    /** \brief Hash of the geometry file contents, see GeometryCache::hash.
+    */
+    uint64 hash;
+
+    /** \brief Size of the geometry file, in bytes.
+    */
+    uint64 fileSize;
+    ftkRigidBody body;
+};
+
+/** \brief Class caching the result of ftkLoadRigidBodyFromFile.
+ *
+ * A geometry is found again only if the file has exactly the same contents,
+ * so an edited file simply misses and is parsed again. find() and insert()
+ * may be called concurrently; new entries are written by save(), which
+ * replaces the file atomically so that a crash never leaves a truncated
+ * cache.
+ *
+ * \code
+ * GeometryCache cache;
+ * cache.open( "geometries.cache" );
+ * ftkRigidBody body{};
+ * if ( !cache.find( GeometryCache::hash( data, size ), size, body ) )
+ * {
+ *     // parse, then cache.insert( ... );
+ * }
+ * cache.save();
+ * \endcode
+ */
+class GeometryCache
+{
+public:
+
+    /** \brief Default constructor, the cache is empty.
+    */
+    GeometryCache();
+
+    GeometryCache( const GeometryCache& ) = delete;
+    GeometryCache& operator=( const GeometryCache& ) = delete;
+
+    /** \brief Maps a cache file.
+    *
+    * A missing, corrupted or outdated file is not an error: the cache is
+    * then empty and the file is rewritten by save().
+    *
+    * \param[in] path path of the cache file.
+    *
+    * \retval true if cached geometries were found,
+    * \retval false if the cache is empty.
+    */
+    bool open( const std::string& path );
+
+    /** \brief Looks for a parsed geometry.
+    *
+    * \param[in] hash hash of the geometry file contents.
+    * \param[in] fileSize size of the geometry file.
+    * \param[out] body where the geometry is copied.
+    *
+    * \retval true if the geometry is cached,
+    * \retval false otherwise.
+    */
+    bool find( uint64 hash, uint64 fileSize, ftkRigidBody& body ) const;
+
+    /** \brief Adds a parsed geometry, kept in memory until save().
+    *
+    * \param[in] hash hash of the geometry file contents.
+    * \param[in] fileSize size of the geometry file.
+    * \param[in] body parsed geometry.
+    */
+    void insert( uint64 hash, uint64 fileSize, const ftkRigidBody& body );
+
+    /** \brief Getter for the presence of entries not saved yet.
+    */
+    bool isDirty() const;
+
+    /** \brief Writes all entries to the cache file and maps it again.
+    *
+    * \retval true if the file was written or nothing had to be written,
+    * \retval false if the file could not be written.
+    */
+    bool save();
+
+    /** \brief Hash of a geometry file contents, 64 bits FNV-1a.
+    *
+    * \param[in] data file contents.
+    * \param[in] size size of the contents, in bytes.
+    */
+    static uint64 hash( const void* data, uint64 size );
+
+private:
+    const GeometryCacheEntry* mapped( uint64 hash, uint64 fileSize ) const;
+
+    std::string _Path;
+    MappedFile _File;
+    const GeometryCacheEntry* _Entries;
+    uint64 _Count;
+    mutable std::mutex _Lock;
+    std::vector< GeometryCacheEntry > _Pending;
+};
@@ -23,9 +23,47 @@ struct ftkBuffer;
 struct ftkGeometry;
 struct ftkRigidBody;
 
+class MappedFile;
+
+/** \brief Helper function locating a geometry file.
+ *
+ * The file is looked for as given, then in the library data directory. The
+ * result is memoized per file name, so each file is looked for on disk only
+ * once; this function can be called from several threads.
+ *
+ * \param[in] lib initialised library handle.
+ * \param[in] fileName name of the file.
+ * \param[out] fullFilePath path of the file.
+ * \param[out] fromSystem set to \c true if the file is in the data
+ * directory.
+ *
+ * \retval true if the file was found,
+ * \retval false otherwise.
+ */
 bool getFullFilePath( ftkLibrary lib, const std::string& fileName, std::string& fullFilePath,
                       bool* fromSystem = nullptr );
 
+/** \brief Helper function mapping a geometry file read-only.
+ *
+ * Files which would not fit in ftkBuffer::data are rejected before anything
+ * is read.
+ *
+ * \param[in] fullFilePath path of the file.
+ * \param[out] file mapping of the file.
+ *
+ * \retval true if the file is mapped,
+ * \retval false if it cannot be mapped or is too large.
+ */
+bool mapGeometryFile( const std::string& fullFilePath, MappedFile& file );
+
+/** \brief Helper function copying a geometry file in a buffer.
+ *
+ * \param[in] fullFilePath path of the file.
+ * \param[out] buffer buffer to fill.
+ *
+ * \retval true if the buffer holds the file,
+ * \retval false if it cannot be read or does not fit in the buffer.
+ */
 bool loadFileInBuffer( const std::string& fullFilePath, ftkBuffer& buffer );
 
 /** \brief Helper function loading a geometry.
@@ -0,0 +1,215 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file geometryRegistry.hpp
+ *   \brief Parallel loading of a set of geometry files.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "geometryCache.hpp"
+
+#include <ftkInterface.h>
+
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** \brief Immutable table of rigid bodies, sorted by geometry ID.
+ *
+ * Instances are built by GeometryRegistry and shared as
+ * <tt>std::shared_ptr< const GeometryTable ></tt>, so that any thread can keep
+ * using a table while a new one is loaded.
+ */
+class GeometryTable
+{
+public:
+
+    /** \brief Looks for a rigid body.
+    *
+    * \param[in] geometryId ID of the geometry.
+    *
+    * \return a pointer on the rigid body, \c nullptr if none has this ID.
+    */
+    const ftkRigidBody* find( uint32 geometryId ) const;
+
+    /** \brief Getter for the number of rigid bodies.
+    */
+    uint32 size() const;
+
+    /** \brief Getter for a rigid body, by increasing geometry ID.
+    *
+    * \param[in] index index of the body, less than size().
+    */
+    const ftkRigidBody& operator[]( uint32 index ) const;
+
+private:
+    friend class GeometryRegistry;
+
+    std::vector< ftkRigidBody > _Bodies;
+};
+
+/** \brief Outcome of the loading of one geometry file.
+ */
+struct GeometryLoadReport
+{
+    /** \brief Default constructor, the file is not loaded.
+    */
+    GeometryLoadReport()
+        : GeometryId( 0u )
+        , Status( 2 )
+        , Cached( false )
+        , ResolveUS( 0.0 )
+        , ReadUS( 0.0 )
+        , ParseUS( 0.0 )
+    {}
+
+    /** \brief Name of the file, as given to the registry.
+    */
+    std::string FileName;
+
+    /** \brief Path the file was read from, empty if it was not found.
+    */
+    std::string FullPath;
+
+    /** \brief ID of the loaded geometry.
+    */
+    uint32 GeometryId;
+
+    /** \brief Same codes as loadRigidBody: 0 if loaded, 1 if loaded from the
+    * data directory, 2 if not loaded.
+    */
+    int32 Status;
+
+    /** \brief Whether the geometry came from the GeometryCache instead of
+    * being parsed.
+    */
+    bool Cached;
+
+    /** \brief Description of the failure, empty if the file was loaded.
+    */
+    std::string Error;
+
+    /** \brief Time spent to find the file, in microseconds.
+    */
+    float64 ResolveUS;
+
+    /** \brief Time spent to map the file, in microseconds.
+    */
+    float64 ReadUS;
+
+    /** \brief Time spent parsing the file, including the wait for the other
+    * workers when it goes through ftkLoadRigidBodyFromFile, or looking up
+    * the cache, in microseconds.
+    */
+    float64 ParseUS;
+};
+
+/** \brief Class loading many geometry files at once.
+ *
+ * Files are resolved, read and parsed on a pool of worker threads, then
+ * gathered in a GeometryTable. The plain INI geometries, with only the
+ * [geometry] count and id and the x, y and z of each [fiducialN] section, are
+ * parsed by the workers concurrently; other files are given to
+ * ftkLoadRigidBodyFromFile, whose calls are serialised. Registration on the
+ * devices with ftkSetRigidBody happens on the calling thread.
+ *
+ * With a GeometryCache, files whose contents were already parsed skip
+ * parsing, and the newly parsed ones are saved to the cache at the end of the
+ * load.
+ *
+ * \code
+ * GeometryRegistry registry( lib );
+ * if ( registry.loadDirectory( "geometries" ) && registry.registerAll( sn ) )
+ * {
+ *     registry.printReport( std::cout );
+ *     std::shared_ptr< const GeometryTable > table( registry.table() );
+ *     const ftkRigidBody* body( table->find( 110u ) );
+ * }
+ * \endcode
+ */
+class GeometryRegistry
+{
+public:
+
+    /** \brief Constructor.
+    *
+    * \param[in] lib initialised library handle.
+    * \param[in] threads number of worker threads, 0 to use one per core.
+    */
+    explicit GeometryRegistry( ftkLibrary lib, uint32 threads = 0u );
+
+    /** \brief Sets the cache of parsed geometries.
+    *
+    * \param[in] cache opened cache, \c nullptr to always parse the files.
+    */
+    void setCache( GeometryCache* cache );
+
+    /** \brief Loads a list of geometry files.
+    *
+    * Files are looked for as loadRigidBody does, i.e. first as given, then
+    * in the library data directory. The previous table is replaced, even if
+    * some files fail.
+    *
+    * \param[in] fileNames names of the files.
+    *
+    * \retval true if all files were loaded,
+    * \retval false if at least one file could not be loaded or has an
+    * already loaded geometry ID, see reports().
+    */
+    bool loadFiles( const std::vector< std::string >& fileNames );
+
+    /** \brief Loads all the \c .ini files of a directory.
+    *
+    * \param[in] directory path of the directory.
+    *
+    * \retval true if the directory holds at least one file and all files were
+    * loaded,
+    * \retval false otherwise.
+    */
+    bool loadDirectory( const std::string& directory );
+
+    /** \brief Registers all the loaded geometries on a device.
+    *
+    * \param[in] sn serial number of the device.
+    *
+    * \retval true if ftkSetRigidBody succeeded for every geometry,
+    * \retval false otherwise.
+    */
+    bool registerAll( uint64 sn ) const;
+
+    /** \brief Getter for the last loaded table.
+    */
+    std::shared_ptr< const GeometryTable > table() const;
+
+    /** \brief Getter for the per-file outcome of the last load, in the order
+    * of the given files.
+    */
+    const std::vector< GeometryLoadReport >& reports() const;
+
+    /** \brief Getter for the duration of the last load, in microseconds.
+    */
+    float64 loadUS() const;
+
+    /** \brief Prints the per-file timing of the last load.
+    *
+    * \param[in,out] out stream to print to.
+    */
+    void printReport( std::ostream& out ) const;
+
+private:
+    void loadOne( const std::string& fileName, GeometryLoadReport& report, ftkRigidBody& body ) const;
+
+    ftkLibrary _Library;
+    uint32 _Threads;
+    GeometryCache* _Cache;
+    mutable std::mutex _ParseMutex;
+    std::shared_ptr< const GeometryTable > _Table;
+    std::vector< GeometryLoadReport > _Reports;
+    float64 _LoadUS;
+};
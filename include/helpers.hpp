@@ -159,6 +159,29 @@ inline void fusionTrackEnumerator( uint64 sn, void* user,
     }
 }
 
+/** \brief Callback function collecting every device.
+*
+* Contrary to deviceEnumerator, which overwrites its DeviceData, this
+* function appends each discovered device to the vector given as \c user
+* argument.
+*
+* \param[in] sn serial number of the discovered device.
+* \param[out] user pointer on a std::vector< DeviceData > instance.
+* \param[in] type type of the device.
+*/
+inline void devicesEnumerator( uint64 sn, void* user, ftkDeviceType type )
+{
+    if ( user != 0 )
+    {
+        std::vector< DeviceData >* ptr =
+            reinterpret_cast< std::vector< DeviceData >* >( user );
+        DeviceData device;
+        device.SerialNumber = sn;
+        device.Type = type;
+        ptr->push_back( device );
+    }
+}
+
 /** \brief Function exiting the program after displaying the error.
 *
 * This function retrieves the last error and displays the corresponding
@@ -289,6 +312,102 @@ inline DeviceData retrieveLastDevice( ftkLibrary lib,
     return device;
 }
 
+/** \brief Function enumerating all the devices.
+*
+* This function uses the ftkEnumerateDevices library function and the
+* devicesEnumerator callback so that every discovered device is kept, in
+* enumeration order.
+*
+* If no device is discovered, the execution is stopped by a call to error();
+*
+* \param[in] lib initialised library handle.
+* \param[in] allowSimulator setting to \c false requires to discover only real
+* devices (i.e. the simulator device is not retrieved).
+* \param[in] quiet setting to \c true to disactivate printouts
+* \param[in] dontWaitForKeyboard, setting to true to avoid being prompted before exiting program
+*
+* \return the serial numbers and types of the discovered devices.
+*/
+inline std::vector< DeviceData > retrieveDevices( ftkLibrary lib,
+                                                  bool       allowSimulator = true,
+                                                  bool       quiet = false,
+                                                  bool       dontWaitForKeyboard = false )
+{
+    std::vector< DeviceData > devices;
+    ftkError err( ftkEnumerateDevices( lib, devicesEnumerator, &devices ) );
+
+    if ( err > ftkError::FTK_OK )
+    {
+        checkError( lib, dontWaitForKeyboard );
+    }
+    else if ( err < ftkError::FTK_OK )
+    {
+        if ( ! quiet )
+        {
+            checkError( lib, dontWaitForKeyboard, false );
+        }
+    }
+
+    if ( ! allowSimulator )
+    {
+        size_t count( devices.size() );
+        for ( size_t i( devices.size() ); i > 0u; --i )
+        {
+            if ( devices[ i - 1u ].Type == ftkDeviceType::DEV_SIMULATOR )
+            {
+                devices.erase( devices.begin() + ( i - 1u ) );
+            }
+        }
+        if ( devices.size() != count )
+        {
+            std::cerr
+                << "ERROR: This sample cannot be used with the simulator"
+                << std::endl;
+        }
+    }
+
+    if ( devices.empty() )
+    {
+        error( "No device connected", dontWaitForKeyboard );
+    }
+
+    if ( ! quiet )
+    {
+        for ( const DeviceData& device : devices )
+        {
+            std::string text;
+            switch ( device.Type )
+            {
+            case ftkDeviceType::DEV_SPRYTRACK_180:
+                text = "sTk 180";
+                break;
+            case ftkDeviceType::DEV_SPRYTRACK_300:
+                text = "sTk 300";
+                break;
+            case ftkDeviceType::DEV_FUSIONTRACK_500:
+                text = "fTk 500";
+                break;
+            case ftkDeviceType::DEV_FUSIONTRACK_250:
+                text = "fTk 250";
+                break;
+            case ftkDeviceType::DEV_SIMULATOR:
+                text = "fTk simulator";
+                break;
+            default:
+                text = "UNKNOWN device";
+            }
+            std::cout << "Detected one " << text;
+
+            std::cout << " with serial number 0x" << std::setw( 16u )
+                      << std::setfill( '0' ) << std::hex << device.SerialNumber <<
+                std::dec
+                      << std::endl << std::setfill( '\0' );
+        }
+    }
+
+    return devices;
+}
+
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
@@ -499,6 +618,5 @@ inline bool ErrorReader::isOk() const
     return _ErrorString.empty() && _WarningString.empty();
 }
 
-void optionEnumerator(uint64 sn, void* user, ftkOptionsInfo* oi);
 void enumerateOptions(ftkLibrary lib, uint64 sn);
 void setOptionValue(ftkLibrary lib, uint64 sn, uint32 optID, int32 value);
@@ -0,0 +1,315 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file imageCapture.hpp
+ *   \brief Background capture of the camera images to disk, with lossless
+ *   compression.
+ *
+ *   A capture file is made of one ImageCaptureHeader followed by the images,
+ *   each being a CapturedImage followed by the compressed left image, the
+ *   compressed right image and zero padding up to CapturedImage::recordSize.
+ *   All records are plain little-endian structures whose sizes are multiple
+ *   of 8 bytes. Images are written as soon as they are compressed, so their
+ *   order in the file may differ slightly from the acquisition order; use
+ *   CapturedImage::counter to sort them.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "framePool.hpp"
+
+#include <ftkInterface.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** \brief Magic value starting a capture file, "STKIMG" followed by 0x00
+ * 0x01.
+ */
+#define IMAGE_CAPTURE_MAGIC 0x0100474d494b5453uLL
+
+/** \brief Current version of the capture file layout.
+ */
+#define IMAGE_CAPTURE_VERSION 1u
+
+/** \brief Magic value starting every image record, "IMGE".
+ */
+#define CAPTURED_IMAGE_MAGIC 0x45474d49u
+
+/** \brief Codec of the images: horizontal delta then run-length encoding,
+ * see compressImage().
+ */
+#define IMAGE_CODEC_DELTA_RLE 1u
+
+/** \brief File header, at offset 0.
+ */
+struct ImageCaptureHeader
+{
+    uint64 magic;
+    uint32 version;
+    uint32 headerSize;
+    uint64 serialNumber;
+    uint32 imageRecordSize;
+    uint32 reserved[ 3u ];
+};
+
+/** \brief Header of one image record.
+ */
+struct CapturedImage
+{
+    uint32 magic;
+
+    /** \brief Size of the record including both images and the padding.
+    */
+    uint32 recordSize;
+    uint64 timestampUS;
+    uint32 counter;
+
+    /** \brief ftkPixelFormat of the images.
+    */
+    int32 format;
+    uint16 width;
+    uint16 height;
+    uint32 bytesPerPixel;
+
+    /** \brief Size of the compressed left image, in bytes.
+    */
+    uint32 leftSize;
+
+    /** \brief Size of the compressed right image, in bytes.
+    */
+    uint32 rightSize;
+    uint32 codec;
+    uint32 reserved;
+};
+
+/** \brief Largest compressed size of an image, in bytes.
+ *
+ * \param[in] size size of the uncompressed image, in bytes.
+ */
+uint32 maxCompressedSize( uint32 size );
+
+/** \brief Compresses an image without loss.
+ *
+ * Every byte is replaced by its difference with the same byte of the
+ * previous pixel, or of the pixel above for the first column, then the
+ * differences are run-length encoded: a control byte \c c below 128 is
+ * followed by \c c + 1 literal bytes, a control byte of 128 or more by one
+ * byte repeated \c c - 125 times. Dark backgrounds and flat areas become
+ * long runs of zeros.
+ *
+ * \param[in] pixels rows of the image, without padding.
+ * \param[in] width width of the image, in pixels.
+ * \param[in] height height of the image, in pixels.
+ * \param[in] bytesPerPixel size of a pixel, in bytes.
+ * \param[out] residuals scratch buffer of width * height * bytesPerPixel
+ * bytes.
+ * \param[out] out compressed image, at least maxCompressedSize() bytes.
+ *
+ * \return the size of the compressed image, in bytes.
+ */
+uint32 compressImage( const uint8* pixels, uint32 width, uint32 height, uint32 bytesPerPixel, uint8* residuals,
+                      uint8* out );
+
+/** \brief Decompresses an image compressed by compressImage().
+ *
+ * \param[in] data compressed image.
+ * \param[in] size size of the compressed image, in bytes.
+ * \param[in] width width of the image, in pixels.
+ * \param[in] height height of the image, in pixels.
+ * \param[in] bytesPerPixel size of a pixel, in bytes.
+ * \param[out] pixels rows of the image, width * height * bytesPerPixel
+ * bytes.
+ *
+ * \retval true if the image was decompressed,
+ * \retval false if the data is corrupted.
+ */
+bool decompressImage( const uint8* data, uint32 size, uint32 width, uint32 height, uint32 bytesPerPixel,
+                      uint8* pixels );
+
+/** \brief Class capturing the left and right images of the acquired frames
+ * to a file.
+ *
+ * capture() takes over a frame query of a FramePool and returns: it is meant
+ * to be called from the acquisition thread, which it never blocks nor makes
+ * copy the images. Worker threads compress the images of the oldest pending
+ * frame, see compressImage(), give the frame back to its pool and append the
+ * images to the file.
+ *
+ * When all the slots are taken, the oldest frame not yet being compressed
+ * is replaced by the new one; if the workers hold every slot the new frame
+ * is given back at once. Both cases are counted by droppedImages().
+ *
+ * The frame queries must be created with FrameOptions::Pixels.
+ *
+ * \code
+ * ImageCapture images;
+ * if ( images.open( "session.stkimg", sn ) )
+ * {
+ *     engine.setImageCapture( &images );
+ *     // ...
+ *     engine.stop();
+ *     images.close();
+ * }
+ * \endcode
+ */
+class ImageCapture
+{
+public:
+
+    /** \brief Capture parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor, 8 slots, fusionTrack sized images, 2
+        * workers.
+        */
+        Settings()
+            : Slots( 8u )
+            , MaxImageBytes( 2048u * 1088u )
+            , Workers( 2u )
+        {}
+
+        /** \brief Number of frames waiting for compression, at most
+        * MAX_SLOTS.
+        */
+        uint32 Slots;
+
+        /** \brief Largest size of one image, in bytes; larger images are
+        * dropped.
+        */
+        uint32 MaxImageBytes;
+
+        /** \brief Number of compression threads.
+        */
+        uint32 Workers;
+    };
+
+    /** \brief Largest number of frames waiting for compression.
+    */
+    static const uint32 MAX_SLOTS = 64u;
+
+    /** \brief Default constructor, no file is opened.
+    */
+    ImageCapture();
+
+    /** \brief Destructor, closes the capture.
+    */
+    ~ImageCapture();
+
+    ImageCapture( const ImageCapture& ) = delete;
+    ImageCapture& operator=( const ImageCapture& ) = delete;
+
+    /** \brief Creates the file and starts the workers.
+    *
+    * \param[in] path path of the file, overwritten if it exists.
+    * \param[in] sn serial number of the device, stored in the header.
+    * \param[in] settings capture parameters.
+    *
+    * \retval true if the capture is started,
+    * \retval false if the file could not be created.
+    */
+    bool open( const std::string& path, uint64 sn, const Settings& settings = Settings() );
+
+    /** \brief Writes the pending images, stops the workers and closes the
+    * file. Every frame is then given back to its pool.
+    *
+    * \retval true if all images were written,
+    * \retval false if a write failed.
+    */
+    bool close();
+
+    /** \brief Getter for the state of the capture.
+    */
+    bool isOpen() const;
+
+    /** \brief Queues the images of a frame, to be called from a single
+    * thread.
+    *
+    * The frame belongs to the capture from then on, it is given back with
+    * FramePool::release once compressed, or at once if it is not queued.
+    *
+    * \param[in] pool pool of the frame, must outlive the capture of the
+    * frame, see flush().
+    * \param[in] index index of a frame acquired from \c pool and filled by
+    * ftkGetLastFrame, FramePool::INVALID_INDEX to count the images of a
+    * frame which could not be held as dropped.
+    *
+    * \retval true if the images are queued,
+    * \retval false if the capture is closed, the frame has no valid images
+    * or the images were dropped.
+    */
+    bool capture( FramePool& pool, uint32 index );
+
+    /** \brief Waits until the workers gave every queued frame back to its
+    * pool.
+    */
+    void flush();
+
+    /** \brief Getter for the number of image pairs queued by capture().
+    */
+    uint64 capturedImages() const;
+
+    /** \brief Getter for the number of image pairs written to the file.
+    */
+    uint64 writtenImages() const;
+
+    /** \brief Getter for the number of image pairs dropped, replaced by
+    * newer ones or given up.
+    */
+    uint64 droppedImages() const;
+
+    /** \brief Getter for the size of the written images before
+    * compression, in bytes.
+    */
+    uint64 rawBytes() const;
+
+    /** \brief Getter for the number of bytes written to the file.
+    */
+    uint64 writtenBytes() const;
+
+private:
+    /** State of a slot. */
+    enum class SlotState : uint32
+    {
+        Free = 0,
+        Writing,
+        Ready,
+        Compressing
+    };
+
+    struct Slot
+    {
+        std::atomic< SlotState > State;
+
+        /** Capture order, the workers take the oldest ready slot first. */
+        std::atomic< uint64 > Sequence;
+        CapturedImage Header;
+        FramePool* Pool;
+        uint32 Index;
+    };
+
+    void run();
+    bool write( const CapturedImage& header, const uint8* data );
+
+    Settings _Settings;
+    FILE* _File;
+    std::mutex _FileMutex;
+    bool _Failed;
+    Slot _Slots[ MAX_SLOTS ];
+    uint64 _NextSequence;
+    std::vector< std::thread > _Workers;
+    std::atomic< bool > _Running;
+    std::atomic< uint64 > _Captured;
+    std::atomic< uint64 > _Written;
+    std::atomic< uint64 > _Dropped;
+    std::atomic< uint64 > _RawBytes;
+    std::atomic< uint64 > _WrittenBytes;
+};
@@ -0,0 +1,256 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file latencyHistogram.hpp
+ *   \brief High dynamic range latency histograms and per-stage frame
+ *   latency statistics.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkTypes.h>
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+
+/** \brief Number of bits of the sub-bucket index: each power of two is split
+ * in 2^7 buckets, so recorded values are kept within 0.8 %.
+ */
+#define LATENCY_SUB_BUCKET_BITS 7u
+
+/** \brief Largest recorded value is 2^40 ns, about 18 minutes; larger values
+ * are recorded as this one.
+ */
+#define LATENCY_MAX_VALUE_BITS 40u
+
+/** \brief Reading of the clock used for all latencies, in nanoseconds.
+ */
+inline int64 latencyClockNS()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+             std::chrono::steady_clock::now().time_since_epoch() )
+      .count();
+}
+
+/** \brief Summary of a LatencyHistogram, values in nanoseconds.
+ */
+struct LatencySnapshot
+{
+    /** \brief Default constructor, the snapshot is empty.
+    */
+    LatencySnapshot()
+        : Count( 0u )
+        , MinNS( 0u )
+        , MaxNS( 0u )
+        , MeanNS( 0.0 )
+        , P50NS( 0u )
+        , P99NS( 0u )
+        , P999NS( 0u )
+    {}
+
+    uint64 Count;
+    uint64 MinNS;
+    uint64 MaxNS;
+    float64 MeanNS;
+    uint64 P50NS;
+    uint64 P99NS;
+    uint64 P999NS;
+};
+
+/** \brief Log-linear histogram of durations.
+ *
+ * Values below 2^8 ns have their own bucket; above, each power of two is
+ * split in 2^LATENCY_SUB_BUCKET_BITS buckets, as in HdrHistogram. Recording
+ * is a few arithmetic operations and one relaxed atomic increment, it may
+ * be done from any thread while another one takes snapshots. Percentiles
+ * are reported as the upper bound of their bucket; minimum and maximum are
+ * exact.
+ */
+class LatencyHistogram
+{
+public:
+
+    /** \brief Number of buckets.
+    */
+    static const uint32 BUCKET_COUNT =
+      ( LATENCY_MAX_VALUE_BITS - LATENCY_SUB_BUCKET_BITS + 1u ) << LATENCY_SUB_BUCKET_BITS;
+
+    /** \brief Default constructor, the histogram is empty.
+    */
+    LatencyHistogram();
+
+    LatencyHistogram( const LatencyHistogram& ) = delete;
+    LatencyHistogram& operator=( const LatencyHistogram& ) = delete;
+
+    /** \brief Adds one duration.
+    *
+    * \param[in] valueNS duration in nanoseconds, negative values are
+    * recorded as 0.
+    */
+    void record( int64 valueNS );
+
+    /** \brief Computes the percentiles of the recorded values.
+    *
+    * \param[in] reset whether the histogram is emptied, to get the values
+    * of the next period only.
+    */
+    LatencySnapshot snapshot( bool reset = false );
+
+    /** \brief Getter for the bucket of a value.
+    */
+    static uint32 bucketOf( uint64 valueNS );
+
+    /** \brief Getter for the largest value of a bucket.
+    */
+    static uint64 upperBound( uint32 bucket );
+
+private:
+    std::atomic< uint64 > _Counts[ BUCKET_COUNT ];
+    std::atomic< uint64 > _SumNS;
+    std::atomic< uint64 > _MinNS;
+    std::atomic< uint64 > _MaxNS;
+};
+
+/** \brief Stages of the processing of a frame.
+ */
+enum class LatencyStage : uint32
+{
+    /** \brief Duration of the ftkGetLastFrame call.
+    */
+    Query = 0,
+
+    /** \brief Delay between the device timestamp and the return of
+    * ftkGetLastFrame, above the smallest delay observed so far: the device
+    * clock is not synchronised with the host, so only the variation is
+    * known.
+    */
+    Transfer,
+
+    /** \brief From the return of ftkGetLastFrame to the frame being
+    * available to the consumer: recording and PoseStore filling.
+    */
+    Decode,
+
+    /** \brief From the return of ftkGetLastFrame to the end of the pose
+    * filtering, see PoseFilter.
+    */
+    Filter,
+
+    /** \brief From the return of ftkGetLastFrame to the end of the predictor
+    * update, see PosePredictor.
+    */
+    Prediction,
+
+    /** \brief From the return of ftkGetLastFrame to the end of the shared
+    * memory publication, see SharedPosePublisher.
+    */
+    Share,
+
+    /** \brief From the return of ftkGetLastFrame to the end of the push to
+    * the pose stream, see PoseStreamServer.
+    */
+    Stream,
+
+    /** \brief From the return of ftkGetLastFrame to the end of the relative
+    * poses computation, see RelativePoseEngine.
+    */
+    Relative,
+
+    /** \brief From the frame being available to the consumer releasing it:
+    * queueing and consumer processing.
+    */
+    Consumer,
+
+    /** \brief From the return of ftkGetLastFrame to the consumer releasing
+    * the frame.
+    */
+    EndToEnd,
+
+    /** \brief Number of stages.
+    */
+    Count
+};
+
+/** \brief Latency histograms of all the stages of one acquisition engine.
+ *
+ * Each stage has a histogram of the whole run and one of the current
+ * period, restarted by the periodic snapshots, so that a periodic dump does
+ * not lose the whole run percentiles. The acquisition engine records the
+ * stages up to Decode and the Consumer and EndToEnd ones, the consumer
+ * records the stages of its own processing with recordFinished().
+ *
+ * \code
+ * const LatencySnapshot consumer(
+ *   engine.latency().snapshot( LatencyStage::Consumer ) );
+ * engine.latency().log( sn );
+ * \endcode
+ */
+class LatencyStats
+{
+public:
+
+    /** \brief Default constructor, the histograms are empty.
+    */
+    LatencyStats();
+
+    /** \brief Records the duration of a stage, may be called from any
+    * thread.
+    */
+    void record( LatencyStage stage, int64 valueNS );
+
+    /** \brief Records that a stage of a frame finished now.
+    *
+    * \param[in] stage stage which finished.
+    * \param[in] receivedNS time ftkGetLastFrame returned the frame, see
+    * PoseStore::receivedNS, nothing is recorded if it is 0.
+    */
+    void recordFinished( LatencyStage stage, int64 receivedNS );
+
+    /** \brief Records the Transfer stage of a frame.
+    *
+    * \param[in] deviceTimestampUS device timestamp of the frame.
+    * \param[in] receivedNS time ftkGetLastFrame returned.
+    */
+    void recordTransfer( uint64 deviceTimestampUS, int64 receivedNS );
+
+    /** \brief Computes the percentiles of a stage.
+    *
+    * \param[in] stage stage to summarise.
+    * \param[in] period whether the values since the previous periodic
+    * snapshot of the stage are summarised, restarting the period, instead
+    * of those of the whole run.
+    */
+    LatencySnapshot snapshot( LatencyStage stage, bool period = false );
+
+    /** \brief Writes one line per stage through the Logger.
+    *
+    * \param[in] sn serial number of the device, to tell engines apart.
+    * \param[in] period whether the values of the current period are
+    * written, restarting it, for periodic dumps, instead of those of the
+    * whole run.
+    */
+    void log( uint64 sn, bool period = false );
+
+    /** \brief Prints one line per stage, for the whole run.
+    *
+    * \param[in,out] out stream to print to.
+    */
+    void print( std::ostream& out );
+
+    /** \brief Getter for the name of a stage.
+    */
+    static const char* stageName( LatencyStage stage );
+
+private:
+    LatencyHistogram _Stages[ uint32( LatencyStage::Count ) ];
+    LatencyHistogram _Periods[ uint32( LatencyStage::Count ) ];
+
+    /** Smallest host reception time minus device timestamp, written by
+     * the acquisition thread only. */
+    int64 _MinOffsetNS;
+    bool _HasOffset;
+};
@@ -0,0 +1,267 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file logger.hpp
+ *   \brief Asynchronous logging, formatted and written on a background
+ *   thread.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "mpscRing.hpp"
+
+#include <ftkTypes.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+/** \brief Lowest level compiled in, calls below it are removed by the
+ * compiler. 0 keeps everything, 2 keeps warnings and errors only.
+ */
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 0
+#endif
+
+/** \brief Maximal number of arguments of one log call.
+ */
+#define LOG_MAX_ARGUMENTS 8u
+
+/** \brief Number of records the logger ring can hold.
+ */
+#define LOG_RING_CAPACITY 4096u
+
+/** \brief Severity of a log record.
+ */
+enum class LogLevel : uint32
+{
+    Debug = 0,
+    Info,
+    Warning,
+    Error,
+
+    /** \brief Level disabling all records.
+    */
+    Off
+};
+
+/** \brief One argument of a log record, copied by value.
+ *
+ * Integers and floating point values are stored as is. Text is stored as a
+ * pointer, so it must outlive the record: use string literals or static
+ * strings only. std::string arguments are refused at compile time.
+ */
+struct LogArgument
+{
+    enum class Kind : uint32
+    {
+        Signed = 0,
+        Unsigned,
+        Float,
+        Text
+    };
+
+    /** \brief Default constructor, leaves the argument uninitialised.
+    */
+    LogArgument() = default;
+
+    /** \brief Constructor from a number or a C string.
+    *
+    * \param[in] value value to be logged.
+    */
+    template< typename T >
+    LogArgument( const T& value )
+    {
+        if constexpr ( std::is_same< T, bool >::value )
+        {
+            Type = Kind::Unsigned;
+            Unsigned = value ? 1u : 0u;
+        }
+        else if constexpr ( std::is_integral< T >::value && std::is_signed< T >::value )
+        {
+            Type = Kind::Signed;
+            Signed = int64( value );
+        }
+        else if constexpr ( std::is_integral< T >::value || std::is_enum< T >::value )
+        {
+            Type = Kind::Unsigned;
+            Unsigned = uint64( value );
+        }
+        else if constexpr ( std::is_floating_point< T >::value )
+        {
+            Type = Kind::Float;
+            Float = float64( value );
+        }
+        else if constexpr ( std::is_convertible< const T&, const char* >::value &&
+                            !std::is_class< T >::value )
+        {
+            Type = Kind::Text;
+            Text = value;
+        }
+        else
+        {
+            static_assert( sizeof( T ) == 0u, "Only numbers and C strings can be logged" );
+        }
+    }
+
+    Kind Type;
+    union
+    {
+        int64 Signed;
+        uint64 Unsigned;
+        float64 Float;
+        const char* Text;
+    };
+};
+
+/** \brief Fixed-size log record, as stored in the logger ring.
+ */
+struct LogRecord
+{
+    /** \brief Time of the log call, steady clock, in nanoseconds.
+    */
+    int64 TimeNS;
+
+    /** \brief Format of the message, see Logger::write.
+    */
+    const char* Format;
+    LogLevel Level;
+
+    /** \brief Number of used arguments.
+    */
+    uint32 Count;
+    LogArgument Arguments[ LOG_MAX_ARGUMENTS ];
+};
+
+/** \brief Process-wide asynchronous logger.
+ *
+ * A log call copies its format pointer and arguments in a fixed-size
+ * LogRecord, pushed in a lock-free ring: the calling thread neither formats,
+ * allocates nor waits for the terminal. A background thread formats the
+ * records and writes them in batches. When the ring is full, records are
+ * dropped and counted, see droppedRecords().
+ *
+ * Formats use \c {} for an argument, \c {x} for an integer in hexadecimal
+ * and \c {.N} for a number with N decimals.
+ *
+ * \code
+ * LOG_INFO( "get frame {} from 0x{x}", frame->counter, sn );
+ * LOG_WARNING( "marker's buffer size is too small" );
+ * \endcode
+ *
+ * The LOG_ macros test the level before evaluating the arguments, a
+ * disabled level costs one relaxed atomic load; levels below
+ * LOG_COMPILED_LEVEL are not even compiled.
+ */
+class Logger
+{
+public:
+
+    /** \brief Getter for the logger, started on first use and writing to
+    * std::cout.
+    */
+    static Logger& instance();
+
+    Logger( const Logger& ) = delete;
+    Logger& operator=( const Logger& ) = delete;
+
+    /** \brief Destructor, writes the pending records and stops the
+    * background thread.
+    */
+    ~Logger();
+
+    /** \brief Sets the stream the records are written to.
+    *
+    * \param[in] out stream, must outlive the logger or be replaced before
+    * being destroyed.
+    */
+    void setOutput( std::ostream& out );
+
+    /** \brief Sets the lowest written level.
+    */
+    void setLevel( LogLevel level );
+
+    /** \brief Getter for the lowest written level.
+    */
+    LogLevel level() const;
+
+    /** \brief Whether records of a given level are written.
+    */
+    bool isEnabled( LogLevel level ) const
+    {
+        return uint32( level ) >= _Level.load( std::memory_order_relaxed );
+    }
+
+    /** \brief Queues a record, prefer the LOG_ macros.
+    *
+    * \param[in] level level of the record.
+    * \param[in] format format of the message, must be a string literal.
+    * \param[in] args at most LOG_MAX_ARGUMENTS numbers or C strings.
+    */
+    template< typename... Args >
+    void write( LogLevel level, const char* format, const Args&... args )
+    {
+        static_assert( sizeof...( Args ) <= LOG_MAX_ARGUMENTS, "Too many log arguments" );
+        LogRecord record;
+        record.TimeNS = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                          std::chrono::steady_clock::now().time_since_epoch() )
+                          .count();
+        record.Format = format;
+        record.Level = level;
+        record.Count = uint32( sizeof...( Args ) );
+        const LogArgument arguments[ sizeof...( Args ) + 1u ] = { LogArgument( args )..., LogArgument() };
+        std::copy( arguments, arguments + sizeof...( Args ), record.Arguments );
+        push( record );
+    }
+
+    /** \brief Waits until all the records queued so far are written.
+    */
+    void flush();
+
+    /** \brief Getter for the number of records lost because the ring was
+    * full.
+    */
+    uint64 droppedRecords() const;
+
+    /** \brief Getter for the number of written records.
+    */
+    uint64 writtenRecords() const;
+
+private:
+    Logger();
+
+    void push( const LogRecord& record );
+    void run();
+
+    MpscRing< LogRecord, LOG_RING_CAPACITY > _Ring;
+    std::atomic< uint32 > _Level;
+    std::atomic< uint64 > _Queued;
+    std::atomic< uint64 > _Written;
+    std::atomic< uint64 > _Dropped;
+    std::atomic< bool > _Running;
+    std::mutex _OutputLock;
+    std::ostream* _Output;
+    int64 _StartNS;
+    std::thread _Thread;
+};
+
+#define LOG_AT( level, ... )                                                                                 \
+    do                                                                                                       \
+    {                                                                                                        \
+        if ( uint32( level ) >= uint32( LOG_COMPILED_LEVEL ) && Logger::instance().isEnabled( level ) )     \
+        {                                                                                                    \
+            Logger::instance().write( level, __VA_ARGS__ );                                                  \
+        }                                                                                                    \
+    } while ( false )
+
+#define LOG_DEBUG( ... ) LOG_AT( LogLevel::Debug, __VA_ARGS__ )
+#define LOG_INFO( ... ) LOG_AT( LogLevel::Info, __VA_ARGS__ )
+#define LOG_WARNING( ... ) LOG_AT( LogLevel::Warning, __VA_ARGS__ )
+#define LOG_ERROR( ... ) LOG_AT( LogLevel::Error, __VA_ARGS__ )
@@ -0,0 +1,72 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file mappedFile.hpp
+ *   \brief Read-only memory mapping of a whole file.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkTypes.h>
+
+#include <string>
+
+/** \brief Class mapping a file read-only in memory.
+ *
+ * The file contents are accessed in place, without any stream nor copy. The
+ * mapping is released on close() or destruction.
+ */
+class MappedFile
+{
+public:
+
+    /** \brief Default constructor, no file is mapped.
+    */
+    MappedFile();
+
+    /** \brief Destructor, unmaps the file.
+    */
+    ~MappedFile();
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    /** \brief Maps a file.
+    *
+    * An empty file is successfully opened, with a \c nullptr data.
+    *
+    * \param[in] path path of the file to map.
+    *
+    * \retval true if the file is mapped,
+    * \retval false if the file could not be opened or mapped.
+    */
+    bool open( const std::string& path );
+
+    /** \brief Unmaps the file, if any.
+    */
+    void close();
+
+    /** \brief Getter for the state of the mapping.
+    */
+    bool isOpen() const;
+
+    /** \brief Getter for the file contents.
+    */
+    const char* data() const;
+
+    /** \brief Getter for the size of the file, in bytes.
+    */
+    uint64 size() const;
+
+private:
+    const char* _Data;
+    uint64 _Size;
+    bool _Open;
+#ifdef ATR_WIN
+    void* _File;
+    void* _Mapping;
+#endif
+};
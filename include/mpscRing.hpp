@@ -0,0 +1,166 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file mpscRing.hpp
+ *   \brief Fixed-capacity lock-free multiple-producer / single-consumer ring.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "spscRing.hpp"
+
+#include <ftkTypes.h>
+
+#include <atomic>
+
+/** \brief Bounded lock-free ring for any number of producers and exactly
+ * one consumer.
+ *
+ * Each slot carries a sequence number telling whether it is free for the
+ * producer holding a given ticket, or ready for the consumer. Producers
+ * only contend on the ticket counter; a full ring makes tryPush() fail
+ * instead of waiting. All slots are allocated with the ring.
+ *
+ * \code
+ * MpscRing< Item, 1024u > ring;
+ * // any producer thread
+ * if ( !ring.tryPush( item ) )
+ * {
+ *     ++dropped;
+ * }
+ * // consumer thread
+ * const Item* item( ring.front() );
+ * if ( item != nullptr )
+ * {
+ *     use( *item );
+ *     ring.popFront();
+ * }
+ * \endcode
+ *
+ * \tparam T type of the stored items, must be default constructible.
+ * \tparam Capacity number of slots, must be a power of two.
+ */
+template< typename T, uint32 Capacity >
+class MpscRing
+{
+    static_assert( Capacity >= 2u && ( Capacity & ( Capacity - 1u ) ) == 0u,
+                   "MpscRing capacity must be a power of two" );
+
+public:
+
+    /** \brief Default constructor, the ring is empty.
+    */
+    MpscRing()
+        : _Tail( 0u )
+        , _Head( 0u )
+    {
+        for ( uint32 i( 0u ); i < Capacity; ++i )
+        {
+            _Slots[ i ].Sequence.store( i, std::memory_order_relaxed );
+        }
+    }
+
+    MpscRing( const MpscRing& ) = delete;
+    MpscRing& operator=( const MpscRing& ) = delete;
+
+    /** \brief Producer side, copies an item in the ring.
+    *
+    * \param[in] item item to be copied.
+    *
+    * \retval true if the item was pushed,
+    * \retval false if the ring is full.
+    */
+    bool tryPush( const T& item )
+    {
+        uint32 ticket( _Tail.load( std::memory_order_relaxed ) );
+        Slot* slot( nullptr );
+        for ( ;; )
+        {
+            slot = &_Slots[ ticket & ( Capacity - 1u ) ];
+            const int32 lag( int32( slot->Sequence.load( std::memory_order_acquire ) - ticket ) );
+            if ( lag == 0 )
+            {
+                if ( _Tail.compare_exchange_weak( ticket, ticket + 1u, std::memory_order_relaxed ) )
+                {
+                    break;
+                }
+            }
+            else if ( lag < 0 )
+            {
+                // The slot still holds the item pushed one lap earlier.
+                return false;
+            }
+            else
+            {
+                ticket = _Tail.load( std::memory_order_relaxed );
+            }
+        }
+        slot->Item = item;
+        slot->Sequence.store( ticket + 1u, std::memory_order_release );
+        return true;
+    }
+
+    /** \brief Consumer side, gives access to the oldest item.
+    *
+    * \return a pointer on the oldest item, \c nullptr if the ring is empty or
+    * the oldest item is still being written. The pointer stays valid until
+    * popFront() is called.
+    */
+    T* front()
+    {
+        Slot& slot( _Slots[ _Head & ( Capacity - 1u ) ] );
+        if ( slot.Sequence.load( std::memory_order_acquire ) != _Head + 1u )
+        {
+            return nullptr;
+        }
+        return &slot.Item;
+    }
+
+    /** \brief Consumer side, releases the item obtained from front().
+    */
+    void popFront()
+    {
+        _Slots[ _Head & ( Capacity - 1u ) ].Sequence.store( _Head + Capacity, std::memory_order_release );
+        ++_Head;
+    }
+
+    /** \brief Consumer side, copies the oldest item out of the ring.
+    *
+    * \param[out] item where the item is copied.
+    *
+    * \retval true if an item was popped,
+    * \retval false if the ring is empty.
+    */
+    bool tryPop( T& item )
+    {
+        T* slot( front() );
+        if ( slot == nullptr )
+        {
+            return false;
+        }
+        item = *slot;
+        popFront();
+        return true;
+    }
+
+    /** \brief Getter for the number of slots.
+    */
+    static constexpr uint32 capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic< uint32 > Sequence;
+        T Item;
+    };
+
+    alignas( SPSC_CACHE_LINE ) std::atomic< uint32 > _Tail;
+    alignas( SPSC_CACHE_LINE ) uint32 _Head;
+    alignas( SPSC_CACHE_LINE ) Slot _Slots[ Capacity ];
+};
@@ -0,0 +1,200 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file multiDeviceAcquisition.hpp
+ *   \brief One acquisition thread per device, merged in a single stream.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "acquisitionEngine.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/** \brief Class acquiring from several devices concurrently.
+ *
+ * Each device gets its own AcquisitionEngine, hence its own thread, frame
+ * queries and ring, so that a slow device never delays the others. The
+ * threads are pinned to consecutive cores starting at
+ * Settings::FirstCore.
+ *
+ * The consumer sees a single stream, merged by host time: front() returns
+ * the oldest pending frame among all the devices. The device clocks are
+ * independent, so each device timestamp is mapped to the host clock with the
+ * smallest offset observed between reception time and device time, as
+ * PosePredictor does. To keep the order when a device is late, the oldest
+ * frame is only handed out once every device has a pending frame, or after
+ * the late devices have been silent for Settings::MergeWindowMS.
+ *
+ * \code
+ * std::vector< DeviceData > devices( retrieveDevices( lib ) );
+ * std::vector< uint64 > serials;
+ * for ( const DeviceData& device : devices )
+ * {
+ *     serials.push_back( device.SerialNumber );
+ * }
+ * MultiDeviceAcquisition acquisition( lib, serials );
+ * if ( acquisition.start() )
+ * {
+ *     const PoseStore* frame( acquisition.front() );
+ *     if ( frame != nullptr )
+ *     {
+ *         uint64 sn( acquisition.frontSerialNumber() );
+ *         // ...
+ *         acquisition.popFront();
+ *     }
+ *     acquisition.stop();
+ * }
+ * \endcode
+ */
+class MultiDeviceAcquisition
+{
+public:
+
+    /** \brief Acquisition parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor, pins the threads from core 0 on and
+        * waits at most 20 ms for late devices.
+        */
+        Settings()
+            : FirstCore( 0 )
+            , MergeWindowMS( 20u )
+        {}
+
+        /** \brief Parameters of every engine, AcquisitionEngine::Settings::Core
+        * is overwritten.
+        */
+        AcquisitionEngine::Settings Engine;
+
+        /** \brief Core of the first device thread, the next devices use the
+        * next cores, -1 to disable pinning.
+        */
+        int32 FirstCore;
+
+        /** \brief Time after which a silent device no longer holds the merged
+        * stream back, in milliseconds.
+        */
+        uint32 MergeWindowMS;
+    };
+
+    /** \brief Constructor acquiring from live devices, does not start the
+    * threads.
+    *
+    * \param[in] lib initialised library handle.
+    * \param[in] serialNumbers serial numbers of the devices.
+    * \param[in] settings acquisition parameters.
+    */
+    MultiDeviceAcquisition( ftkLibrary lib, const std::vector< uint64 >& serialNumbers,
+                            const Settings& settings = Settings() );
+
+    /** \brief Constructor acquiring from any frame sources, does not start
+    * the threads.
+    *
+    * \param[in] sources frame sources, must outlive the instance.
+    * \param[in] settings acquisition parameters.
+    */
+    explicit MultiDeviceAcquisition( const std::vector< FrameSource* >& sources,
+                                     const Settings& settings = Settings() );
+
+    /** \brief Destructor, stops the threads.
+    */
+    ~MultiDeviceAcquisition();
+
+    MultiDeviceAcquisition( const MultiDeviceAcquisition& ) = delete;
+    MultiDeviceAcquisition& operator=( const MultiDeviceAcquisition& ) = delete;
+
+    /** \brief Starts all the acquisition threads.
+    *
+    * \retval true if all threads are running,
+    * \retval false if one engine could not be started, none is running then.
+    */
+    bool start();
+
+    /** \brief Stops and joins all the acquisition threads.
+    */
+    void stop();
+
+    /** \brief Getter for the number of devices.
+    */
+    uint32 deviceCount() const;
+
+    /** \brief Getter for the engine of one device.
+    *
+    * \param[in] device index of the device, less than deviceCount().
+    */
+    AcquisitionEngine& engine( uint32 device );
+
+    /** \brief Getter for the serial number of one device.
+    *
+    * \param[in] device index of the device, less than deviceCount().
+    */
+    uint64 serialNumber( uint32 device ) const;
+
+    /** \brief Consumer side, gives access to the oldest frame of the merged
+    * stream.
+    *
+    * \return a pointer on the frame, \c nullptr if no frame can be handed out
+    * yet.
+    */
+    const PoseStore* front();
+
+    /** \brief Consumer side, getter for the index of the device of the frame
+    * returned by front().
+    */
+    uint32 frontDevice() const;
+
+    /** \brief Consumer side, getter for the serial number of the device of
+    * the frame returned by front().
+    */
+    uint64 frontSerialNumber() const;
+
+    /** \brief Consumer side, releases the frame obtained from front().
+    */
+    void popFront();
+
+    /** \brief Consumer side, copies the oldest frame of the merged stream.
+    *
+    * \param[out] frame where the frame is copied.
+    * \param[out] device where the index of the device is written, can be \c
+    * nullptr.
+    *
+    * \retval true if a frame was popped,
+    * \retval false if no frame can be handed out yet.
+    */
+    bool tryPop( PoseStore& frame, uint32* device = nullptr );
+
+    /** \brief Getter for the number of frames acquired by all the devices.
+    */
+    uint64 acquiredFrames() const;
+
+    /** \brief Getter for the number of frames dropped by all the devices.
+    */
+    uint64 droppedFrames() const;
+
+private:
+    /** Mapping of the clock of one device to the host clock. */
+    struct DeviceClock
+    {
+        int64 OffsetNS;
+        uint64 LastTimestampUS;
+        bool HasOffset;
+    };
+
+    void createEngines( const std::vector< FrameSource* >& sources );
+    int64 hostTimeNS( uint32 device, const PoseStore& frame );
+
+    Settings _Settings;
+    std::vector< std::unique_ptr< DeviceFrameSource > > _DeviceSources;
+    std::vector< FrameSource* > _Sources;
+    std::vector< std::unique_ptr< AcquisitionEngine > > _Engines;
+    std::vector< std::chrono::steady_clock::time_point > _LastSeen;
+    std::vector< DeviceClock > _Clocks;
+    uint32 _Front;
+};
@@ -0,0 +1,183 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file optionCatalog.hpp
+ *   \brief In-memory description of the options of a device.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkInterface.h>
+
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** \brief Value of an option, only the member matching the option type is
+ * meaningful.
+ */
+struct OptionValue
+{
+    /** \brief Default constructor, both members are zero.
+    */
+    OptionValue()
+        : Int( 0 )
+        , Float( 0.0f )
+    {}
+
+    /** \brief Value of an ftkOptionType::FTK_INT32 option.
+    */
+    int32 Int;
+
+    /** \brief Value of an ftkOptionType::FTK_FLOAT32 option.
+    */
+    float32 Float;
+};
+
+/** \brief Copy of the ftkOptionsInfo of one option, with its bounds and value.
+ */
+struct OptionInfo
+{
+    /** \brief Default constructor, nothing is known about the option.
+    */
+    OptionInfo()
+        : Id( 0u )
+        , Component( ftkComponent::FTK_LIBRARY )
+        , Type( ftkOptionType::FTK_INT32 )
+        , Readable( false )
+        , Writable( false )
+        , HasMin( false )
+        , HasMax( false )
+        , HasDefault( false )
+        , HasValue( false )
+    {}
+
+    uint32 Id;
+    std::string Name;
+    std::string Description;
+
+    /** \brief Unit of the option, empty if it has none.
+    */
+    std::string Unit;
+    ftkComponent Component;
+    ftkOptionType Type;
+    bool Readable;
+    bool Writable;
+
+    /** \brief Whether Min, Max, Default and Value could be retrieved.
+    */
+    bool HasMin;
+    bool HasMax;
+    bool HasDefault;
+    bool HasValue;
+    OptionValue Min;
+    OptionValue Max;
+    OptionValue Default;
+    OptionValue Value;
+
+    /** \brief Value of an ftkOptionType::FTK_DATA option, without the
+    * trailing null characters.
+    */
+    std::string Data;
+};
+
+/** \brief Class holding the options of a device, or of the library.
+ *
+ * The options are enumerated once by build(), which also reads their bounds,
+ * default and current value. Lookups by ID or name are then answered from
+ * memory, without calling the SDK.
+ *
+ * \code
+ * OptionCatalog catalog;
+ * if ( catalog.build( lib, 0uLL ) )
+ * {
+ *     const OptionInfo* dataDir( catalog.find( "Data Directory" ) );
+ *     catalog.print( std::cout );
+ * }
+ * \endcode
+ */
+class OptionCatalog
+{
+public:
+
+    /** \brief Default constructor, the catalog is empty.
+    */
+    OptionCatalog();
+
+    /** \brief Enumerates the options and reads their values.
+    *
+    * \param[in] lib initialised library handle.
+    * \param[in] sn serial number of the device, 0 for the library options.
+    *
+    * \retval true if the options could be enumerated,
+    * \retval false otherwise, the catalog is then empty.
+    */
+    bool build( ftkLibrary lib, uint64 sn );
+
+    /** \brief Reads again the current value of one option.
+    *
+    * \param[in] id ID of the option.
+    *
+    * \retval true if the value could be read,
+    * \retval false if the option is unknown, not readable or the read failed.
+    */
+    bool refreshValue( uint32 id );
+
+    /** \brief Reads again the current value of all readable options.
+    *
+    * \retval true if all values could be read,
+    * \retval false otherwise.
+    */
+    bool refreshValues();
+
+    /** \brief Looks for an option by ID.
+    *
+    * \return a pointer on the option, \c nullptr if it is unknown.
+    */
+    const OptionInfo* find( uint32 id ) const;
+
+    /** \brief Looks for an option by name.
+    *
+    * \return a pointer on the option, \c nullptr if it is unknown.
+    */
+    const OptionInfo* find( const std::string& name ) const;
+
+    /** \brief Getter for the library handle given to build().
+    */
+    ftkLibrary library() const;
+
+    /** \brief Getter for the serial number given to build().
+    */
+    uint64 serialNumber() const;
+
+    /** \brief Getter for the number of options.
+    */
+    uint32 size() const;
+
+    /** \brief Getter for an option, in enumeration order.
+    *
+    * \param[in] index index of the option, less than size().
+    */
+    const OptionInfo& operator[]( uint32 index ) const;
+
+    /** \brief Prints all the options, as the samples enumerating options do.
+    *
+    * \param[in,out] out stream to print to.
+    */
+    void print( std::ostream& out ) const;
+
+private:
+    static void enumerator( uint64 sn, void* user, ftkOptionsInfo* oi );
+
+    bool readValue( const OptionInfo& option, ftkOptionGetter what, OptionValue& value ) const;
+
+    ftkLibrary _Library;
+    uint64 _SerialNumber;
+    std::vector< OptionInfo > _Options;
+    std::unordered_map< uint32, uint32 > _ById;
+    std::unordered_map< std::string, uint32 > _ByName;
+};
@@ -0,0 +1,223 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file optionHandle.hpp
+ *   \brief Typed handles on device options, resolved once.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "optionCatalog.hpp"
+
+#include <ftkInterface.h>
+
+#include <iostream>
+#include <string>
+
+/** \brief ID of the option selecting the current temperature index.
+ */
+constexpr uint32 OPTION_ID_TEMPERATURE_INDEX = 30u;
+
+/** \brief ID of the option copying the counter of lost frames.
+ */
+constexpr uint32 OPTION_ID_COPY_LOST_FRAMES = 68u;
+
+/** \brief Mapping of a C++ type to the SDK option type and accessors.
+ *
+ * Only int32 (ftkGetInt32 / ftkSetInt32), float32 (ftkGetFloat32 /
+ * ftkSetFloat32) and ftkBuffer (ftkGetData / ftkSetData) are specialised.
+ *
+ * \tparam T type of the option value.
+ */
+template< typename T >
+struct OptionTraits
+{
+    static_assert( sizeof( T ) == 0u, "Options are int32, float32 or ftkBuffer" );
+};
+
+template<>
+struct OptionTraits< int32 >
+{
+    static constexpr ftkOptionType Type = ftkOptionType::FTK_INT32;
+
+    static ftkError get( ftkLibrary lib, uint64 sn, uint32 id, int32& value, ftkOptionGetter what )
+    {
+        return ftkGetInt32( lib, sn, id, &value, what );
+    }
+
+    static ftkError set( ftkLibrary lib, uint64 sn, uint32 id, const int32& value )
+    {
+        return ftkSetInt32( lib, sn, id, value );
+    }
+};
+
+template<>
+struct OptionTraits< float32 >
+{
+    static constexpr ftkOptionType Type = ftkOptionType::FTK_FLOAT32;
+
+    static ftkError get( ftkLibrary lib, uint64 sn, uint32 id, float32& value, ftkOptionGetter what )
+    {
+        return ftkGetFloat32( lib, sn, id, &value, what );
+    }
+
+    static ftkError set( ftkLibrary lib, uint64 sn, uint32 id, const float32& value )
+    {
+        return ftkSetFloat32( lib, sn, id, value );
+    }
+};
+
+template<>
+struct OptionTraits< ftkBuffer >
+{
+    static constexpr ftkOptionType Type = ftkOptionType::FTK_DATA;
+
+    /** \brief Data options only have a value, \c what is ignored.
+    */
+    static ftkError get( ftkLibrary lib, uint64 sn, uint32 id, ftkBuffer& value, ftkOptionGetter )
+    {
+        return ftkGetData( lib, sn, id, &value );
+    }
+
+    static ftkError set( ftkLibrary lib, uint64 sn, uint32 id, const ftkBuffer& value )
+    {
+        return ftkSetData( lib, sn, id, const_cast< ftkBuffer* >( &value ) );
+    }
+};
+
+/** \brief Handle on one option of one device.
+ *
+ * The option is looked up by name or ID once, in the OptionCatalog of the
+ * device, and its type is checked against \c T. get() and set() then call
+ * the matching SDK function directly: there is no name lookup nor type
+ * dispatch left on the acquisition path.
+ *
+ * \code
+ * OptionCatalog catalog;
+ * catalog.build( lib, sn );
+ * Option< int32 > temperatureIndex;
+ * if ( temperatureIndex.resolve( catalog, OPTION_ID_TEMPERATURE_INDEX ) )
+ * {
+ *     temperatureIndex.set( 1 );
+ * }
+ * \endcode
+ *
+ * \tparam T type of the option value, int32, float32 or ftkBuffer.
+ */
+template< typename T >
+class Option
+{
+public:
+    typedef OptionTraits< T > Traits;
+
+    /** \brief Default constructor, the handle is not resolved.
+    */
+    Option()
+        : _Library( nullptr )
+        , _SerialNumber( 0uLL )
+        , _Id( 0u )
+        , _Resolved( false )
+    {}
+
+    /** \brief Resolves the handle by option ID.
+    *
+    * \param[in] catalog catalog of the device options.
+    * \param[in] id ID of the option.
+    *
+    * \retval true if the option exists and has type \c T,
+    * \retval false otherwise, the handle is then not resolved.
+    */
+    bool resolve( const OptionCatalog& catalog, uint32 id )
+    {
+        return bind( catalog, catalog.find( id ), std::to_string( id ) );
+    }
+
+    /** \brief Resolves the handle by option name.
+    *
+    * \param[in] catalog catalog of the device options.
+    * \param[in] name name of the option.
+    *
+    * \retval true if the option exists and has type \c T,
+    * \retval false otherwise, the handle is then not resolved.
+    */
+    bool resolve( const OptionCatalog& catalog, const std::string& name )
+    {
+        return bind( catalog, catalog.find( name ), name );
+    }
+
+    /** \brief Getter for the resolution state.
+    */
+    bool isResolved() const
+    {
+        return _Resolved;
+    }
+
+    /** \brief Getter for the option ID, meaningful once resolved.
+    */
+    uint32 id() const
+    {
+        return _Id;
+    }
+
+    /** \brief Reads the option.
+    *
+    * \param[out] value read value.
+    * \param[in] what value to read, the current one by default.
+    *
+    * \return the SDK error, ftkError::FTK_ERR_INV_OPT if the handle is not
+    * resolved.
+    */
+    ftkError get( T& value, ftkOptionGetter what = ftkOptionGetter::FTK_VALUE ) const
+    {
+        if ( !_Resolved )
+        {
+            return ftkError::FTK_ERR_INV_OPT;
+        }
+        return Traits::get( _Library, _SerialNumber, _Id, value, what );
+    }
+
+    /** \brief Writes the option.
+    *
+    * \param[in] value value to write.
+    *
+    * \return the SDK error, ftkError::FTK_ERR_INV_OPT if the handle is not
+    * resolved.
+    */
+    ftkError set( const T& value ) const
+    {
+        if ( !_Resolved )
+        {
+            return ftkError::FTK_ERR_INV_OPT;
+        }
+        return Traits::set( _Library, _SerialNumber, _Id, value );
+    }
+
+private:
+    bool bind( const OptionCatalog& catalog, const OptionInfo* option, const std::string& key )
+    {
+        _Resolved = false;
+        if ( option == nullptr )
+        {
+            std::cerr << "Unknown option '" << key << "'" << std::endl;
+            return false;
+        }
+        if ( option->Type != Traits::Type )
+        {
+            std::cerr << "Option '" << key << "' does not have the expected type" << std::endl;
+            return false;
+        }
+        _Library = catalog.library();
+        _SerialNumber = catalog.serialNumber();
+        _Id = option->Id;
+        _Resolved = true;
+        return true;
+    }
+
+    ftkLibrary _Library;
+    uint64 _SerialNumber;
+    uint32 _Id;
+    bool _Resolved;
+};
@@ -0,0 +1,213 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file optionProfile.hpp
+ *   \brief Named sets of option values, applied in one pass to a device.
+ *
+ *   A profile file holds one or more profiles:
+ *
+ *   \code
+ *   # comment
+ *   [default]
+ *   10 = 2173
+ *   Synthetic body count = 4
+ *
+ *   [calibration]
+ *   Synthetic body count = 1
+ *   \endcode
+ *
+ *   Options are given by ID or by name. Settings written before the first
+ *   section belong to a profile named \c default.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "optionCatalog.hpp"
+
+#include <ftkInterface.h>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/** \brief Value requested for one option.
+ */
+struct OptionSetting
+{
+    /** \brief Default constructor.
+    */
+    OptionSetting()
+        : Line( 0u )
+    {}
+
+    /** \brief ID or name of the option.
+    */
+    std::string Option;
+
+    /** \brief Requested value, as written in the file.
+    */
+    std::string Value;
+
+    /** \brief Line of the setting in the profile file, 0 if it was not read
+    * from a file.
+    */
+    uint32 Line;
+};
+
+/** \brief Named list of option values.
+ */
+struct OptionProfile
+{
+    std::string Name;
+    std::vector< OptionSetting > Settings;
+};
+
+/** \brief Outcome of one setting of a profile.
+ */
+enum class OptionApplyStatus : int32
+{
+    /** \brief The option already had the requested value, nothing was
+    * written.
+    */
+    Unchanged = 0,
+
+    /** \brief The value was written and read back.
+    */
+    Written,
+
+    /** \brief No option has this ID or name.
+    */
+    UnknownOption,
+
+    /** \brief The value cannot be converted to the option type, or is out of
+    * the option bounds.
+    */
+    InvalidValue,
+
+    /** \brief The option cannot be written.
+    */
+    ReadOnly,
+
+    /** \brief The SDK refused the value.
+    */
+    WriteFailed,
+
+    /** \brief The value read back differs from the requested one.
+    */
+    Mismatch
+};
+
+/** \brief Outcome of one setting of a profile.
+ */
+struct OptionApplyResult
+{
+    /** \brief Default constructor.
+    */
+    OptionApplyResult()
+        : Id( 0u )
+        , Status( OptionApplyStatus::UnknownOption )
+    {}
+
+    /** \brief The setting, as given in the profile.
+    */
+    OptionSetting Setting;
+
+    /** \brief ID of the option, 0 if it is unknown.
+    */
+    uint32 Id;
+    OptionApplyStatus Status;
+
+    /** \brief Value before the profile was applied, empty if it could not be
+    * read.
+    */
+    std::string Previous;
+
+    /** \brief Value after the profile was applied, empty if it could not be
+    * read.
+    */
+    std::string Current;
+};
+
+/** \brief Outcome of applyOptionProfile.
+ */
+struct OptionApplyReport
+{
+    /** \brief Default constructor, nothing was applied.
+    */
+    OptionApplyReport()
+        : Written( 0u )
+        , Unchanged( 0u )
+        , Failed( 0u )
+        , ApplyUS( 0.0 )
+    {}
+
+    /** \brief Whether all the settings are in effect.
+    */
+    bool ok() const;
+
+    /** \brief Prints the settings which were written or failed.
+    *
+    * \param[in,out] out stream to print to.
+    */
+    void print( std::ostream& out ) const;
+
+    /** \brief Name of the applied profile.
+    */
+    std::string Profile;
+
+    /** \brief Outcome of each setting, in the profile order.
+    */
+    std::vector< OptionApplyResult > Results;
+    uint32 Written;
+    uint32 Unchanged;
+    uint32 Failed;
+
+    /** \brief Duration of the whole application, in microseconds.
+    */
+    float64 ApplyUS;
+};
+
+/** \brief Reads the profiles of a file.
+ *
+ * \param[in] fileName path of the profile file.
+ * \param[out] profiles profiles of the file, in the file order.
+ *
+ * \retval true if the file could be read,
+ * \retval false if it could not be opened or holds a malformed line.
+ */
+bool loadOptionProfiles( const std::string& fileName, std::vector< OptionProfile >& profiles );
+
+/** \brief Reads profiles from a stream, with the profile file syntax.
+ *
+ * \param[in,out] input stream to read.
+ * \param[out] profiles profiles of the stream, in the stream order.
+ *
+ * \retval true if the stream could be read,
+ * \retval false if it holds a malformed line.
+ */
+bool readOptionProfiles( std::istream& input, std::vector< OptionProfile >& profiles );
+
+/** \brief Looks for a profile by name.
+ *
+ * \return a pointer on the profile, \c nullptr if none has this name.
+ */
+const OptionProfile* findOptionProfile( const std::vector< OptionProfile >& profiles,
+                                        const std::string& name );
+
+/** \brief Applies a profile to the device of a catalog.
+ *
+ * The current values of the profile options are read, only the differing
+ * ones are written, then all the written options are read back. The catalog
+ * is not enumerated again and holds the new values afterwards. A failing
+ * setting does not stop the others.
+ *
+ * \param[in,out] catalog catalog of the device options, see
+ * OptionCatalog::build.
+ * \param[in] profile profile to apply.
+ *
+ * \return the outcome of each setting.
+ */
+OptionApplyReport applyOptionProfile( OptionCatalog& catalog, const OptionProfile& profile );
@@ -0,0 +1,140 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file poseFilter.hpp
+ *   \brief One-Euro filtering of the marker poses, all geometries at once.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "poseStore.hpp"
+
+#include <ftkInterface.h>
+
+/** \brief Maximum number of geometries with a filter state.
+ */
+#define MAX_FILTERED_GEOMETRIES MAX_TRACKED_MARKERS
+
+/** \brief Number of filtered channels per geometry: 3 translation
+ * coordinates and 9 rotation matrix elements.
+ */
+#define POSE_FILTER_CHANNELS 12u
+
+/** \brief One-Euro filter of the poses of every tracked geometry.
+ *
+ * The One-Euro filter is a low-pass filter whose cutoff frequency grows with
+ * the speed of the marker: slow motions are strongly smoothed, removing the
+ * jitter, while fast ones are followed with little lag.
+ *
+ * The filter state of all the geometries is stored attribute by attribute,
+ * like in PoseStore, and a frame is processed by a few loops over contiguous
+ * float arrays without branch, which the compiler turns into SIMD code.
+ * Rotation matrices are filtered element-wise and orthonormalised again.
+ *
+ * A geometry missing from a frame keeps its state; when it reappears within
+ * Settings::ReacquireTimeoutUS, filtering resumes with the longer time step,
+ * otherwise its filter restarts from the new measurement. The time steps are
+ * taken from the device timestamps, frames with a timestamp not greater than
+ * the previous one restart the filter.
+ *
+ * \code
+ * PoseFilter filter;
+ * PoseStore filtered;
+ * filter.filter( *engine.front(), filtered );
+ * \endcode
+ */
+class PoseFilter
+{
+public:
+
+    /** \brief Filter parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor, sets values suited to hand-held
+        * tools.
+        */
+        Settings()
+            : MinCutoffHz( 1.0f )
+            , Beta( 0.05f )
+            , RotationMinCutoffHz( 1.0f )
+            , RotationBeta( 0.5f )
+            , DerivativeCutoffHz( 1.0f )
+            , ReacquireTimeoutUS( 200000u )
+        {}
+
+        /** \brief Cutoff frequency of the translation at rest.
+        */
+        float32 MinCutoffHz;
+
+        /** \brief Increase of the translation cutoff frequency, in Hz per
+        * mm/s.
+        */
+        float32 Beta;
+
+        /** \brief Cutoff frequency of the rotation at rest.
+        */
+        float32 RotationMinCutoffHz;
+
+        /** \brief Increase of the rotation cutoff frequency, in Hz per unit
+        * of rotation matrix change per second (about radians per second).
+        */
+        float32 RotationBeta;
+
+        /** \brief Cutoff frequency of the speed estimate.
+        */
+        float32 DerivativeCutoffHz;
+
+        /** \brief Longest dropout after which filtering resumes, in
+        * microseconds; the filter restarts after longer ones.
+        */
+        uint32 ReacquireTimeoutUS;
+    };
+
+    /** \brief Constructor, no geometry is tracked.
+    */
+    explicit PoseFilter( const Settings& settings = Settings() );
+
+    /** \brief Forgets all the geometries.
+    */
+    void reset();
+
+    /** \brief Filters the poses of one frame.
+    *
+    * \param[in] raw poses as acquired.
+    * \param[out] filtered copy of \c raw with filtered translations and
+    * rotations, markers are in the same order; may be \c raw itself.
+    */
+    void filter( const PoseStore& raw, PoseStore& filtered );
+
+    /** \brief Getter for the number of geometries with a filter state.
+    */
+    uint32 trackedGeometries() const;
+
+private:
+    uint32 slotOf( uint32 geometryId, uint32 marker );
+
+    Settings _Settings;
+    uint32 _SlotCount;
+    uint32 _MarkerSlot[ MAX_TRACKED_MARKERS ];
+    alignas( POSE_STORE_ALIGNMENT ) uint32 _GeometryId[ MAX_FILTERED_GEOMETRIES ];
+    alignas( POSE_STORE_ALIGNMENT ) uint64 _LastSeenUS[ MAX_FILTERED_GEOMETRIES ];
+
+    /** Time step of the frame in seconds, 0 if the geometry is not in the
+     * frame. */
+    alignas( POSE_STORE_ALIGNMENT ) float32 _StepS[ MAX_FILTERED_GEOMETRIES ];
+
+    /** 1 if the filter restarts from the measurement, 0 otherwise. */
+    alignas( POSE_STORE_ALIGNMENT ) float32 _Restart[ MAX_FILTERED_GEOMETRIES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 _InverseStep[ MAX_FILTERED_GEOMETRIES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 _DerivativeAlpha[ MAX_FILTERED_GEOMETRIES ];
+
+    /** Smoothing factors of the translation and of the rotation. */
+    alignas( POSE_STORE_ALIGNMENT ) float32 _Alpha[ 2u ][ MAX_FILTERED_GEOMETRIES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 _Measured[ POSE_FILTER_CHANNELS ][ MAX_FILTERED_GEOMETRIES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 _Value[ POSE_FILTER_CHANNELS ][ MAX_FILTERED_GEOMETRIES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 _Derivative[ POSE_FILTER_CHANNELS ][ MAX_FILTERED_GEOMETRIES ];
+};
@@ -0,0 +1,191 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file posePredictor.hpp
+ *   \brief Extrapolation of the marker poses to a host time.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "poseStore.hpp"
+#include "seqlock.hpp"
+
+#include <ftkInterface.h>
+
+#include <atomic>
+
+/** \brief Maximum number of geometries followed by a PosePredictor.
+ */
+#define MAX_PREDICTED_GEOMETRIES MAX_TRACKED_MARKERS
+
+/** \brief Largest drift of the device clock with respect to the host clock
+ * compensated by PosePredictor, in parts per million.
+ */
+#define PREDICTOR_CLOCK_DRIFT_PPM 100
+
+/** \brief Pose of a geometry extrapolated to a host time.
+ */
+struct PosePrediction
+{
+    /** \brief Default constructor, the prediction is empty.
+    */
+    PosePrediction()
+        : GeometryId( 0u )
+        , TimeNS( 0 )
+        , AgeNS( 0 )
+        , TranslationMM{ 0.0f, 0.0f, 0.0f }
+        , Rotation{ { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } }
+        , PositionBoundMM( 0.0f )
+        , AngleBoundRad( 0.0f )
+    {}
+
+    /** \brief Geometry of the prediction.
+    */
+    uint32 GeometryId;
+
+    /** \brief Host time of the prediction, see latencyClockNS().
+    */
+    int64 TimeNS;
+
+    /** \brief Time between the last measured pose and TimeNS.
+    */
+    int64 AgeNS;
+
+    float32 TranslationMM[ 3u ];
+
+    /** \brief Rotation matrix, same convention as ftkMarker::rotation.
+    */
+    float32 Rotation[ 3u ][ 3u ];
+
+    /** \brief Expected bound of the translation error, in millimetres.
+    */
+    float32 PositionBoundMM;
+
+    /** \brief Expected bound of the rotation error, in radians.
+    */
+    float32 AngleBoundRad;
+};
+
+/** \brief Class extrapolating the poses of the geometries of one device.
+ *
+ * The writer, typically the frame loop, gives every frame to update(): the
+ * linear and angular velocities of each geometry are estimated from
+ * consecutive poses. Any thread may then call predict() to get a pose at a
+ * given host time, e.g. "now" in a control loop running faster than the
+ * camera. A query is a seqlock read and a few dozen floating point
+ * operations, it never waits for the writer.
+ *
+ * Frames are dated by their device timestamp, mapped to the host clock with
+ * the smallest offset observed between reception time and device time. The
+ * confidence bounds are the RMS errors of the one-frame-ahead predictions,
+ * scaled with the prediction horizon.
+ *
+ * \code
+ * PosePredictor predictor;
+ * predictor.update( filtered );     // frame loop
+ *
+ * PosePrediction now;               // control loop
+ * if ( predictor.predict( 110u, latencyClockNS(), now ) &&
+ *      now.PositionBoundMM < 1.0f )
+ * {
+ *     // ...
+ * }
+ * \endcode
+ */
+class PosePredictor
+{
+public:
+
+    /** \brief Predictor parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor.
+        */
+        Settings()
+            : MaxHorizonMS( 100u )
+            , VelocitySmoothing( 0.5f )
+            , ResidualSmoothing( 0.05f )
+            , BoundScale( 3.0f )
+        {}
+
+        /** \brief Longest extrapolation, older poses are not predicted and
+        * geometries missing for longer restart without velocity.
+        */
+        uint32 MaxHorizonMS;
+
+        /** \brief Weight of the newest velocity estimate, in ]0, 1].
+        */
+        float32 VelocitySmoothing;
+
+        /** \brief Weight of the newest squared residual, in ]0, 1].
+        */
+        float32 ResidualSmoothing;
+
+        /** \brief Number of RMS residuals in a confidence bound.
+        */
+        float32 BoundScale;
+    };
+
+    /** \brief Constructor, no geometry is followed.
+    */
+    explicit PosePredictor( const Settings& settings = Settings() );
+
+    PosePredictor( const PosePredictor& ) = delete;
+    PosePredictor& operator=( const PosePredictor& ) = delete;
+
+    /** \brief Writer side, adds the poses of a frame.
+    *
+    * Must be called from one thread at a time, with frames of one device
+    * in acquisition order.
+    *
+    * \param[in] poses poses of the frame, preferably filtered.
+    */
+    void update( const PoseStore& poses );
+
+    /** \brief Reader side, extrapolates the pose of a geometry.
+    *
+    * \param[in] geometryId geometry to predict.
+    * \param[in] timeNS host time of the prediction, see latencyClockNS().
+    * \param[out] prediction extrapolated pose and its confidence bounds.
+    *
+    * \retval true if \c prediction was written,
+    * \retval false if the geometry is unknown or its last pose is older
+    * than Settings::MaxHorizonMS.
+    */
+    bool predict( uint32 geometryId, int64 timeNS, PosePrediction& prediction ) const;
+
+private:
+    /** Published motion of one geometry. */
+    struct Motion
+    {
+        uint32 GeometryId;
+        uint32 Samples;
+        int64 TimeNS;
+        float32 TranslationMM[ 3u ];
+        float32 Rotation[ 3u ][ 3u ];
+        float32 VelocityMMS[ 3u ];
+        float32 AngularVelocityRadS[ 3u ];
+        float32 IntervalS;
+        float32 SquaredResidualMM;
+        float32 SquaredResidualRad;
+    };
+
+    static void extrapolate( const Motion& motion, float32 horizonS, float32 translationMM[ 3u ],
+                             float32 rotation[ 3u ][ 3u ] );
+
+    Settings _Settings;
+    int64 _ClockOffsetNS;
+    uint64 _LastTimestampUS;
+    bool _HasOffset;
+    uint32 _SlotCount;
+
+    /** Writer copies of the published motions. */
+    Motion _Motions[ MAX_PREDICTED_GEOMETRIES ];
+    std::atomic< uint32 > _PublishedSlots;
+    std::atomic< uint32 > _GeometryIds[ MAX_PREDICTED_GEOMETRIES ];
+    Seqlock< Motion > _Published[ MAX_PREDICTED_GEOMETRIES ];
+};
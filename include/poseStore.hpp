@@ -0,0 +1,95 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file poseStore.hpp
+ *   \brief Struct-of-arrays storage of the markers of one frame.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkInterface.h>
+
+/** \brief Maximum number of markers kept for one frame.
+ */
+#define MAX_TRACKED_MARKERS 64u
+
+/** \brief Alignment of the pose store arrays, one cache line.
+ */
+#define POSE_STORE_ALIGNMENT 64
+
+/** \brief Poses of the markers of one frame, stored attribute by attribute.
+ *
+ * The store is filled once per frame from the ftkFrameQuery, so downstream
+ * stages scan contiguous floats instead of copying whole ftkMarker
+ * instances. Marker \c i has its geometry in \c geometryId[ i ], its
+ * translation in \c translationMM[ 0..2 ][ i ] and its rotation matrix in
+ * \c rotation[ 0..2 ][ 0..2 ][ i ], with the same row / column convention as
+ * ftkMarker::rotation. Every array starts on a cache line.
+ *
+ * \code
+ * PoseStore store;
+ * store.fill( *frame );
+ * int32 i( store.find( 110u ) );
+ * if ( i >= 0 )
+ * {
+ *     float32 x( store.translationMM[ 0u ][ i ] );
+ * }
+ * \endcode
+ */
+struct alignas( POSE_STORE_ALIGNMENT ) PoseStore
+{
+    /** \brief Device timestamp of the frame, in microseconds.
+    */
+    uint64 timestampUS;
+
+    /** \brief Device counter of the frame.
+    */
+    uint32 counter;
+
+    /** \brief Status of the marker query of the frame.
+    */
+    ftkQueryStatus markersStat;
+
+    /** \brief Number of valid entries in the arrays.
+    */
+    uint32 count;
+
+    /** \brief Host time ftkGetLastFrame returned this frame, see
+    * latencyClockNS(), 0 if unknown.
+    */
+    int64 receivedNS;
+
+    /** \brief Host time the frame was made available to the consumer, see
+    * latencyClockNS(), 0 if unknown.
+    */
+    int64 publishedNS;
+
+    alignas( POSE_STORE_ALIGNMENT ) uint32 geometryId[ MAX_TRACKED_MARKERS ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 translationMM[ 3u ][ MAX_TRACKED_MARKERS ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 rotation[ 3u ][ 3u ][ MAX_TRACKED_MARKERS ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 registrationErrorMM[ MAX_TRACKED_MARKERS ];
+
+    /** \brief Empties the store and resets the frame metadata.
+    */
+    void clear();
+
+    /** \brief Fills the store from a frame query.
+    *
+    * Markers beyond MAX_TRACKED_MARKERS are ignored.
+    *
+    * \param[in] frame frame query filled by ftkGetLastFrame.
+    */
+    void fill( const ftkFrameQuery& frame );
+
+    /** \brief Looks for the marker of a given geometry.
+    *
+    * \param[in] id geometry ID to look for.
+    *
+    * \return the index of the marker, -1 if the geometry is not in the
+    * frame.
+    */
+    int32 find( uint32 id ) const;
+};
@@ -0,0 +1,447 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file poseStream.hpp
+ *   \brief Network stream of the marker poses, over UDP or TCP.
+ *
+ *   A packet is one PoseStreamPacket followed by PoseStreamPacket::frameCount
+ *   frames, each being a PoseStreamFrame followed by PoseStreamFrame::count
+ *   poses, StreamedPose or QuantizedStreamedPose depending on
+ *   PoseStreamPacket::encoding. Records are plain little-endian structures
+ *   packed one after the other, without padding. Over UDP a datagram holds
+ *   exactly one packet, over TCP packets follow each other in the stream.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "poseStore.hpp"
+#include "spscRing.hpp"
+
+#include <ftkInterface.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** \brief Magic value starting every packet, "STKP".
+ */
+#define POSE_STREAM_MAGIC 0x504b5453u
+
+/** \brief Current version of the wire format, receivers refuse other
+ * versions.
+ */
+#define POSE_STREAM_VERSION 1u
+
+/** \brief Largest size of a packet, the largest UDP payload.
+ */
+#define POSE_STREAM_MAX_PACKET_SIZE 65507u
+
+/** \brief Transport of a pose stream.
+ */
+enum class PoseStreamProtocol : uint32
+{
+    /** \brief Datagrams sent to one receiver, lost packets are not sent
+    * again.
+    */
+    Udp = 0,
+
+    /** \brief Connections accepted by the server, at most
+    * PoseStreamServer::MAX_CLIENTS.
+    */
+    Tcp
+};
+
+/** \brief Encoding of the poses of a packet.
+ */
+enum class PoseStreamEncoding : uint32
+{
+    /** \brief StreamedPose, the values of the PoseStore.
+    */
+    Float = 0,
+
+    /** \brief QuantizedStreamedPose, half the size.
+    */
+    Quantized
+};
+
+/** \brief Header of a packet.
+ */
+struct PoseStreamPacket
+{
+    uint32 magic;
+    uint16 version;
+
+    /** \brief PoseStreamEncoding of the poses.
+    */
+    uint16 encoding;
+
+    /** \brief Incremented for each packet sent, a gap tells how many packets
+    * were lost.
+    */
+    uint32 sequence;
+    uint16 frameCount;
+
+    /** \brief Size of the packet including this header, in bytes.
+    */
+    uint16 size;
+
+    /** \brief Host time the packet was sent, see latencyClockNS().
+    */
+    int64 sentNS;
+};
+
+/** \brief Header of one frame in a packet.
+ */
+struct PoseStreamFrame
+{
+    uint64 serialNumber;
+    uint64 timestampUS;
+
+    /** \brief Host time ftkGetLastFrame returned the frame, see
+    * latencyClockNS().
+    */
+    int64 receivedNS;
+    uint32 counter;
+
+    /** \brief Number of poses following this header.
+    */
+    uint16 count;
+
+    /** \brief ftkQueryStatus of the marker query.
+    */
+    int16 markersStat;
+};
+
+/** \brief Pose encoded with PoseStreamEncoding::Float.
+ */
+struct StreamedPose
+{
+    uint32 geometryId;
+    float32 registrationErrorMM;
+    float32 translationMM[ 3u ];
+
+    /** \brief Rotation matrix, same convention as ftkMarker::rotation.
+    */
+    float32 rotation[ 3u ][ 3u ];
+};
+
+/** \brief Pose encoded with PoseStreamEncoding::Quantized.
+ *
+ * Positions are rounded to the micrometre, up to 2 km away from the device,
+ * and the rotation is a unit quaternion whose components are scaled by
+ * 32767, which keeps the rotation error below 0.01 degree.
+ */
+struct QuantizedStreamedPose
+{
+    uint32 geometryId;
+    int32 translationUM[ 3u ];
+
+    /** \brief Quaternion (w, x, y, z) of the rotation, w positive.
+    */
+    int16 quaternion[ 4u ];
+
+    /** \brief Registration error in micrometres, saturated at 65535.
+    */
+    uint16 registrationErrorUM;
+    uint16 reserved;
+};
+
+/** \brief Class streaming poses to other machines.
+ *
+ * push() copies the poses into a ring and returns: it is meant to be called
+ * from the thread consuming the frames, which it never blocks. A background
+ * thread encodes the frames into a send buffer allocated once by open(),
+ * gathering up to Settings::BatchFrames frames per packet, and sends the
+ * packets. Frames pushed while the ring is full are dropped and counted.
+ *
+ * \code
+ * PoseStreamServer::Settings settings;
+ * settings.Host = "192.168.1.20";
+ * PoseStreamServer server;
+ * if ( server.open( settings ) )
+ * {
+ *     server.push( filtered, sn );   // frame loop
+ * }
+ * \endcode
+ */
+class PoseStreamServer
+{
+public:
+
+    /** \brief Stream parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor, float poses sent one frame per UDP
+        * datagram to port 5005 of the local host.
+        */
+        Settings()
+            : Protocol( PoseStreamProtocol::Udp )
+            , Host( "127.0.0.1" )
+            , Port( 5005u )
+            , Encoding( PoseStreamEncoding::Float )
+            , BatchFrames( 1u )
+            , MaxBatchDelayUS( 0u )
+            , MaxPacketBytes( 1472u )
+        {}
+
+        PoseStreamProtocol Protocol;
+
+        /** \brief Receiver of the datagrams with UDP, address to listen on
+        * with TCP.
+        */
+        std::string Host;
+        uint16 Port;
+        PoseStreamEncoding Encoding;
+
+        /** \brief Largest number of frames in a packet.
+        */
+        uint32 BatchFrames;
+
+        /** \brief Longest time a frame waits for the next ones of its batch,
+        * in microseconds; with 0 an incomplete batch is sent as soon as no
+        * frame is pending.
+        */
+        uint32 MaxBatchDelayUS;
+
+        /** \brief Size no batch exceeds, in bytes; a frame larger than this is
+        * sent alone. The default fits an Ethernet frame.
+        */
+        uint32 MaxPacketBytes;
+    };
+
+    /** \brief Number of frames that can wait for the background thread.
+    */
+    static const uint32 RING_CAPACITY = 64u;
+
+    /** \brief Largest number of TCP clients.
+    */
+    static const uint32 MAX_CLIENTS = 8u;
+
+    /** \brief Default constructor, nothing is sent.
+    */
+    PoseStreamServer();
+
+    /** \brief Destructor, closes the stream.
+    */
+    ~PoseStreamServer();
+
+    PoseStreamServer( const PoseStreamServer& ) = delete;
+    PoseStreamServer& operator=( const PoseStreamServer& ) = delete;
+
+    /** \brief Creates the socket, allocates the buffers and starts the
+    * background thread.
+    *
+    * \param[in] settings stream parameters.
+    *
+    * \retval true if the stream is started,
+    * \retval false if the socket could not be created.
+    */
+    bool open( const Settings& settings = Settings() );
+
+    /** \brief Sends the pending frames, stops the background thread and
+    * closes the sockets.
+    */
+    void close();
+
+    /** \brief Getter for the state of the stream.
+    */
+    bool isOpen() const;
+
+    /** \brief Queues the poses of a frame, to be called from a single thread.
+    *
+    * \param[in] poses poses of the frame.
+    * \param[in] sn serial number of the device of the frame.
+    *
+    * \retval true if the frame is queued,
+    * \retval false if the stream is closed or the ring is full.
+    */
+    bool push( const PoseStore& poses, uint64 sn );
+
+    /** \brief Getter for the number of frames sent.
+    */
+    uint64 sentFrames() const;
+
+    /** \brief Getter for the number of packets sent.
+    */
+    uint64 sentPackets() const;
+
+    /** \brief Getter for the number of bytes sent, to each client with TCP.
+    */
+    uint64 sentBytes() const;
+
+    /** \brief Getter for the number of frames dropped by push().
+    */
+    uint64 droppedFrames() const;
+
+    /** \brief Getter for the number of connected TCP clients.
+    */
+    uint32 clientCount() const;
+
+private:
+    struct Slot
+    {
+        uint64 serialNumber;
+        PoseStore poses;
+    };
+
+    void run();
+    void accept();
+    void append( const Slot& slot );
+    void flush();
+
+    Settings _Settings;
+    int64 _Socket;
+    int64 _Clients[ MAX_CLIENTS ];
+    std::atomic< uint32 > _ClientCount;
+    std::vector< uint8 > _Packet;
+    uint32 _PacketUsed;
+    uint32 _PacketFrames;
+    int64 _BatchStartNS;
+    uint32 _Sequence;
+    std::thread _Thread;
+    std::atomic< bool > _Running;
+    std::atomic< uint64 > _SentFrames;
+    std::atomic< uint64 > _SentPackets;
+    std::atomic< uint64 > _SentBytes;
+    std::atomic< uint64 > _Dropped;
+    std::unique_ptr< SpscRing< Slot, RING_CAPACITY > > _Ring;
+};
+
+/** \brief Class receiving the frames of a PoseStreamServer.
+ *
+ * \code
+ * PoseStreamClient::Settings settings;
+ * settings.Host = "0.0.0.0";
+ * PoseStreamClient client;
+ * PoseStore poses;
+ * uint64 sn( 0u );
+ * if ( client.open( settings ) )
+ * {
+ *     while ( client.receive( poses, sn, 100u ) )
+ *     {
+ *         // ...
+ *     }
+ * }
+ * \endcode
+ */
+class PoseStreamClient
+{
+public:
+
+    /** \brief Connection parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor, UDP on port 5005 of the local host.
+        */
+        Settings()
+            : Protocol( PoseStreamProtocol::Udp )
+            , Host( "127.0.0.1" )
+            , Port( 5005u )
+        {}
+
+        PoseStreamProtocol Protocol;
+
+        /** \brief Address to receive the datagrams on with UDP, "0.0.0.0"
+        * for all the interfaces, address of the server with TCP.
+        */
+        std::string Host;
+        uint16 Port;
+    };
+
+    /** \brief Default constructor, nothing is received.
+    */
+    PoseStreamClient();
+
+    /** \brief Destructor, closes the socket.
+    */
+    ~PoseStreamClient();
+
+    PoseStreamClient( const PoseStreamClient& ) = delete;
+    PoseStreamClient& operator=( const PoseStreamClient& ) = delete;
+
+    /** \brief Binds the UDP socket or connects to the TCP server.
+    *
+    * \param[in] settings connection parameters.
+    *
+    * \retval true if the socket is ready,
+    * \retval false if it could not be bound or connected.
+    */
+    bool open( const Settings& settings = Settings() );
+
+    /** \brief Closes the socket.
+    */
+    void close();
+
+    /** \brief Getter for the state of the socket.
+    */
+    bool isOpen() const;
+
+    /** \brief Gets the next frame, in the order it was sent.
+    *
+    * With UDP, a packet arriving after a newer one is dropped, see
+    * latePackets().
+    *
+    * PoseStore::publishedNS is set to the time the server sent the packet,
+    * on its clock.
+    *
+    * \param[out] poses poses of the frame.
+    * \param[out] sn serial number of the device of the frame.
+    * \param[in] timeoutMS longest wait for a packet, in milliseconds.
+    *
+    * \retval true if a frame was received,
+    * \retval false on timeout, or if the socket is closed or the TCP
+    * connection lost.
+    */
+    bool receive( PoseStore& poses, uint64& sn, uint32 timeoutMS );
+
+    /** \brief Getter for the number of valid packets received.
+    */
+    uint64 receivedPackets() const;
+
+    /** \brief Getter for the number of frames returned by receive().
+    */
+    uint64 receivedFrames() const;
+
+    /** \brief Getter for the number of packets missing from the sequence.
+    */
+    uint64 lostPackets() const;
+
+    /** \brief Getter for the number of packets dropped because they arrived
+    * after a newer one, they are counted by lostPackets() too.
+    */
+    uint64 latePackets() const;
+
+    /** \brief Getter for the number of packets refused, corrupted or of
+    * another version.
+    */
+    uint64 invalidPackets() const;
+
+private:
+    bool wait( uint32 timeoutMS );
+    bool nextPacket( uint32 timeoutMS );
+    bool readStream( uint32 timeoutMS );
+    bool checkPacket();
+    bool acceptPacket();
+
+    Settings _Settings;
+    int64 _Socket;
+    std::vector< uint8 > _Packet;
+    uint32 _PacketSize;
+    uint32 _Received;
+    uint32 _Offset;
+    uint32 _FramesLeft;
+    bool _Started;
+    uint32 _NextSequence;
+    uint64 _ReceivedPackets;
+    uint64 _ReceivedFrames;
+    uint64 _Lost;
+    uint64 _Late;
+    uint64 _Invalid;
+};
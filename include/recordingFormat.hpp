@@ -0,0 +1,125 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file recordingFormat.hpp
+ *   \brief On-disk layout of the frame recordings.
+ *
+ *   A recording is made of:
+ *   - one RecordingHeader;
+ *   - the frames, each being a RecordedFrame followed by
+ *     RecordedFrame::markersCount RecordedMarker and
+ *     RecordedFrame::fiducialsCount RecordedFiducial;
+ *   - the index, i.e. RecordingFooter::frameCount RecordingIndexEntry;
+ *   - one RecordingFooter, ending the file.
+ *
+ *   All records are plain little-endian structures whose sizes are multiple
+ *   of 8 bytes, so a mapped file can be used in place without parsing. A
+ *   recording without footer (e.g. after a crash) can still be read by
+ *   walking the frames through RecordedFrame::recordSize.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkTypes.h>
+
+/** \brief Magic value starting a recording, "STKREC" followed by 0x00 0x01.
+ */
+#define RECORDING_HEADER_MAGIC 0x01004345524b5453uLL
+
+/** \brief Magic value ending a complete recording, "STKIDX" followed by
+ * 0x00 0x01.
+ */
+#define RECORDING_FOOTER_MAGIC 0x01005844494b5453uLL
+
+/** \brief Current version of the recording layout.
+ */
+#define RECORDING_VERSION 1u
+
+/** \brief Magic value starting every frame record, "FRME".
+ */
+#define RECORDED_FRAME_MAGIC 0x454d5246u
+
+/** \brief File header, at offset 0.
+ */
+struct RecordingHeader
+{
+    uint64 magic;
+    uint32 version;
+    uint32 headerSize;
+    uint64 serialNumber;
+    uint64 startTimestampUS;
+    uint32 markerRecordSize;
+    uint32 fiducialRecordSize;
+    uint32 reserved[ 6u ];
+};
+
+/** \brief Header of one frame record.
+ */
+struct RecordedFrame
+{
+    uint32 magic;
+
+    /** \brief Size of the frame record including its markers and fiducials.
+    */
+    uint32 recordSize;
+    uint64 timestampUS;
+    uint32 counter;
+    int32 markersStat;
+    int32 fiducialsStat;
+    uint32 markersCount;
+    uint32 fiducialsCount;
+    uint32 reserved;
+};
+
+/** \brief Marker record, copy of the useful ftkMarker fields.
+ */
+struct RecordedMarker
+{
+    uint32 id;
+    uint32 geometryId;
+    uint32 geometryPresenceMask;
+    float32 registrationErrorMM;
+    float32 translationMM[ 3u ];
+    float32 rotation[ 3u ][ 3u ];
+};
+
+/** \brief Fiducial record, copy of the useful ftk3DFiducial fields.
+ */
+struct RecordedFiducial
+{
+    uint32 leftIndex;
+    uint32 rightIndex;
+    float32 positionMM[ 3u ];
+    float32 epipolarErrorPixels;
+    float32 triangulationErrorMM;
+    float32 probability;
+};
+
+/** \brief Index entry, one per frame.
+ */
+struct RecordingIndexEntry
+{
+    uint64 offset;
+    uint64 timestampUS;
+    uint32 counter;
+    uint32 reserved;
+};
+
+/** \brief File footer, ending a complete recording.
+ */
+struct RecordingFooter
+{
+    uint64 indexOffset;
+    uint64 frameCount;
+    uint64 magic;
+};
+
+static_assert( sizeof( RecordingHeader ) == 64u, "unexpected RecordingHeader layout" );
+static_assert( sizeof( RecordedFrame ) == 40u, "unexpected RecordedFrame layout" );
+static_assert( sizeof( RecordedMarker ) == 64u, "unexpected RecordedMarker layout" );
+static_assert( sizeof( RecordedFiducial ) == 32u, "unexpected RecordedFiducial layout" );
+static_assert( sizeof( RecordingIndexEntry ) == 24u, "unexpected RecordingIndexEntry layout" );
+static_assert( sizeof( RecordingFooter ) == 24u, "unexpected RecordingFooter layout" );
@@ -0,0 +1,100 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file recordingReader.hpp
+ *   \brief In-place access to a recording written by FrameRecorder.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "mappedFile.hpp"
+#include "recordingFormat.hpp"
+
+#include <string>
+#include <vector>
+
+/** \brief Class giving access to the frames of a mapped recording.
+ *
+ * The file is mapped read-only and the records are used in place. For a
+ * complete recording, the index is read from the footer; for a truncated
+ * one, it is rebuilt once by walking the frames.
+ *
+ * \code
+ * RecordingReader reader;
+ * if ( reader.open( "session.stkrec" ) )
+ * {
+ *     for ( uint64 i( 0u ); i < reader.frameCount(); ++i )
+ *     {
+ *         const RecordedFrame* frame( reader.frame( i ) );
+ *         const RecordedMarker* markers( reader.markers( *frame ) );
+ *         // ...
+ *     }
+ * }
+ * \endcode
+ */
+class RecordingReader
+{
+public:
+
+    /** \brief Default constructor, no recording is opened.
+    */
+    RecordingReader();
+
+    /** \brief Maps a recording and checks its layout.
+    *
+    * \param[in] path path of the recording.
+    *
+    * \retval true if the recording can be read,
+    * \retval false if the file cannot be mapped or is not a recording.
+    */
+    bool open( const std::string& path );
+
+    /** \brief Unmaps the recording.
+    */
+    void close();
+
+    /** \brief Getter for the file header.
+    */
+    const RecordingHeader* header() const;
+
+    /** \brief Getter for the completeness of the recording.
+    *
+    * \retval true if the recording has a footer,
+    * \retval false if the index had to be rebuilt.
+    */
+    bool isComplete() const;
+
+    /** \brief Getter for the number of frames.
+    */
+    uint64 frameCount() const;
+
+    /** \brief Getter for the index entry of a frame.
+    *
+    * \param[in] index index of the frame, less than frameCount().
+    */
+    const RecordingIndexEntry& entry( uint64 index ) const;
+
+    /** \brief Getter for a frame record.
+    *
+    * \param[in] index index of the frame, less than frameCount().
+    */
+    const RecordedFrame* frame( uint64 index ) const;
+
+    /** \brief Getter for the markers of a frame record.
+    */
+    const RecordedMarker* markers( const RecordedFrame& frame ) const;
+
+    /** \brief Getter for the fiducials of a frame record.
+    */
+    const RecordedFiducial* fiducials( const RecordedFrame& frame ) const;
+
+private:
+    MappedFile _File;
+    const RecordingIndexEntry* _Index;
+    uint64 _FrameCount;
+    bool _Complete;
+    std::vector< RecordingIndexEntry > _RebuiltIndex;
+};
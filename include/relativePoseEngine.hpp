@@ -0,0 +1,137 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file relativePoseEngine.hpp
+ *   \brief Poses of tools expressed in the frame of reference markers.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "poseStore.hpp"
+
+#include <ftkInterface.h>
+
+/** \brief Maximum number of (tool, reference) pairs of a RelativePoseEngine.
+ */
+#define MAX_RELATIVE_POSES MAX_TRACKED_MARKERS
+
+/** \brief Relative poses of one frame, stored attribute by attribute.
+ *
+ * Pair \c p has the pose of the tool \c toolId[ p ] in the frame of the
+ * reference \c referenceId[ p ]: a point \c x of the tool is at
+ * \c rotation[ 0..2 ][ 0..2 ][ p ] * x + \c translationMM[ 0..2 ][ p ] in
+ * reference coordinates. The pose is meaningful only when \c valid[ p ] is
+ * not 0, i.e. both geometries were in the frame.
+ */
+struct alignas( POSE_STORE_ALIGNMENT ) RelativePoses
+{
+    /** \brief Device timestamp of the frame, in microseconds.
+    */
+    uint64 timestampUS;
+
+    /** \brief Device counter of the frame.
+    */
+    uint32 counter;
+
+    /** \brief Number of pairs in the arrays.
+    */
+    uint32 count;
+
+    alignas( POSE_STORE_ALIGNMENT ) uint32 toolId[ MAX_RELATIVE_POSES ];
+    alignas( POSE_STORE_ALIGNMENT ) uint32 referenceId[ MAX_RELATIVE_POSES ];
+    alignas( POSE_STORE_ALIGNMENT ) uint8 valid[ MAX_RELATIVE_POSES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 translationMM[ 3u ][ MAX_RELATIVE_POSES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 rotation[ 3u ][ 3u ][ MAX_RELATIVE_POSES ];
+
+    /** \brief Looks for a pair.
+    *
+    * \param[in] tool geometry ID of the tool.
+    * \param[in] reference geometry ID of the reference.
+    *
+    * \return the index of the pair, -1 if it is not registered.
+    */
+    int32 find( uint32 tool, uint32 reference ) const;
+};
+
+/** \brief Class computing the poses of tools relative to reference markers.
+ *
+ * The (tool, reference) pairs are registered once, then compute() turns the
+ * camera poses of a frame into the poses of all the pairs. The pairs are
+ * kept grouped by reference: the inverse of each reference pose is computed
+ * once per frame and applied to all its tools by one branch-free loop over
+ * contiguous floats, 63 floating point operations per pair, which the
+ * compiler turns into SIMD code.
+ *
+ * \code
+ * RelativePoseEngine relative;
+ * relative.addPair( 110u, 120u );
+ *
+ * RelativePoses poses;             // frame loop
+ * relative.compute( filtered, poses );
+ * int32 p( poses.find( 110u, 120u ) );
+ * if ( p >= 0 && poses.valid[ p ] != 0u )
+ * {
+ *     float32 x( poses.translationMM[ 0u ][ p ] );
+ * }
+ * \endcode
+ */
+class RelativePoseEngine
+{
+public:
+
+    /** \brief Constructor, no pair is registered.
+    */
+    RelativePoseEngine();
+
+    /** \brief Registers a pair.
+    *
+    * The indices of the pairs in RelativePoses may change when a pair is
+    * added, use RelativePoses::find once the pairs are all registered.
+    *
+    * \param[in] tool geometry ID of the tool.
+    * \param[in] reference geometry ID of the reference.
+    *
+    * \retval true if the pair is registered,
+    * \retval false if the tool is the reference or MAX_RELATIVE_POSES pairs
+    * are already registered.
+    */
+    bool addPair( uint32 tool, uint32 reference );
+
+    /** \brief Removes all the pairs.
+    */
+    void clearPairs();
+
+    /** \brief Getter for the number of registered pairs.
+    */
+    uint32 pairCount() const;
+
+    /** \brief Computes the relative poses of a frame.
+    *
+    * \param[in] poses camera poses of the frame.
+    * \param[out] relative poses of every registered pair, in the
+    * registration order grouped by reference.
+    */
+    void compute( const PoseStore& poses, RelativePoses& relative );
+
+private:
+    int32 markerOf( const PoseStore& poses, uint32 geometryId, uint32& hint ) const;
+
+    uint32 _PairCount;
+    uint32 _ReferenceCount;
+    uint32 _ToolId[ MAX_RELATIVE_POSES ];
+    uint32 _ToolHint[ MAX_RELATIVE_POSES ];
+    uint32 _ReferenceId[ MAX_RELATIVE_POSES ];
+    uint32 _ReferenceHint[ MAX_RELATIVE_POSES ];
+
+    /** Pairs of reference \c r are in [ _ReferenceBegin[ r ],
+     * _ReferenceBegin[ r + 1 ] ). */
+    uint32 _ReferenceBegin[ MAX_RELATIVE_POSES + 1u ];
+
+    /** Camera poses of the tools gathered in the pair order, zero when the
+     * tool is missing. */
+    alignas( POSE_STORE_ALIGNMENT ) float32 _ToolTranslation[ 3u ][ MAX_RELATIVE_POSES ];
+    alignas( POSE_STORE_ALIGNMENT ) float32 _ToolRotation[ 3u ][ 3u ][ MAX_RELATIVE_POSES ];
+};
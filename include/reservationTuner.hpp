@@ -0,0 +1,145 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file reservationTuner.hpp
+ *   \brief Adaptive sizing of the frame query reservations.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "framePool.hpp"
+
+#include <ftkInterface.h>
+
+/** \brief Number of reservations tuned by ReservationTuner: events, left and
+ * right raw data, 3D fiducials and markers.
+ */
+#define TUNED_RESERVATIONS 5u
+
+/** \brief Class sizing the frame query reservations from the observed
+ * demand.
+ *
+ * Every acquired frame is given to observe(), which compares the number of
+ * items of each query with its reservation:
+ * - a query filled above Settings::GrowThreshold of its reservation, or
+ *   overflowing, has its reservation doubled right away, until the count is
+ *   below the threshold again, so the next busier frames still fit;
+ * - a query staying below Settings::ShrinkThreshold for
+ *   Settings::QuietFrames frames in a row has its reservation halved, as
+ *   long as the peak count of that period stays below the threshold.
+ *
+ * The gap between both thresholds is the hysteresis: a reservation does not
+ * oscillate when the demand hovers around a size. Reservations never go
+ * below Settings::MinSize nor above their cap, and queries with no initial
+ * reservation stay disabled. Pixels are never touched.
+ *
+ * The tuner only computes the reservations, the owner of the frame queries
+ * applies them with setFrameOptions(), see AcquisitionEngine.
+ *
+ * \code
+ * ReservationTuner tuner( FrameOptions() );
+ * if ( tuner.observe( *frame ) )
+ * {
+ *     setFrameOptions( tuner.options(), frame );
+ * }
+ * \endcode
+ */
+class ReservationTuner
+{
+public:
+
+    /** \brief Tuning parameters.
+    */
+    struct Settings
+    {
+        /** \brief Default constructor, grows at 75 %, shrinks below 25 %
+        * after 1000 quiet frames.
+        */
+        Settings()
+            : GrowThreshold( 0.75f )
+            , ShrinkThreshold( 0.25f )
+            , QuietFrames( 1000u )
+            , MinSize( 16u )
+            , MaxEventsSize( 64u )
+            , MaxRawDataSize( 256u )
+            , MaxThreeDFiducialsSize( 64u )
+            , MaxMarkersSize( 64u )
+        {}
+
+        /** \brief Fill ratio above which a reservation grows, in ]0, 1].
+        */
+        float32 GrowThreshold;
+
+        /** \brief Fill ratio below which a reservation may shrink, less than
+        * half of GrowThreshold.
+        */
+        float32 ShrinkThreshold;
+
+        /** \brief Number of consecutive quiet frames before a reservation
+        * shrinks.
+        */
+        uint32 QuietFrames;
+
+        /** \brief Smallest reservation of an enabled query, lower initial
+        * reservations are kept.
+        */
+        uint32 MinSize;
+
+        /** \brief Largest events reservation.
+        */
+        uint32 MaxEventsSize;
+
+        /** \brief Largest reservation of each raw data query.
+        */
+        uint32 MaxRawDataSize;
+
+        /** \brief Largest 3D fiducials reservation.
+        */
+        uint32 MaxThreeDFiducialsSize;
+
+        /** \brief Largest markers reservation.
+        */
+        uint32 MaxMarkersSize;
+    };
+
+    /** \brief Constructor.
+    *
+    * \param[in] initial reservations the frame queries are created with.
+    * \param[in] settings tuning parameters.
+    */
+    explicit ReservationTuner( const FrameOptions& initial, const Settings& settings = Settings() );
+
+    /** \brief Takes the demand of a frame into account.
+    *
+    * \param[in] frame frame query filled by ftkGetLastFrame.
+    *
+    * \retval true if the reservations changed,
+    * \retval false otherwise.
+    */
+    bool observe( const ftkFrameQuery& frame );
+
+    /** \brief Getter for the current reservations.
+    */
+    const FrameOptions& options() const;
+
+    /** \brief Getter for the number of times a reservation grew.
+    */
+    uint64 grows() const;
+
+    /** \brief Getter for the number of times a reservation shrank.
+    */
+    uint64 shrinks() const;
+
+private:
+    Settings _Settings;
+    FrameOptions _Options;
+    uint32 _Floor[ TUNED_RESERVATIONS ];
+    uint32 _Cap[ TUNED_RESERVATIONS ];
+    uint32 _Quiet[ TUNED_RESERVATIONS ];
+    uint32 _Peak[ TUNED_RESERVATIONS ];
+    uint64 _Grows;
+    uint64 _Shrinks;
+};
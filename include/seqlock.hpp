@@ -0,0 +1,127 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file seqlock.hpp
+ *   \brief Single writer, multiple readers sequence lock.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkTypes.h>
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+/** \brief Value published by one thread and read by any number of others.
+ *
+ * The writer never waits; a reader copies the value and retries when the
+ * writer modified it meanwhile. The value is stored in relaxed atomic words,
+ * so concurrent accesses are not data races and the instance can also be
+ * placed in memory shared between processes.
+ *
+ * \code
+ * Seqlock< Pose > pose;
+ * pose.store( latest );          // writer thread
+ * Pose copy( pose.load() );      // any thread
+ * \endcode
+ *
+ * \tparam T trivially copyable type of the value.
+ */
+template< typename T >
+class Seqlock
+{
+public:
+    static_assert( std::is_trivially_copyable< T >::value, "Seqlock values must be trivially copyable" );
+
+    /** \brief Number of 64-bit words holding the value.
+    */
+    static const uint32 WORD_COUNT = uint32( ( sizeof( T ) + sizeof( uint64 ) - 1u ) / sizeof( uint64 ) );
+
+    /** \brief Default constructor, the value is zero-filled.
+    */
+    Seqlock()
+        : _Sequence( 0u )
+    {
+        for ( std::atomic< uint64 >& word : _Words )
+        {
+            word.store( 0u, std::memory_order_relaxed );
+        }
+    }
+
+    Seqlock( const Seqlock& ) = delete;
+    Seqlock& operator=( const Seqlock& ) = delete;
+
+    /** \brief Writer side, replaces the value.
+    *
+    * Must only be called from one thread at a time.
+    */
+    void store( const T& value )
+    {
+        uint64 words[ WORD_COUNT ] = {};
+        std::memcpy( words, &value, sizeof( T ) );
+
+        const uint32 sequence( _Sequence.load( std::memory_order_relaxed ) );
+        _Sequence.store( sequence + 1u, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        for ( uint32 i( 0u ); i < WORD_COUNT; ++i )
+        {
+            _Words[ i ].store( words[ i ], std::memory_order_relaxed );
+        }
+        _Sequence.store( sequence + 2u, std::memory_order_release );
+    }
+
+    /** \brief Reader side, copies the value if no write is in progress.
+    *
+    * \param[out] value where the value is copied.
+    *
+    * \retval true if \c value is consistent,
+    * \retval false if a write was in progress, \c value is then unspecified.
+    */
+    bool tryLoad( T& value ) const
+    {
+        uint64 words[ WORD_COUNT ];
+        const uint32 before( _Sequence.load( std::memory_order_acquire ) );
+        if ( ( before & 1u ) != 0u )
+        {
+            return false;
+        }
+        for ( uint32 i( 0u ); i < WORD_COUNT; ++i )
+        {
+            words[ i ] = _Words[ i ].load( std::memory_order_relaxed );
+        }
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if ( _Sequence.load( std::memory_order_relaxed ) != before )
+        {
+            return false;
+        }
+        std::memcpy( &value, words, sizeof( T ) );
+        return true;
+    }
+
+    /** \brief Reader side, copies the value, retrying until it is
+    * consistent.
+    */
+    T load() const
+    {
+        T value;
+        while ( !tryLoad( value ) )
+        {
+        }
+        return value;
+    }
+
+    /** \brief Getter for the number of completed writes.
+    */
+    uint32 version() const
+    {
+        return _Sequence.load( std::memory_order_acquire ) / 2u;
+    }
+
+private:
+    std::atomic< uint32 > _Sequence;
+    std::atomic< uint64 > _Words[ WORD_COUNT ];
+};
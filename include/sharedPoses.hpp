@@ -0,0 +1,218 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file sharedPoses.hpp
+ *   \brief Latest marker poses published in shared memory for other
+ *   processes.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include "poseStore.hpp"
+
+#include <ftkInterface.h>
+
+#include <string>
+
+/** \brief Current version of the shared memory layout, readers refuse other
+ * versions.
+ */
+#define SHARED_POSES_VERSION 1u
+
+/** \brief Pose of one geometry in a SharedPoseFrame.
+ */
+struct SharedPose
+{
+    uint32 geometryId;
+    float32 registrationErrorMM;
+    float32 translationMM[ 3u ];
+
+    /** \brief Rotation matrix, same convention as ftkMarker::rotation.
+    */
+    float32 rotation[ 3u ][ 3u ];
+};
+
+/** \brief Frame published in shared memory.
+ */
+struct SharedPoseFrame
+{
+    /** \brief Device the frame comes from.
+    */
+    uint64 serialNumber;
+
+    /** \brief Device timestamp of the frame, in microseconds.
+    */
+    uint64 timestampUS;
+
+    /** \brief Host time ftkGetLastFrame returned the frame, see
+    * latencyClockNS(), which is shared by all the processes of the host.
+    */
+    int64 receivedNS;
+
+    /** \brief Host time the frame was published, see latencyClockNS().
+    */
+    int64 publishedNS;
+
+    /** \brief Device counter of the frame.
+    */
+    uint32 counter;
+
+    /** \brief Status of the marker query of the frame.
+    */
+    int32 markersStat;
+
+    /** \brief Number of valid entries in \c poses.
+    */
+    uint32 count;
+    uint32 reserved;
+    SharedPose poses[ MAX_TRACKED_MARKERS ];
+
+    /** \brief Looks for the pose of a given geometry.
+    *
+    * \param[in] id geometry ID to look for.
+    *
+    * \return the pose, \c nullptr if the geometry is not in the frame.
+    */
+    const SharedPose* find( uint32 id ) const;
+};
+
+/** \brief Class publishing the latest frame in a named shared memory
+ * segment.
+ *
+ * The segment holds one SharedPoseFrame behind a seqlock, see Seqlock: the
+ * writer never waits for the readers, whatever their number, and a
+ * publication is a plain copy of the frame into the mapped memory, without
+ * system call. The segment is a POSIX shared memory object, or a named file
+ * mapping on Windows, removed when the publisher closes it.
+ *
+ * \code
+ * SharedPosePublisher publisher;
+ * if ( publisher.open( "spryTrackPoses" ) )
+ * {
+ *     publisher.publish( filtered, sn );   // frame loop
+ * }
+ * \endcode
+ */
+class SharedPosePublisher
+{
+public:
+
+    /** \brief Default constructor, no segment is created.
+    */
+    SharedPosePublisher();
+
+    /** \brief Destructor, removes the segment.
+    */
+    ~SharedPosePublisher();
+
+    SharedPosePublisher( const SharedPosePublisher& ) = delete;
+    SharedPosePublisher& operator=( const SharedPosePublisher& ) = delete;
+
+    /** \brief Creates the segment.
+    *
+    * \param[in] name name of the segment, without leading slash.
+    *
+    * \retval true if the segment is ready,
+    * \retval false if it could not be created or mapped.
+    */
+    bool open( const std::string& name );
+
+    /** \brief Removes the segment, opened readers keep their mapping.
+    */
+    void close();
+
+    /** \brief Getter for the state of the segment.
+    */
+    bool isOpen() const;
+
+    /** \brief Publishes a frame, to be called from a single thread.
+    *
+    * \param[in] poses poses of the frame.
+    * \param[in] sn serial number of the device of the frame.
+    */
+    void publish( const PoseStore& poses, uint64 sn );
+
+    /** \brief Getter for the number of published frames.
+    */
+    uint64 publishedFrames() const;
+
+private:
+    std::string _Name;
+    void* _Handle;
+    void* _Segment;
+    uint64 _Published;
+    SharedPoseFrame _Frame;
+};
+
+/** \brief Class reading the frames of a SharedPosePublisher from another
+ * process.
+ *
+ * Once opened, reads only access the mapped memory: no system call, and
+ * only the bytes of the frame are copied. A read retries while the
+ * publisher is writing, which lasts a few hundred nanoseconds.
+ *
+ * \code
+ * SharedPoseReader reader;
+ * SharedPoseFrame frame;
+ * uint32 seen( 0u );
+ * if ( reader.open( "spryTrackPoses" ) && reader.version() != seen && reader.read( frame ) )
+ * {
+ *     seen = reader.version();
+ *     const SharedPose* pose( frame.find( 110u ) );
+ * }
+ * \endcode
+ */
+class SharedPoseReader
+{
+public:
+
+    /** \brief Default constructor, no segment is opened.
+    */
+    SharedPoseReader();
+
+    /** \brief Destructor, unmaps the segment.
+    */
+    ~SharedPoseReader();
+
+    SharedPoseReader( const SharedPoseReader& ) = delete;
+    SharedPoseReader& operator=( const SharedPoseReader& ) = delete;
+
+    /** \brief Maps the segment of a publisher, read-only.
+    *
+    * \param[in] name name given to SharedPosePublisher::open.
+    *
+    * \retval true if the segment is mapped,
+    * \retval false if it does not exist or has another layout version.
+    */
+    bool open( const std::string& name );
+
+    /** \brief Unmaps the segment.
+    */
+    void close();
+
+    /** \brief Getter for the state of the mapping.
+    */
+    bool isOpen() const;
+
+    /** \brief Getter for the number of frames published so far, to detect
+    * new frames without reading them.
+    */
+    uint32 version() const;
+
+    /** \brief Copies the latest frame.
+    *
+    * \param[out] frame where the frame is copied.
+    *
+    * \retval true if \c frame is consistent,
+    * \retval false if the segment is not mapped or nothing was published
+    * yet.
+    */
+    bool read( SharedPoseFrame& frame ) const;
+
+private:
+    void* _Handle;
+    const void* _Segment;
+};
@@ -0,0 +1,191 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file spscRing.hpp
+ *   \brief Fixed-capacity lock-free single-producer / single-consumer ring.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkTypes.h>
+
+#include <atomic>
+
+/** \brief Size of a cache line, used to keep producer and consumer indices
+ * apart.
+ */
+#define SPSC_CACHE_LINE 64
+
+/** \brief Bounded lock-free ring for exactly one producer and one consumer.
+ *
+ * All slots are allocated with the ring, push and pop never allocate nor
+ * lock. The producer may either copy an item in with tryPush() or fill the
+ * next slot in place with beginPush() / commitPush(); the consumer may
+ * either copy an item out with tryPop() or read it in place with front() /
+ * popFront().
+ *
+ * \code
+ * SpscRing< Item, 256u > ring;
+ * // producer thread
+ * Item* slot( ring.beginPush() );
+ * if ( slot != nullptr )
+ * {
+ *     fill( *slot );
+ *     ring.commitPush();
+ * }
+ * // consumer thread
+ * const Item* item( ring.front() );
+ * if ( item != nullptr )
+ * {
+ *     use( *item );
+ *     ring.popFront();
+ * }
+ * \endcode
+ *
+ * \tparam T type of the stored items, must be default constructible.
+ * \tparam Capacity number of slots, must be a power of two.
+ */
+template< typename T, uint32 Capacity >
+class SpscRing
+{
+    static_assert( Capacity >= 2u && ( Capacity & ( Capacity - 1u ) ) == 0u,
+                   "SpscRing capacity must be a power of two" );
+
+public:
+
+    /** \brief Default constructor, the ring is empty.
+    */
+    SpscRing()
+        : _Tail( 0u )
+        , _CachedHead( 0u )
+        , _Head( 0u )
+        , _CachedTail( 0u )
+    {}
+
+    SpscRing( const SpscRing& ) = delete;
+    SpscRing& operator=( const SpscRing& ) = delete;
+
+    /** \brief Producer side, gives access to the next free slot.
+    *
+    * \return a pointer on the slot to fill, \c nullptr if the ring is full.
+    */
+    T* beginPush()
+    {
+        const uint32 tail( _Tail.load( std::memory_order_relaxed ) );
+        if ( tail - _CachedHead == Capacity )
+        {
+            _CachedHead = _Head.load( std::memory_order_acquire );
+            if ( tail - _CachedHead == Capacity )
+            {
+                return nullptr;
+            }
+        }
+        return &_Slots[ tail & ( Capacity - 1u ) ];
+    }
+
+    /** \brief Producer side, publishes the slot obtained from beginPush().
+    */
+    void commitPush()
+    {
+        _Tail.store( _Tail.load( std::memory_order_relaxed ) + 1u,
+                     std::memory_order_release );
+    }
+
+    /** \brief Producer side, copies an item in the ring.
+    *
+    * \param[in] item item to be copied.
+    *
+    * \retval true if the item was pushed,
+    * \retval false if the ring is full.
+    */
+    bool tryPush( const T& item )
+    {
+        T* slot( beginPush() );
+        if ( slot == nullptr )
+        {
+            return false;
+        }
+        *slot = item;
+        commitPush();
+        return true;
+    }
+
+    /** \brief Consumer side, gives access to the oldest item.
+    *
+    * \return a pointer on the oldest item, \c nullptr if the ring is empty.
+    * The pointer stays valid until popFront() is called.
+    */
+    T* front()
+    {
+        const uint32 head( _Head.load( std::memory_order_relaxed ) );
+        if ( head == _CachedTail )
+        {
+            _CachedTail = _Tail.load( std::memory_order_acquire );
+            if ( head == _CachedTail )
+            {
+                return nullptr;
+            }
+        }
+        return &_Slots[ head & ( Capacity - 1u ) ];
+    }
+
+    /** \brief Consumer side, releases the item obtained from front().
+    */
+    void popFront()
+    {
+        _Head.store( _Head.load( std::memory_order_relaxed ) + 1u,
+                     std::memory_order_release );
+    }
+
+    /** \brief Consumer side, copies the oldest item out of the ring.
+    *
+    * \param[out] item where the item is copied.
+    *
+    * \retval true if an item was popped,
+    * \retval false if the ring is empty.
+    */
+    bool tryPop( T& item )
+    {
+        T* slot( front() );
+        if ( slot == nullptr )
+        {
+            return false;
+        }
+        item = *slot;
+        popFront();
+        return true;
+    }
+
+    /** \brief Approximate number of stored items, exact only when called
+    * from the producer or the consumer while the other side is idle.
+    */
+    uint32 size() const
+    {
+        return _Tail.load( std::memory_order_acquire ) -
+               _Head.load( std::memory_order_acquire );
+    }
+
+    /** \brief Getter for the emptiness of the ring, see size().
+    */
+    bool empty() const
+    {
+        return size() == 0u;
+    }
+
+    /** \brief Getter for the number of slots.
+    */
+    static constexpr uint32 capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    alignas( SPSC_CACHE_LINE ) std::atomic< uint32 > _Tail;
+    uint32 _CachedHead;
+    alignas( SPSC_CACHE_LINE ) std::atomic< uint32 > _Head;
+    uint32 _CachedTail;
+    alignas( SPSC_CACHE_LINE ) T _Slots[ Capacity ];
+};
@@ -0,0 +1,135 @@
+// ============================================================================
+
+/*!
+ *
+ *   \file syntheticTracker.hpp
+ *   \brief Configuration of the synthetic tracker backend.
+ *
+ *   src/syntheticTracker.cpp implements the subset of the fusionTrack API
+ *   used by this project (ftkInit, ftkEnumerateDevices, ftkGetLastFrame,
+ *   ftkSetRigidBody, the option getters and setters, ...) without any
+ *   device. It is built as the syntheticTrack64 static library and linked
+ *   in place of fusionTrack64.lib, e.g.
+ *   \code
+ *   msbuild SpryTrackSDK.sln /p:FtkLibrary=syntheticTrack64.lib
+ *   \endcode
+ *
+ *   The backend simulates DeviceCount spryTrack 300 devices, each one
+ *   seeing BodyCount rigid bodies moving on scripted trajectories, with
+ *   gaussian noise, at FrameRateHz. The registered rigid bodies are used, in
+ *   registration order, for the first bodies. Given the same configuration,
+ *   the same frame counter always yields the same poses, so the numbers are
+ *   reproducible.
+ *
+ */
+// ============================================================================
+
+#pragma once
+
+#include <ftkTypes.h>
+
+#include <string>
+
+/** \brief Trajectories of the synthetic rigid bodies.
+ */
+enum class SyntheticTrajectory : uint32
+{
+    /** \brief Body standing still, only noise is added.
+    */
+    Static = 0u,
+
+    /** \brief Circle in the plane facing the camera.
+    */
+    Circle = 1u,
+
+    /** \brief 3D Lissajous curve.
+    */
+    Lissajous = 2u,
+
+    /** \brief Back and forth motion along the X axis.
+    */
+    Linear = 3u
+};
+
+/** \brief Parameters of the synthetic backend.
+ */
+struct SyntheticTrackerConfig
+{
+    /** \brief Default constructor, one device at the nominal spryTrack 300
+    * rate seeing four bodies.
+    */
+    SyntheticTrackerConfig()
+        : DeviceCount( 1u )
+        , FrameRateHz( 300u )
+        , BodyCount( 4u )
+        , Trajectory( SyntheticTrajectory::Circle )
+        , AmplitudeMM( 50.0f )
+        , FrequencyHz( 0.25f )
+        , NoiseMM( 0.05f )
+        , NoiseDeg( 0.02f )
+        , DropoutProbability( 0.0f )
+        , Seed( 1u )
+    {}
+
+    /** \brief Number of enumerated devices.
+    */
+    uint32 DeviceCount;
+
+    /** \brief Frame rate of every device, 0 to produce a new frame at each
+    * ftkGetLastFrame call.
+    */
+    uint32 FrameRateHz;
+
+    /** \brief Number of rigid bodies in the scene.
+    */
+    uint32 BodyCount;
+
+    /** \brief Trajectory followed by all bodies, with a per-body phase.
+    */
+    SyntheticTrajectory Trajectory;
+
+    /** \brief Amplitude of the trajectory, in millimetres.
+    */
+    float32 AmplitudeMM;
+
+    /** \brief Frequency of the trajectory, in hertz.
+    */
+    float32 FrequencyHz;
+
+    /** \brief Standard deviation of the translation noise, in millimetres.
+    */
+    float32 NoiseMM;
+
+    /** \brief Standard deviation of the rotation noise, in degrees.
+    */
+    float32 NoiseDeg;
+
+    /** \brief Probability for a body to be missing in a frame.
+    */
+    float32 DropoutProbability;
+
+    /** \brief Seed of the noise generator.
+    */
+    uint32 Seed;
+};
+
+/** \brief Sets the configuration used by the next ftkInit / ftkInitExt.
+ *
+ * \param[in] config parameters of the simulation.
+ */
+void setSyntheticTrackerConfig( const SyntheticTrackerConfig& config );
+
+/** \brief Reads a configuration file.
+ *
+ * The file contains one \c key \c = \c value pair per line, keys being the
+ * names of the SyntheticTrackerConfig members; empty lines and lines
+ * starting with \c # are ignored. ftkInitExt uses this function when given
+ * a file name.
+ *
+ * \param[in] path path of the file.
+ * \param[in,out] config configuration to update.
+ *
+ * \retval true if the file could be read,
+ * \retval false if the file cannot be opened or contains an unknown key.
+ */
+bool loadSyntheticTrackerConfig( const std::string& path, SyntheticTrackerConfig& config );
@@ -1,6 +1,16 @@
 #include "helpers.hpp"
+#include "logger.hpp"
 #include "geometryHelper.hpp"
+#include "geometryRegistry.hpp"
+#include "multiDeviceAcquisition.hpp"
+#include "optionProfile.hpp"
+#include "poseFilter.hpp"
+#include "posePredictor.hpp"
+#include "poseStream.hpp"
+#include "relativePoseEngine.hpp"
+#include "sharedPoses.hpp"
 #include <iostream>
+#include <sstream>
 #define FORCED_DEVICE_DLL_PATH "G:\spryTrack SDK x64\bin"
 
 #ifdef FORCED_DEVICE_DLL_PATH
@@ -28,117 +38,407 @@ int main(int argc, char** argv)
 		error("Cannot initialize driver");
 	}
 
-	// check current global options
-	enumerateOptions(lib, 0uLL);
+	// a recording can be replayed instead of acquiring from a device
+	ReplayFrameSource replay;
+	bool fromRecording(argc > 2 && string(argv[1]) == "--replay");
+	if (fromRecording && !replay.open(argv[2], argc > 3 ? atof(argv[3]) : 1.0))
+	{
+		error("Cannot open recording");
+	}
+	vector<uint64> serials(1u, replay.serialNumber());
 
-	//retrieve the device and device number
-	DeviceData device(retrieveLastDevice(lib));
-	uint64 sn(device.SerialNumber);
+	if (!fromRecording)
+	{
+		// check current global options
+		enumerateOptions(lib, 0uLL);
 
-	//check all device-related options
-	cout << "List available options:" << endl << endl;
-	//enumerateOptions(lib, sn);
+		//retrieve all the devices, each one gets its own acquisition thread
+		serials.clear();
+		for (const DeviceData& device : retrieveDevices(lib))
+		{
+			serials.push_back(device.SerialNumber);
+		}
 
+		// load the geometry files once, in parallel, for all the devices
+		//parsed geometries are cached to speed up the next starts
+		GeometryCache geometryCache;
+		geometryCache.open("geometries.cache");
+		GeometryRegistry geometries(lib);
+		geometries.setCache(&geometryCache);
+		if (!geometries.loadFiles({ "geometry110.ini" }))
+		{
+			geometries.printReport(cerr);
+			error("Cannot load geometry files");
+		}
+		geometries.printReport(cout);
 
-	// set custon option values
-	setOptionValue(lib, sn, 10, 2173);
-	setOptionValue(lib, sn, 11, 110);
-	//waitForKeyboardHit();
+		// custom option values come from the "default" profile of options.ini,
+		//the values below are used when the file is missing
+		vector<OptionProfile> profiles;
+		if (!loadOptionProfiles("options.ini", profiles))
+		{
+			istringstream defaults("[default]\n10 = 2173\n11 = 110\n");
+			readOptionProfiles(defaults, profiles);
+		}
+		const OptionProfile* profile(findOptionProfile(profiles, "default"));
+		if (profile == nullptr)
+		{
+			error("No default option profile");
+		}
 
-	cout << "List available options:" << endl << endl;
-	enumerateOptions(lib, sn);
-	waitForKeyboardHit();
+		for (uint64 sn : serials)
+		{
+			// the options are enumerated once, the profile only writes the
+			//values which differ
+			OptionCatalog options;
+			if (!options.build(lib, sn))
+			{
+				checkError(lib);
+			}
+			const OptionApplyReport report(applyOptionProfile(options, *profile));
+			report.print(report.ok() ? cout : cerr);
 
-	// load and set geometry from file
-	ftkRigidBody geom{};
-	string geomFile = "geometry110.ini";
-	loadAndSetGeometryFile(lib, sn, geomFile, &geom);
+			//check all device-related options
+			cout << "List available options:" << endl << endl;
+			options.print(cout);
+			waitForKeyboardHit();
 
-	//initialize a frame to get marker pose
-	ftkFrameQuery* frame = ftkCreateFrame();
-	if (frame == 0)
-	{
-		cerr << "cannot create frame instance" << endl;
-		waitForKeyboardHit();
+			// set the loaded geometries
+			if (!geometries.registerAll(sn))
+			{
+				checkError(lib);
+			}
+		}
 	}
 
-	err = ftkSetFrameOptions(false, 0u, 16u, 16u, 0u, 16u, frame);
-	if (err != ftkError::FTK_OK)
+	//start one acquisition thread per device, each owns its frame queries
+	//and drains its device at full rate while this thread consumes the
+	//decoded markers, merged by timestamp
+	vector<FrameSource*> sources;
+	vector<unique_ptr<DeviceFrameSource>> liveSources;
+	if (fromRecording)
+	{
+		sources.push_back(&replay);
+	}
+	else
+	{
+		for (uint64 sn : serials)
+		{
+			liveSources.emplace_back(new DeviceFrameSource(lib, sn));
+			sources.push_back(liveSources.back().get());
+		}
+	}
+	//the reservations of the frame queries grow ahead of busy scenes and
+	//shrink back in quiet periods
+	MultiDeviceAcquisition::Settings settings;
+	settings.Engine.AdaptiveReservations = true;
+	//the raw 3D fiducials are only decoded on demand, with "--fiducials"
+	bool withFiducials(false);
+	for (int a(1); a < argc; ++a)
+	{
+		withFiducials = withFiducials || string(argv[a]) == "--fiducials";
+	}
+	if (withFiducials)
+	{
+		settings.Engine.Options.ThreeDFiducialsSize = MAX_TRACKED_FIDUCIALS;
+	}
+	//the images of the first device are captured with "--images <file>",
+	//compressed in the background straight from the frame queries
+	const char* imagesPath(nullptr);
+	for (int a(1); a + 1 < argc; ++a)
+	{
+		if (string(argv[a]) == "--images")
+		{
+			imagesPath = argv[a + 1];
+		}
+	}
+	settings.Engine.Options.Pixels = imagesPath != nullptr;
+	settings.Engine.CapturedFrames = imagesPath != nullptr ? ImageCapture::Settings().Slots : 0u;
+	//the lost frames counter of the devices is read with "--lost-frames <option ID>",
+	//otherwise only the gaps of the frame counter are counted
+	for (int a(1); a + 1 < argc; ++a)
+	{
+		if (string(argv[a]) == "--lost-frames")
+		{
+			settings.Engine.LostFramesOptionId = uint32(atoi(argv[a + 1]));
+		}
+	}
+	MultiDeviceAcquisition engine(sources, settings);
+	ImageCapture images;
+	if (imagesPath != nullptr && images.open(imagesPath, serials.front()))
+	{
+		engine.engine(0u).setImageCapture(&images);
+	}
+	FrameRecorder recorder;
+	if (argc > 2 && string(argv[1]) == "--record")
+	{
+		//only the first device is recorded
+		if (recorder.open(argv[2], serials.front()))
+		{
+			engine.engine(0u).setRecorder(&recorder);
+		}
+	}
+	if (!engine.start())
 	{
-		ftkDeleteFrame(frame);
 		checkError(lib);
 	}
+
+	//the markers are written by the logger thread, this loop never waits
+	//for the console
 	uint32 counter(50u);
-	cout.setf(ios::fixed, ios::floatfield);
-	cout.precision(2u);
-	for (uint32 u(0u), i; u < 100u; u++)
+	int64 nextLatencyDumpNS(latencyClockNS() + 1000000000);
+	vector<FrameAccountingSnapshot> accounting;
+	for (uint32 d(0u); d < engine.deviceCount(); ++d)
+	{
+		accounting.push_back(engine.engine(d).accounting().snapshot());
+	}
+	//the poses are filtered per device, two devices may track the same
+	//geometries
+	vector<PoseFilter> filters(engine.deviceCount());
+	vector<PosePredictor> predictors(engine.deviceCount());
+	PoseStore filtered;
+	//tools can also be reported in the frame of a reference geometry, with
+	//"--relative <tool> <reference>", repeated for each pair
+	vector<RelativePoseEngine> relatives(engine.deviceCount());
+	RelativePoses relative;
+	for (int a(1); a + 2 < argc; ++a)
 	{
-		err = ftkGetLastFrame(lib, sn, frame, 100);
-		if (err > ftkError::FTK_OK)
+		if (string(argv[a]) == "--relative")
 		{
-			cout << ".";
-			continue;
+			for (RelativePoseEngine& pairs : relatives)
+			{
+				pairs.addPair(uint32(atoi(argv[a + 1])), uint32(atoi(argv[a + 2])));
+			}
+			a += 2;
 		}
-		else if (err < ftkError::FTK_OK)
+	}
+	//other processes can read the latest filtered frame with a
+	//SharedPoseReader, with "--share <name>", each device has its own
+	//segment named "<name>_<serial number in hex>"
+	vector<SharedPosePublisher> shared(engine.deviceCount());
+	for (int a(1); a + 1 < argc; ++a)
+	{
+		if (string(argv[a]) == "--share")
 		{
-			cout << "warning: " <<  int32(err) << endl;
-			if (err == ftkError::FTK_WAR_NO_FRAME)
+			for (uint32 d(0u); d < engine.deviceCount(); ++d)
 			{
-				continue;
+				ostringstream name;
+				name << argv[a + 1] << "_" << hex << engine.serialNumber(d);
+				shared[d].open(name.str());
 			}
 		}
-
-		cout << "get frame"<<endl;
-		switch (frame->markersStat)
+	}
+	//and other machines can receive them with a PoseStreamClient, with
+	//"--stream <udp|tcp> <host> <port>", the host being the receiver with
+	//UDP and the address to listen on with TCP
+	PoseStreamServer stream;
+	for (int a(1); a + 3 < argc; ++a)
+	{
+		if (string(argv[a]) == "--stream")
 		{
-		case ftkQueryStatus::QS_WAR_SKIPPED:
-			ftkDeleteFrame(frame);
-			cerr << "marker fields in the frame are not set correctly" << endl;
-			checkError(lib);
-			break;
-		case ftkQueryStatus::QS_ERR_INVALID_RESERVED_SIZE:
-			ftkDeleteFrame(frame);
-			cerr << "marker reserved size is invalid" << endl;
-			checkError(lib);
-			break;
-		case ftkQueryStatus::QS_OK:
-			break;
-		default:
-			ftkDeleteFrame(frame);
-			cerr << "invalid query status" << endl;
-			checkError(lib);
+			PoseStreamServer::Settings streamSettings;
+			streamSettings.Protocol = string(argv[a + 1]) == "tcp" ? PoseStreamProtocol::Tcp : PoseStreamProtocol::Udp;
+			streamSettings.Host = argv[a + 2];
+			streamSettings.Port = uint16(atoi(argv[a + 3]));
+			stream.open(streamSettings);
 		}
+	}
+	//like the ftkGetLastFrame calls it replaces, each trial waits up to
+	//100 ms for a frame, and every frame consumed counts as a trial
+	for (uint32 u(0u), i; u < 100u; u++)
+	{
+		const PoseStore* frame(nullptr);
+		const int64 waitNS(latencyClockNS());
+		for (const int64 timeoutNS(waitNS + 100000000); frame == nullptr && latencyClockNS() < timeoutNS;)
+		{
+			//the latencies and lost frames rates of the last second are
+			//dumped once per second, the whole run is summarised at the end
+			if (latencyClockNS() >= nextLatencyDumpNS)
+			{
+				for (uint32 d(0u); d < engine.deviceCount(); ++d)
+				{
+					engine.engine(d).latency().log(engine.serialNumber(d), true);
+					engine.engine(d).accounting().log(engine.serialNumber(d), accounting[d]);
+				}
+				nextLatencyDumpNS += 1000000000;
+			}
+
+			//fiducials have their own stream, drained whatever the markers do
+			for (uint32 d(0u); d < engine.deviceCount(); ++d)
+			{
+				for (const FiducialStore* fiducials(engine.engine(d).frontFiducials()); fiducials != nullptr;
+					fiducials = engine.engine(d).frontFiducials())
+				{
+					LOG_INFO("get {} fiducials of frame {} from 0x{x}", fiducials->count, fiducials->counter,
+						engine.serialNumber(d));
+					engine.engine(d).popFrontFiducials();
+				}
+			}
 
-		if (frame->markersCount == 0)
+			//frames with invalid marker queries are not delivered, the
+			//engine keeps the status of the last one
+			for (uint32 d(0u); d < engine.deviceCount(); ++d)
+			{
+				switch (engine.engine(d).skippedStatus())
+				{
+				case ftkQueryStatus::QS_OK:
+					break;
+				case ftkQueryStatus::QS_WAR_SKIPPED:
+					engine.stop();
+					cerr << "marker fields in the frame are not set correctly" << endl;
+					checkError(lib);
+					break;
+				case ftkQueryStatus::QS_ERR_INVALID_RESERVED_SIZE:
+					engine.stop();
+					cerr << "marker reserved size is invalid" << endl;
+					checkError(lib);
+					break;
+				default:
+					engine.stop();
+					cerr << "invalid query status" << endl;
+					checkError(lib);
+				}
+			}
+
+			//the first 200 us of the wait only yield, a frame due soon is not
+			//delayed, then the thread sleeps not to burn a core next to the
+			//acquisition threads
+			frame = engine.front();
+			if (frame == nullptr)
+			{
+				if (latencyClockNS() - waitNS < 200000)
+				{
+					this_thread::yield();
+				}
+				else
+				{
+					this_thread::sleep_for(chrono::microseconds(500));
+				}
+			}
+		}
+		if (frame == nullptr)
 		{
-			cout << "0 detected marker" << endl;
-			sleep(1000);
 			continue;
 		}
 
 		if (frame->markersStat == ftkQueryStatus::QS_ERR_OVERFLOW)
 		{
-			cerr << "marker's buffer size is too small" << endl;
+			LOG_WARNING("marker's buffer size is too small");
+		}
 
+		if (frame->count == 0)
+		{
+			LOG_INFO("0 detected marker");
+			engine.popFront();
+			continue;
 		}
 
-		for (i = 0; i < frame->markersCount; i++)
+		//each processing step records when it finished, from the reception
+		//of the frame
+		const uint32 device(engine.frontDevice());
+		LatencyStats& latency(engine.engine(device).latency());
+		filters[device].filter(*frame, filtered);
+		latency.recordFinished(LatencyStage::Filter, filtered.receivedNS);
+		predictors[device].update(filtered);
+		latency.recordFinished(LatencyStage::Prediction, filtered.receivedNS);
+		if (shared[device].isOpen())
+		{
+			shared[device].publish(filtered, engine.frontSerialNumber());
+			latency.recordFinished(LatencyStage::Share, filtered.receivedNS);
+		}
+		if (stream.isOpen())
+		{
+			stream.push(filtered, engine.frontSerialNumber());
+			latency.recordFinished(LatencyStage::Stream, filtered.receivedNS);
+		}
+		LOG_INFO("get frame {} from 0x{x}", filtered.counter, engine.frontSerialNumber());
+		for (i = 0; i < filtered.count; i++)
 		{
-			ftkMarker marker = frame->markers[i];
-			cout.precision(2);
-			cout << endl;
-			cout << "geometry: " << marker.geometryId << ", trans(" <<
-				marker.translationMM[0] << " " << marker.translationMM[1] <<
-				" " << marker.translationMM[2] << "), error: ";
-			cout.precision(3u);
-			cout << marker.registrationErrorMM << endl;
+			LOG_INFO("geometry: {}, trans({.2} {.2} {.2}), error: {.3}", filtered.geometryId[i],
+				filtered.translationMM[0][i], filtered.translationMM[1][i], filtered.translationMM[2][i],
+				filtered.registrationErrorMM[i]);
 
+			//what a controller acting now would use instead of the frame pose
+			PosePrediction now;
+			if (predictors[device].predict(filtered.geometryId[i], latencyClockNS(), now))
+			{
+				LOG_INFO("geometry: {}, predicted trans({.2} {.2} {.2}) +/- {.2} mm, age {.2} ms", now.GeometryId,
+					now.TranslationMM[0], now.TranslationMM[1], now.TranslationMM[2], now.PositionBoundMM,
+					float64(now.AgeNS) * 1e-6);
+			}
 		}
+		relatives[device].compute(filtered, relative);
+		latency.recordFinished(LatencyStage::Relative, filtered.receivedNS);
+		for (i = 0; i < relative.count; i++)
+		{
+			if (relative.valid[i] != 0u)
+			{
+				LOG_INFO("geometry: {} in {}, trans({.2} {.2} {.2})", relative.toolId[i], relative.referenceId[i],
+					relative.translationMM[0][i], relative.translationMM[1][i], relative.translationMM[2][i]);
+			}
+		}
+		engine.popFront();
 		if (--counter == 0u)
 		{
 			break;
 		}
-		sleep(1000L);
+	}
+	engine.stop();
+	for (uint32 d(0u); d < engine.deviceCount(); ++d)
+	{
+		engine.engine(d).latency().log(engine.serialNumber(d));
+		const FrameAccountingSnapshot total(engine.engine(d).accounting().snapshot());
+		LOG_INFO("0x{x} {} frames, {} missed in {} gaps, {} timeouts, {} errors, {} overflows, {} skipped",
+			engine.serialNumber(d), total.Frames, total.MissedFrames, total.CounterGaps, total.Timeouts,
+			total.Errors, total.Overflows, total.SkippedQueries);
+		if (settings.Engine.LostFramesOptionId != 0u)
+		{
+			LOG_INFO("0x{x} {} frames lost by the device", engine.serialNumber(d), total.DeviceLostFrames);
+		}
+		LOG_INFO("0x{x} {} reservation changes", engine.serialNumber(d), engine.engine(d).reservationChanges());
+		if (withFiducials)
+		{
+			LOG_INFO("0x{x} {} fiducial frames dropped", engine.serialNumber(d),
+				engine.engine(d).droppedFiducialFrames());
+		}
+	}
+	Logger::instance().flush();
+	if (Logger::instance().droppedRecords() != 0u)
+	{
+		cerr << Logger::instance().droppedRecords() << " log records dropped" << endl;
+	}
+	cout << "acquired " << engine.acquiredFrames() << " frames, dropped " <<
+		engine.droppedFrames() << endl;
+	if (recorder.isOpen())
+	{
+		recorder.close();
+		cout << "recorded " << recorder.recordedFrames() << " frames to " << argv[2] <<
+			", dropped " << recorder.droppedFrames() << endl;
+	}
+
+	if (stream.isOpen())
+	{
+		stream.close();
+		cout << "streamed " << stream.sentFrames() << " frames in " << stream.sentPackets() << " packets, dropped " <<
+			stream.droppedFrames() << endl;
+	}
+
+	for (uint32 d(0u); d < engine.deviceCount(); ++d)
+	{
+		if (shared[d].isOpen())
+		{
+			cout << "published " << shared[d].publishedFrames() << " frames of 0x" << hex << engine.serialNumber(d) <<
+				dec << " in shared memory" << endl;
+			shared[d].close();
+		}
+	}
+
+	if (images.isOpen())
+	{
+		images.close();
+		cout << "captured " << images.writtenImages() << " image pairs to " << imagesPath << ", dropped " <<
+			images.droppedImages() << ", " << images.rawBytes() << " bytes compressed to " <<
+			images.writtenBytes() << endl;
 	}
 
 	if (counter != 0u)
@@ -153,7 +453,6 @@ int main(int argc, char** argv)
 	
 	
 	//close driver
-	ftkDeleteFrame(frame);
 	if (ftkClose(&lib) != ftkError::FTK_OK)
 	{
 		checkError(lib);
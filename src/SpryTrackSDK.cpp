@@ -25,6 +25,7 @@
  // =============================================================================
 
 #include "helpers.hpp"
+#include "optionHandle.hpp"
 
 #include <algorithm>
 #include <deque>
@@ -129,8 +130,17 @@ int main2(int argc, char** argv)
     DeviceData device(retrieveLastDevice(lib, true, false, !isNotFromConsole));
     uint64 sn(device.SerialNumber);
 
+    // Options are resolved once, the handles then call the SDK directly
+    OptionCatalog catalog;
+    Option<int32> temperatureIndex, copyLostFrames;
+    if (!catalog.build(lib, sn) || !temperatureIndex.resolve(catalog, OPTION_ID_TEMPERATURE_INDEX) ||
+        !copyLostFrames.resolve(catalog, OPTION_ID_COPY_LOST_FRAMES))
+    {
+        error("Cannot resolve the device options");
+    }
+
     // Set current temperature index
-    ftkSetInt32(lib, sn, 30, 1);
+    temperatureIndex.set(1);
 
     cout << "Waiting for 2 seconds" << endl;
     sleep(2500L);
@@ -139,7 +149,7 @@ int main2(int argc, char** argv)
     ftkDeleteFrame(frame);
 
     // Copying the counter of lost frames
-    ftkSetInt32(lib, sn, 68, 1);
+    copyLostFrames.set(1);
 
     // ----------------------------------------------------------------------
     // Enumerate options of the device
@@ -0,0 +1,369 @@
+#include "acquisitionEngine.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+
+#ifdef ATR_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+    bool pinCurrentThread( uint32 core )
+    {
+#ifdef ATR_WIN
+        return core < 64u && SetThreadAffinityMask( GetCurrentThread(), DWORD_PTR( 1u ) << core ) != 0u;
+#else
+        cpu_set_t cores;
+        CPU_ZERO( &cores );
+        CPU_SET( core, &cores );
+        return pthread_setaffinity_np( pthread_self(), sizeof( cores ), &cores ) == 0;
+#endif
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+AcquisitionEngine::AcquisitionEngine( ftkLibrary lib, uint64 sn, const Settings& settings )
+    : AcquisitionEngine( unique_ptr< DeviceFrameSource >( new DeviceFrameSource( lib, sn ) ), settings )
+{}
+
+AcquisitionEngine::AcquisitionEngine( FrameSource& source, const Settings& settings )
+    : AcquisitionEngine( unique_ptr< DeviceFrameSource >(), settings )
+{
+    _Source = &source;
+}
+
+AcquisitionEngine::AcquisitionEngine( unique_ptr< DeviceFrameSource > device, const Settings& settings )
+    : _DeviceSource( move( device ) )
+    , _Source( _DeviceSource.get() )
+    , _Settings( settings )
+    , _ScratchIndex( FramePool::INVALID_INDEX )
+    , _HeldIndex( FramePool::INVALID_INDEX )
+    , _ReadLostFrames( false )
+    , _Running( false )
+    , _Acquired( 0u )
+    , _LastError( int32( ftkError::FTK_OK ) )
+    , _SkippedStatus( int32( ftkQueryStatus::QS_OK ) )
+    , _Recorder( nullptr )
+    , _ImageCapture( nullptr )
+    , _FiducialDrops( 0u )
+    , _ReservationChanges( 0u )
+    , _Tuner( FrameOptions() )
+{
+    _Settings.Options.MarkersSize = min( _Settings.Options.MarkersSize, MAX_TRACKED_MARKERS );
+    _Settings.Options.ThreeDFiducialsSize = min( _Settings.Options.ThreeDFiducialsSize, MAX_TRACKED_FIDUCIALS );
+    _Settings.Reservations.MaxMarkersSize = min( _Settings.Reservations.MaxMarkersSize, MAX_TRACKED_MARKERS );
+    _Settings.Reservations.MaxThreeDFiducialsSize =
+      min( _Settings.Reservations.MaxThreeDFiducialsSize, MAX_TRACKED_FIDUCIALS );
+    _Settings.PublishedFrames = min( _Settings.PublishedFrames, FramePool::MAX_FRAMES - 1u );
+    _Settings.CapturedFrames = min( _Settings.CapturedFrames, FramePool::MAX_FRAMES - 1u - _Settings.PublishedFrames );
+}
+
+AcquisitionEngine::~AcquisitionEngine()
+{
+    stop();
+}
+
+bool AcquisitionEngine::start()
+{
+    if ( _Running.load() )
+    {
+        return true;
+    }
+
+    if ( !_Pool.create( _Settings.PublishedFrames + _Settings.CapturedFrames + 1u, _Settings.Options ) )
+    {
+        return false;
+    }
+    _ScratchIndex = _Pool.acquire();
+    _Tuner = ReservationTuner( _Settings.Options, _Settings.Reservations );
+
+    // The device is set up to count its lost frames here, off the
+    // acquisition thread which then only reads the counter.
+    uint64 lost( 0u );
+    _ReadLostFrames = _Settings.LostFramesPeriodMS != 0u && _Settings.LostFramesOptionId != 0u &&
+                      _Source->enableLostFrames( _Settings.LostFramesOptionId ) && _Source->lostFrames( lost );
+    if ( _ReadLostFrames )
+    {
+        _Accounting.setDeviceLostFrames( lost );
+    }
+
+    _Running.store( true );
+    _Thread = thread( &AcquisitionEngine::run, this );
+    return true;
+}
+
+void AcquisitionEngine::stop()
+{
+    _Running.store( false );
+    if ( _Thread.joinable() )
+    {
+        _Thread.join();
+    }
+    ImageCapture* images( _ImageCapture.load() );
+    if ( images != nullptr )
+    {
+        images->flush();
+    }
+    if ( _HeldIndex != FramePool::INVALID_INDEX )
+    {
+        _Pool.release( _HeldIndex );
+        _HeldIndex = FramePool::INVALID_INDEX;
+    }
+    uint32 index;
+    while ( _Published.tryPop( index ) )
+    {
+    }
+    _Pool.destroy();
+    _ScratchIndex = FramePool::INVALID_INDEX;
+}
+
+bool AcquisitionEngine::isRunning() const
+{
+    return _Running.load( memory_order_relaxed );
+}
+
+const PoseStore* AcquisitionEngine::front()
+{
+    return _Ring.front();
+}
+
+void AcquisitionEngine::popFront()
+{
+    const PoseStore* frame( _Ring.front() );
+    if ( frame != nullptr )
+    {
+        const int64 releasedNS( latencyClockNS() );
+        _Latency.record( LatencyStage::Consumer, releasedNS - frame->publishedNS );
+        _Latency.record( LatencyStage::EndToEnd, releasedNS - frame->receivedNS );
+    }
+    _Ring.popFront();
+}
+
+bool AcquisitionEngine::tryPop( PoseStore& frame )
+{
+    if ( !_Ring.tryPop( frame ) )
+    {
+        return false;
+    }
+    const int64 releasedNS( latencyClockNS() );
+    _Latency.record( LatencyStage::Consumer, releasedNS - frame.publishedNS );
+    _Latency.record( LatencyStage::EndToEnd, releasedNS - frame.receivedNS );
+    return true;
+}
+
+const FiducialStore* AcquisitionEngine::frontFiducials()
+{
+    return _Fiducials.front();
+}
+
+void AcquisitionEngine::popFrontFiducials()
+{
+    _Fiducials.popFront();
+}
+
+bool AcquisitionEngine::tryPopFiducials( FiducialStore& fiducials )
+{
+    return _Fiducials.tryPop( fiducials );
+}
+
+uint32 AcquisitionEngine::acquireFrame()
+{
+    uint32 index( FramePool::INVALID_INDEX );
+    _Published.tryPop( index );
+    return index;
+}
+
+const ftkFrameQuery* AcquisitionEngine::frame( uint32 index ) const
+{
+    return _Pool.frame( index );
+}
+
+void AcquisitionEngine::releaseFrame( uint32 index )
+{
+    _Pool.release( index );
+}
+
+void AcquisitionEngine::setRecorder( FrameRecorder* recorder )
+{
+    _Recorder.store( recorder );
+}
+
+void AcquisitionEngine::setImageCapture( ImageCapture* capture )
+{
+    _ImageCapture.store( capture );
+}
+
+uint64 AcquisitionEngine::acquiredFrames() const
+{
+    return _Acquired.load( memory_order_relaxed );
+}
+
+uint64 AcquisitionEngine::droppedFrames() const
+{
+    return _Accounting.ringDrops();
+}
+
+uint64 AcquisitionEngine::droppedFiducialFrames() const
+{
+    return _FiducialDrops.load( memory_order_relaxed );
+}
+
+uint64 AcquisitionEngine::reservationChanges() const
+{
+    return _ReservationChanges.load( memory_order_relaxed );
+}
+
+const FrameAccounting& AcquisitionEngine::accounting() const
+{
+    return _Accounting;
+}
+
+ftkError AcquisitionEngine::lastError() const
+{
+    return ftkError( _LastError.load( memory_order_relaxed ) );
+}
+
+ftkQueryStatus AcquisitionEngine::skippedStatus() const
+{
+    return ftkQueryStatus( _SkippedStatus.load( memory_order_relaxed ) );
+}
+
+LatencyStats& AcquisitionEngine::latency()
+{
+    return _Latency;
+}
+
+// ----------------------------------------------------------------------------
+
+void AcquisitionEngine::run()
+{
+    if ( _Settings.Core >= 0 && !pinCurrentThread( uint32( _Settings.Core ) ) )
+    {
+        LOG_ERROR( "Cannot pin the acquisition thread to core {}", _Settings.Core );
+    }
+
+    const int64 lostFramesPeriodNS( _ReadLostFrames ? int64( _Settings.LostFramesPeriodMS ) * 1000000 : 0 );
+    int64 lostFramesReadNS( latencyClockNS() );
+
+    uint32 index( FramePool::INVALID_INDEX );
+    while ( _Running.load( memory_order_relaxed ) )
+    {
+        ImageCapture* images( _ImageCapture.load( memory_order_acquire ) );
+        if ( index == FramePool::INVALID_INDEX && ( _Settings.PublishedFrames != 0u || images != nullptr ) )
+        {
+            index = _Pool.acquire();
+        }
+        const uint32 current( index == FramePool::INVALID_INDEX ? _ScratchIndex : index );
+        if ( _Settings.AdaptiveReservations && _Pool.options( current ) != _Tuner.options() &&
+             !_Pool.setOptions( current, _Tuner.options() ) )
+        {
+            LOG_ERROR( "Cannot resize the frame queries of 0x{x}, adaptive reservations disabled",
+                       _Source->serialNumber() );
+            _Settings.AdaptiveReservations = false;
+        }
+        ftkFrameQuery* frame( _Pool.frame( current ) );
+
+        const int64 queriedNS( latencyClockNS() );
+        ftkError err( _Source->getLastFrame( frame, _Settings.TimeoutMS ) );
+        const int64 receivedNS( latencyClockNS() );
+        if ( lostFramesPeriodNS != 0 && receivedNS - lostFramesReadNS >= lostFramesPeriodNS )
+        {
+            uint64 lost( 0u );
+            if ( _Source->lostFrames( lost ) )
+            {
+                _Accounting.setDeviceLostFrames( lost );
+            }
+            lostFramesReadNS = receivedNS;
+        }
+        if ( err != ftkError::FTK_OK )
+        {
+            _LastError.store( int32( err ), memory_order_relaxed );
+            if ( err > ftkError::FTK_OK || err == ftkError::FTK_WAR_NO_FRAME )
+            {
+                _Accounting.onNoFrame( err );
+                continue;
+            }
+        }
+        _Latency.record( LatencyStage::Query, receivedNS - queriedNS );
+        _Accounting.onFrame( *frame );
+        if ( _Settings.AdaptiveReservations && _Tuner.observe( *frame ) )
+        {
+            const FrameOptions& options( _Tuner.options() );
+            LOG_INFO( "0x{x} reservations: {} events, {} / {} raw data, {} fiducials, {} markers",
+                      _Source->serialNumber(), options.EventsSize, options.LeftRawDataSize,
+                      options.RightRawDataSize, options.ThreeDFiducialsSize, options.MarkersSize );
+            _ReservationChanges.fetch_add( 1u, memory_order_relaxed );
+        }
+
+        FrameRecorder* recorder( _Recorder.load( memory_order_acquire ) );
+        if ( recorder != nullptr )
+        {
+            recorder->record( *frame );
+        }
+
+        // The capture owns the frame from now on. It is only read for the
+        // rest of this iteration and cannot be acquired again before the
+        // next one.
+        if ( images != nullptr )
+        {
+            images->capture( _Pool, index );
+            index = FramePool::INVALID_INDEX;
+        }
+
+        if ( _Settings.Options.ThreeDFiducialsSize != 0u )
+        {
+            FiducialStore* fiducials( _Fiducials.beginPush() );
+            if ( fiducials == nullptr )
+            {
+                _FiducialDrops.fetch_add( 1u, memory_order_relaxed );
+            }
+            else
+            {
+                fiducials->fill( *frame );
+                fiducials->receivedNS = receivedNS;
+                _Fiducials.commitPush();
+            }
+        }
+
+        if ( !_Accounting.onMarkersStatus( frame->markersStat ) )
+        {
+            _SkippedStatus.store( int32( frame->markersStat ), memory_order_relaxed );
+            continue;
+        }
+
+        PoseStore* slot( _Ring.beginPush() );
+        if ( slot == nullptr )
+        {
+            _Accounting.onRingDrop();
+            continue;
+        }
+        slot->fill( *frame );
+        slot->receivedNS = receivedNS;
+        slot->publishedNS = latencyClockNS();
+        _Latency.recordTransfer( slot->timestampUS, receivedNS );
+        _Latency.record( LatencyStage::Decode, slot->publishedNS - receivedNS );
+        _Ring.commitPush();
+        _Acquired.fetch_add( 1u, memory_order_relaxed );
+
+        if ( index != FramePool::INVALID_INDEX && _Settings.PublishedFrames != 0u && _Published.tryPush( index ) )
+        {
+            index = FramePool::INVALID_INDEX;
+        }
+    }
+
+    // stop() gives the frame back once this thread is joined.
+    _HeldIndex = index;
+}
@@ -0,0 +1,598 @@
+// =============================================================================
+
+/*!
+ *
+ *   \file benchmark.cpp
+ *   \brief Micro-benchmarks of the per-frame processing, without camera.
+ *
+ *   Every benchmark runs on synthetic data: frame queries are filled by
+ *   hand, options are read from the synthetic tracker library and the
+ *   geometry is a file written next to the executable.
+ *
+ *   How to run this benchmark:
+ *   - Build the Benchmark project in Release, it links the SyntheticTracker
+ *     library by default
+ *   - Run the resulting executable, optionally with a benchmark name filter
+ *     and the minimal measurement time in milliseconds:
+ *     \code
+ *     Benchmark.exe [filter] [minTimeMS]
+ *     \endcode
+ *
+ *   One CSV line is written per benchmark on the standard output, after a
+ *   header line:
+ *   \code
+ *   benchmark,iterations,ns_per_op,allocs_per_op
+ *   pose_store_fill_16,640000,137.74,0.00
+ *   \endcode
+ *   ns_per_op is the median over BENCHMARK_REPETITIONS runs, allocs_per_op
+ *   counts the calls to the global operator new. Diagnostics go to the
+ *   standard error.
+ *
+ */
+// =============================================================================
+
+#include "fiducialStore.hpp"
+#include "frameAccounting.hpp"
+#include "geometryHelper.hpp"
+#include "helpers.hpp"
+#include "imageCapture.hpp"
+#include "latencyHistogram.hpp"
+#include "optionCatalog.hpp"
+#include "poseFilter.hpp"
+#include "posePredictor.hpp"
+#include "poseStore.hpp"
+#include "relativePoseEngine.hpp"
+
+#include <ftkInterface.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef ATR_WIN
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+/** \brief Number of measurements of each benchmark, the median is reported.
+ */
+#define BENCHMARK_REPETITIONS 5u
+
+/** \brief Default minimal duration of one measurement, in milliseconds.
+ */
+#define BENCHMARK_MIN_TIME_MS 100u
+
+// ----------------------------------------------------------------------------
+// Allocation counting, every global allocation of the process goes through
+// these operators.
+
+namespace
+{
+    atomic< uint64 > allocations( 0u );
+
+    void* countedAllocation( size_t size )
+    {
+        allocations.fetch_add( 1u, memory_order_relaxed );
+        void* ptr( malloc( size == 0u ? 1u : size ) );
+        if ( ptr == nullptr )
+        {
+            throw bad_alloc();
+        }
+        return ptr;
+    }
+
+    void* countedAlignedAllocation( size_t size, align_val_t alignment )
+    {
+        allocations.fetch_add( 1u, memory_order_relaxed );
+#ifdef ATR_WIN
+        void* ptr( _aligned_malloc( size == 0u ? 1u : size, size_t( alignment ) ) );
+#else
+        void* ptr( aligned_alloc( size_t( alignment ),
+                                  ( size + size_t( alignment ) - 1u ) / size_t( alignment ) * size_t( alignment ) ) );
+#endif
+        if ( ptr == nullptr )
+        {
+            throw bad_alloc();
+        }
+        return ptr;
+    }
+
+    void countedAlignedFree( void* ptr )
+    {
+#ifdef ATR_WIN
+        _aligned_free( ptr );
+#else
+        free( ptr );
+#endif
+    }
+}
+
+void* operator new( size_t size )
+{
+    return countedAllocation( size );
+}
+
+void* operator new[]( size_t size )
+{
+    return countedAllocation( size );
+}
+
+void* operator new( size_t size, align_val_t alignment )
+{
+    return countedAlignedAllocation( size, alignment );
+}
+
+void* operator new[]( size_t size, align_val_t alignment )
+{
+    return countedAlignedAllocation( size, alignment );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete[]( void* ptr ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete[]( void* ptr, size_t ) noexcept
+{
+    free( ptr );
+}
+
+void operator delete( void* ptr, align_val_t ) noexcept
+{
+    countedAlignedFree( ptr );
+}
+
+void operator delete[]( void* ptr, align_val_t ) noexcept
+{
+    countedAlignedFree( ptr );
+}
+
+void operator delete( void* ptr, size_t, align_val_t ) noexcept
+{
+    countedAlignedFree( ptr );
+}
+
+void operator delete[]( void* ptr, size_t, align_val_t ) noexcept
+{
+    countedAlignedFree( ptr );
+}
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+    /** \brief Result of the benchmarks, written to so that the compiler
+     * cannot drop the measured code.
+     */
+    volatile uint64 sink( 0u );
+
+    struct BenchmarkResult
+    {
+        BenchmarkResult()
+            : Iterations( 0u )
+            , NSPerOp( 0.0 )
+            , AllocsPerOp( 0.0 )
+        {}
+
+        uint64 Iterations;
+        float64 NSPerOp;
+        float64 AllocsPerOp;
+    };
+
+    /** \brief Runs a benchmark body, \c body( n ) must perform n operations.
+     */
+    BenchmarkResult measure( const function< uint64( uint64 ) >& body, uint32 minTimeMS )
+    {
+        const int64 minTimeNS( int64( minTimeMS ) * 1000000 );
+
+        // Grows the iteration count until one run lasts long enough.
+        uint64 iterations( 1u );
+        for ( ;; )
+        {
+            const int64 start( latencyClockNS() );
+            sink = sink + body( iterations );
+            const int64 elapsed( latencyClockNS() - start );
+            if ( elapsed >= minTimeNS || iterations >= ( uint64( 1u ) << 40u ) )
+            {
+                break;
+            }
+            iterations *= elapsed < minTimeNS / 100 ? 10u : 2u;
+        }
+
+        BenchmarkResult result;
+        result.Iterations = iterations;
+        vector< float64 > samples;
+        uint64 allocated( 0u );
+        for ( uint32 i( 0u ); i < BENCHMARK_REPETITIONS; ++i )
+        {
+            const uint64 allocationsBefore( allocations.load( memory_order_relaxed ) );
+            const int64 start( latencyClockNS() );
+            sink = sink + body( iterations );
+            const int64 elapsed( latencyClockNS() - start );
+            allocated += allocations.load( memory_order_relaxed ) - allocationsBefore;
+            samples.push_back( float64( elapsed ) / float64( iterations ) );
+        }
+        sort( samples.begin(), samples.end() );
+        result.NSPerOp = samples[ BENCHMARK_REPETITIONS / 2u ];
+        result.AllocsPerOp = float64( allocated ) / float64( iterations * BENCHMARK_REPETITIONS );
+        return result;
+    }
+
+    /** \brief Frame query pointing to local arrays, filled with a fixed set
+     * of markers.
+     */
+    struct SyntheticFrame
+    {
+        explicit SyntheticFrame( uint32 markerCount )
+            : Query{}
+            , Header{}
+            , Markers( markerCount )
+            , Fiducials( 4u * markerCount )
+        {
+            for ( uint32 i( 0u ); i < markerCount; ++i )
+            {
+                ftkMarker& marker( Markers[ i ] );
+                marker = ftkMarker{};
+                marker.geometryId = 100u + i;
+                marker.registrationErrorMM = 0.1f;
+                const float64 angle( 0.1 * float64( i ) );
+                marker.rotation[ 0u ][ 0u ] = float32( cos( angle ) );
+                marker.rotation[ 0u ][ 1u ] = float32( -sin( angle ) );
+                marker.rotation[ 1u ][ 0u ] = float32( sin( angle ) );
+                marker.rotation[ 1u ][ 1u ] = float32( cos( angle ) );
+                marker.rotation[ 2u ][ 2u ] = 1.0f;
+                marker.translationMM[ 0u ] = 10.0f * float32( i );
+                marker.translationMM[ 1u ] = -5.0f * float32( i );
+                marker.translationMM[ 2u ] = 1000.0f + float32( i );
+            }
+            for ( uint32 i( 0u ); i < Fiducials.size(); ++i )
+            {
+                ftk3DFiducial& fiducial( Fiducials[ i ] );
+                fiducial = ftk3DFiducial{};
+                fiducial.leftIndex = i;
+                fiducial.rightIndex = i;
+                fiducial.positionMM.x = 10.0f * float32( i / 4u ) + 29.0f * float32( i % 4u );
+                fiducial.positionMM.y = -5.0f * float32( i / 4u );
+                fiducial.positionMM.z = 1000.0f + float32( i / 4u );
+                fiducial.epipolarErrorPixels = 0.05f;
+                fiducial.triangulationErrorMM = 0.02f;
+                fiducial.probability = 1.0f;
+            }
+            Header.timestampUS = 1000000u;
+            Header.counter = 1u;
+            Query.imageHeader = &Header;
+            Query.imageHeaderStat = ftkQueryStatus::QS_OK;
+            Query.markers = Markers.data();
+            Query.markersCount = markerCount;
+            Query.markersVersionSize.ReservedSize = uint32( Markers.size() * sizeof( ftkMarker ) );
+            Query.markersStat = ftkQueryStatus::QS_OK;
+            Query.threeDFiducials = Fiducials.data();
+            Query.threeDFiducialsCount = uint32( Fiducials.size() );
+            Query.threeDFiducialsVersionSize.ReservedSize = uint32( Fiducials.size() * sizeof( ftk3DFiducial ) );
+            Query.threeDFiducialsStat = ftkQueryStatus::QS_OK;
+        }
+
+        ftkFrameQuery Query;
+        ftkImageHeader Header;
+        vector< ftkMarker > Markers;
+        vector< ftk3DFiducial > Fiducials;
+    };
+
+    const char* const ERROR_STRING =
+      "<ftkError>\n"
+      "<errors>\n"
+      "<error><code>14</code><message>Frame query is not initialised</message></error>\n"
+      "</errors>\n"
+      "<warnings>\n"
+      "<warning><code>-1</code><message>No new frame is available</message></warning>\n"
+      "</warnings>\n"
+      "<messages />\n"
+      "</ftkError>\n";
+
+    const char* const GEOMETRY_FILE = "benchmark_geometry.ini";
+
+    const char* const GEOMETRY_CONTENT =
+      "[geometry]\n"
+      "count=4\n"
+      "id=100\n"
+      "[fiducial0]\n"
+      "x=0.000000\n"
+      "y=0.000000\n"
+      "z=0.000000\n"
+      "[fiducial1]\n"
+      "x=29.000000\n"
+      "y=0.000000\n"
+      "z=0.000000\n"
+      "[fiducial2]\n"
+      "x=0.000000\n"
+      "y=59.000000\n"
+      "z=0.000000\n"
+      "[fiducial3]\n"
+      "x=-21.000000\n"
+      "y=0.000000\n"
+      "z=36.000000\n";
+
+    void deviceCallback( uint64 sn, void* user, ftkDeviceType )
+    {
+        uint64* lastDevice( reinterpret_cast< uint64* >( user ) );
+        if ( *lastDevice == 0uLL )
+        {
+            *lastDevice = sn;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+int main( int argc, char** argv )
+{
+    const string filter( argc > 1 ? argv[ 1 ] : "" );
+    const uint32 minTimeMS( argc > 2 ? uint32( strtoul( argv[ 2 ], nullptr, 10 ) ) : BENCHMARK_MIN_TIME_MS );
+
+    vector< pair< string, function< uint64( uint64 ) > > > benchmarks;
+
+    // Marker extraction, as done by the acquisition thread for every frame.
+    static PoseStore store;
+    for ( uint32 markerCount : { 1u, 4u, 16u } )
+    {
+        shared_ptr< SyntheticFrame > frame( make_shared< SyntheticFrame >( markerCount ) );
+        benchmarks.emplace_back( "pose_store_fill_" + to_string( markerCount ), [ frame ]( uint64 n ) {
+            uint64 result( 0u );
+            for ( uint64 i( 0u ); i < n; ++i )
+            {
+                frame->Header.counter = uint32( i );
+                store.fill( frame->Query );
+                result += store.count;
+            }
+            return result;
+        } );
+    }
+
+    // Same frames, the 3D fiducials of the markers: 4 per marker, so the
+    // last case is a full store.
+    static FiducialStore fiducials;
+    for ( uint32 markerCount : { 1u, 4u, 16u } )
+    {
+        shared_ptr< SyntheticFrame > frame( make_shared< SyntheticFrame >( markerCount ) );
+        benchmarks.emplace_back( "fiducial_store_fill_" + to_string( 4u * markerCount ), [ frame ]( uint64 n ) {
+            uint64 result( 0u );
+            for ( uint64 i( 0u ); i < n; ++i )
+            {
+                frame->Header.counter = uint32( i );
+                fiducials.fill( frame->Query );
+                result += fiducials.count;
+            }
+            return result;
+        } );
+    }
+
+    // Status checks and counter gap detection.
+    benchmarks.emplace_back( "frame_status_checks", []( uint64 n ) {
+        static FrameAccounting accounting;
+        static SyntheticFrame frame( 4u );
+        uint64 result( 0u );
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            frame.Header.counter = uint32( i + ( i & 0xffu ) / 0xffu );
+            frame.Query.markersStat = ( i & 0x3fu ) == 0u ? ftkQueryStatus::QS_ERR_OVERFLOW : ftkQueryStatus::QS_OK;
+            accounting.onFrame( frame.Query );
+            result += accounting.onMarkersStatus( frame.Query.markersStat ) ? 1u : 0u;
+        }
+        return result;
+    } );
+
+    // Lookup of a geometry and transformation of a tool tip in the camera
+    // frame.
+    benchmarks.emplace_back( "pose_find_transform_16", []( uint64 n ) {
+        static PoseStore poses;
+        static SyntheticFrame frame( 16u );
+        poses.fill( frame.Query );
+        const float32 tip[ 3u ] = { 0.0f, 0.0f, 150.0f };
+        float32 sum( 0.0f );
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            const int32 index( poses.find( 100u + uint32( i & 0xfu ) ) );
+            if ( index < 0 )
+            {
+                continue;
+            }
+            for ( uint32 r( 0u ); r < 3u; ++r )
+            {
+                float32 value( poses.translationMM[ r ][ index ] );
+                for ( uint32 c( 0u ); c < 3u; ++c )
+                {
+                    value += poses.rotation[ r ][ c ][ index ] * tip[ c ];
+                }
+                sum += value;
+            }
+        }
+        return uint64( sum );
+    } );
+
+    // Filtering of a full frame, the timestamp and a translation change every
+    // frame so that the filter state keeps moving.
+    benchmarks.emplace_back( "pose_filter_64", []( uint64 n ) {
+        static PoseFilter filter;
+        static PoseStore raw, filtered;
+        static SyntheticFrame frame( MAX_TRACKED_MARKERS );
+        raw.fill( frame.Query );
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            raw.timestampUS += 3000u;
+            raw.translationMM[ 0u ][ i & 0x3fu ] += ( i & 1u ) != 0u ? 0.1f : -0.1f;
+            filter.filter( raw, filtered );
+        }
+        return uint64( filtered.translationMM[ 0u ][ 0u ] );
+    } );
+
+    // Pose prediction, as queried by a control loop between two frames.
+    benchmarks.emplace_back( "pose_predict", []( uint64 n ) {
+        static PosePredictor predictor;
+        static PoseStore poses;
+        static SyntheticFrame frame( 16u );
+        poses.fill( frame.Query );
+        for ( uint32 i( 0u ); i < 4u; ++i )
+        {
+            poses.timestampUS += 3000u;
+            poses.receivedNS = int64( poses.timestampUS ) * 1000 + 500000;
+            poses.translationMM[ 0u ][ 15u ] += 0.3f;
+            predictor.update( poses );
+        }
+        PosePrediction prediction;
+        float32 sum( 0.0f );
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            if ( predictor.predict( 115u, poses.receivedNS + int64( i & 0xfffu ) * 1000, prediction ) )
+            {
+                sum += prediction.TranslationMM[ 0u ];
+            }
+        }
+        return uint64( sum );
+    } );
+
+    // Relative poses of 14 tools, each one registered with 2 references.
+    benchmarks.emplace_back( "relative_pose_28", []( uint64 n ) {
+        static RelativePoseEngine engine;
+        static PoseStore poses;
+        static RelativePoses relative;
+        static SyntheticFrame frame( 16u );
+        poses.fill( frame.Query );
+        engine.clearPairs();
+        for ( uint32 tool( 102u ); tool < 116u; ++tool )
+        {
+            engine.addPair( tool, 100u );
+            engine.addPair( tool, 101u );
+        }
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            poses.translationMM[ 0u ][ i & 0xfu ] += ( i & 1u ) != 0u ? 0.1f : -0.1f;
+            engine.compute( poses, relative );
+        }
+        return uint64( relative.translationMM[ 0u ][ 0u ] );
+    } );
+
+    // Compression of one spryTrack sized image: dark background, a few
+    // fiducial blobs and some sensor noise.
+    benchmarks.emplace_back( "image_compress_1280x800", []( uint64 n ) {
+        const uint32 width( 1280u ), height( 800u );
+        static vector< uint8 > pixels( width * height ), residuals( width * height ),
+          compressed( maxCompressedSize( width * height ) );
+        for ( uint32 i( 0u ); i < width * height; ++i )
+        {
+            const uint32 x( i % width ), y( i / width );
+            const bool blob( x % 160u < 6u && y % 100u < 6u );
+            pixels[ i ] = blob ? uint8( 200u + ( i & 0x1fu ) ) : uint8( ( i * 7u ) % 97u == 0u );
+        }
+        uint64 result( 0u );
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            result += compressImage( pixels.data(), width, height, 1u, residuals.data(), compressed.data() );
+        }
+        return result;
+    } );
+
+    // Parsing of the string returned by ftkGetLastErrorString.
+    benchmarks.emplace_back( "error_reader_parse", []( uint64 n ) {
+        const string errors( ERROR_STRING );
+        uint64 result( 0u );
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            ErrorReader reader;
+            if ( reader.parseErrorString( errors ) && !reader.isOk() )
+            {
+                ++result;
+            }
+        }
+        return result;
+    } );
+
+    // Geometry file loading.
+    {
+        ofstream geometry( GEOMETRY_FILE );
+        geometry << GEOMETRY_CONTENT;
+    }
+    benchmarks.emplace_back( "load_file_in_buffer", []( uint64 n ) {
+        static ftkBuffer buffer;
+        uint64 result( 0u );
+        for ( uint64 i( 0u ); i < n; ++i )
+        {
+            if ( loadFileInBuffer( GEOMETRY_FILE, buffer ) )
+            {
+                result += buffer.size;
+            }
+        }
+        return result;
+    } );
+
+    // Option lookups in the catalog of the synthetic device.
+    ftkLibrary lib( ftkInit() );
+    uint64 sn( 0uLL );
+    static OptionCatalog catalog;
+    if ( lib == nullptr || ftkEnumerateDevices( lib, deviceCallback, &sn ) > ftkError::FTK_OK || sn == 0uLL ||
+         !catalog.build( lib, sn ) || catalog.size() == 0u )
+    {
+        cerr << "No device, option lookups are not measured" << endl;
+    }
+    else
+    {
+        const string lastName( catalog[ catalog.size() - 1u ].Name );
+        const uint32 lastId( catalog[ catalog.size() - 1u ].Id );
+        benchmarks.emplace_back( "option_find_by_id", [ lastId ]( uint64 n ) {
+            uint64 result( 0u );
+            for ( uint64 i( 0u ); i < n; ++i )
+            {
+                result += catalog.find( lastId ) != nullptr ? 1u : 0u;
+            }
+            return result;
+        } );
+        benchmarks.emplace_back( "option_find_by_name", [ lastName ]( uint64 n ) {
+            uint64 result( 0u );
+            for ( uint64 i( 0u ); i < n; ++i )
+            {
+                result += catalog.find( lastName ) != nullptr ? 1u : 0u;
+            }
+            return result;
+        } );
+    }
+
+    cout << "benchmark,iterations,ns_per_op,allocs_per_op" << endl;
+    cout << fixed << setprecision( 2 );
+    for ( const pair< string, function< uint64( uint64 ) > >& benchmark : benchmarks )
+    {
+        if ( !filter.empty() && benchmark.first.find( filter ) == string::npos )
+        {
+            continue;
+        }
+        const BenchmarkResult result( measure( benchmark.second, minTimeMS ) );
+        cout << benchmark.first << "," << result.Iterations << "," << result.NSPerOp << ","
+             << result.AllocsPerOp << endl;
+    }
+
+    remove( GEOMETRY_FILE );
+    if ( lib != nullptr )
+    {
+        ftkClose( &lib );
+    }
+    return 0;
+}
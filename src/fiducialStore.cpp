@@ -0,0 +1,65 @@
+#include "fiducialStore.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+void FiducialStore::clear()
+{
+    timestampUS = 0u;
+    counter = 0u;
+    fiducialsStat = ftkQueryStatus::QS_OK;
+    count = 0u;
+    receivedNS = 0;
+}
+
+void FiducialStore::fill( const ftkFrameQuery& frame )
+{
+    if ( frame.imageHeader != nullptr )
+    {
+        timestampUS = frame.imageHeader->timestampUS;
+        counter = frame.imageHeader->counter;
+    }
+    else
+    {
+        timestampUS = 0u;
+        counter = 0u;
+    }
+    fiducialsStat = frame.threeDFiducialsStat;
+    count = frame.threeDFiducials != nullptr ? min( frame.threeDFiducialsCount, MAX_TRACKED_FIDUCIALS ) : 0u;
+
+    const ftk3DFiducial* fiducials( frame.threeDFiducials );
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        const ftk3DFiducial& fiducial( fiducials[ i ] );
+        positionMM[ 0u ][ i ] = static_cast< float32 >( fiducial.positionMM.x );
+        positionMM[ 1u ][ i ] = static_cast< float32 >( fiducial.positionMM.y );
+        positionMM[ 2u ][ i ] = static_cast< float32 >( fiducial.positionMM.z );
+        epipolarErrorPixels[ i ] = static_cast< float32 >( fiducial.epipolarErrorPixels );
+        triangulationErrorMM[ i ] = static_cast< float32 >( fiducial.triangulationErrorMM );
+        probability[ i ] = static_cast< float32 >( fiducial.probability );
+        leftIndex[ i ] = fiducial.leftIndex;
+        rightIndex[ i ] = fiducial.rightIndex;
+    }
+}
+
+int32 FiducialStore::nearest( const float32 pointMM[ 3u ], float32 maxDistanceMM ) const
+{
+    int32 best( -1 );
+    float32 bestSquared( maxDistanceMM * maxDistanceMM );
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        const float32 dx( positionMM[ 0u ][ i ] - pointMM[ 0u ] );
+        const float32 dy( positionMM[ 1u ][ i ] - pointMM[ 1u ] );
+        const float32 dz( positionMM[ 2u ][ i ] - pointMM[ 2u ] );
+        const float32 squared( dx * dx + dy * dy + dz * dz );
+        if ( squared <= bestSquared )
+        {
+            best = int32( i );
+            bestSquared = squared;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,146 @@
+#include "frameAccounting.hpp"
+
+#include "latencyHistogram.hpp"
+#include "logger.hpp"
+
+using namespace std;
+
+namespace
+{
+    // Only the acquisition thread writes the counters, a plain load and
+    // store is enough and avoids a locked instruction per frame.
+    void increment( atomic< uint64 >& counter, uint64 count = 1u )
+    {
+        counter.store( counter.load( memory_order_relaxed ) + count, memory_order_relaxed );
+    }
+
+    float64 rate( uint64 previous, uint64 current, float64 seconds )
+    {
+        return current >= previous ? float64( current - previous ) / seconds : 0.0;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+FrameAccounting::FrameAccounting()
+    : _Frames( 0u )
+    , _CounterGaps( 0u )
+    , _MissedFrames( 0u )
+    , _DeviceLostFrames( 0u )
+    , _Timeouts( 0u )
+    , _Errors( 0u )
+    , _Overflows( 0u )
+    , _SkippedQueries( 0u )
+    , _RingDrops( 0u )
+    , _LastCounter( 0u )
+    , _HasCounter( false )
+{}
+
+void FrameAccounting::onFrame( const ftkFrameQuery& frame )
+{
+    increment( _Frames );
+    if ( frame.imageHeader == nullptr )
+    {
+        return;
+    }
+    const uint32 counter( frame.imageHeader->counter );
+    if ( _HasCounter && counter != _LastCounter + 1u )
+    {
+        // A counter going backwards is a device restart or a replay loop,
+        // not a gap.
+        const uint32 missed( counter - _LastCounter - 1u );
+        if ( missed < 0x80000000u )
+        {
+            increment( _CounterGaps );
+            increment( _MissedFrames, missed );
+        }
+    }
+    _LastCounter = counter;
+    _HasCounter = true;
+}
+
+void FrameAccounting::onNoFrame( ftkError err )
+{
+    increment( err == ftkError::FTK_WAR_NO_FRAME ? _Timeouts : _Errors );
+}
+
+bool FrameAccounting::onMarkersStatus( ftkQueryStatus status )
+{
+    if ( status == ftkQueryStatus::QS_OK )
+    {
+        return true;
+    }
+    if ( status == ftkQueryStatus::QS_ERR_OVERFLOW )
+    {
+        increment( _Overflows );
+        return true;
+    }
+    increment( _SkippedQueries );
+    return false;
+}
+
+void FrameAccounting::onRingDrop()
+{
+    increment( _RingDrops );
+}
+
+void FrameAccounting::setDeviceLostFrames( uint64 count )
+{
+    _DeviceLostFrames.store( count, memory_order_relaxed );
+}
+
+uint64 FrameAccounting::ringDrops() const
+{
+    return _RingDrops.load( memory_order_relaxed );
+}
+
+FrameAccountingSnapshot FrameAccounting::snapshot() const
+{
+    FrameAccountingSnapshot result;
+    result.TimeNS = latencyClockNS();
+    result.Frames = _Frames.load( memory_order_relaxed );
+    result.CounterGaps = _CounterGaps.load( memory_order_relaxed );
+    result.MissedFrames = _MissedFrames.load( memory_order_relaxed );
+    result.DeviceLostFrames = _DeviceLostFrames.load( memory_order_relaxed );
+    result.Timeouts = _Timeouts.load( memory_order_relaxed );
+    result.Errors = _Errors.load( memory_order_relaxed );
+    result.Overflows = _Overflows.load( memory_order_relaxed );
+    result.SkippedQueries = _SkippedQueries.load( memory_order_relaxed );
+    result.RingDrops = _RingDrops.load( memory_order_relaxed );
+    return result;
+}
+
+void FrameAccounting::log( uint64 sn, FrameAccountingSnapshot& previous ) const
+{
+    const FrameAccountingSnapshot current( snapshot() );
+    const FrameAccountingRates perSecond( rates( previous, current ) );
+    LOG_INFO( "0x{x} frames {.1}/s, missed {.1}/s, device lost {}, timeouts {.1}/s, errors {.1}/s, "
+              "overflows {.1}/s, skipped {.1}/s",
+              sn, perSecond.Frames, perSecond.MissedFrames, current.DeviceLostFrames, perSecond.Timeouts,
+              perSecond.Errors, perSecond.Overflows, perSecond.SkippedQueries );
+    if ( current.RingDrops != previous.RingDrops )
+    {
+        LOG_WARNING( "0x{x} {.1} frames/s dropped, the consumer is too slow", sn, perSecond.RingDrops );
+    }
+    previous = current;
+}
+
+FrameAccountingRates FrameAccounting::rates( const FrameAccountingSnapshot& previous,
+                                             const FrameAccountingSnapshot& current )
+{
+    FrameAccountingRates result;
+    const float64 seconds( float64( current.TimeNS - previous.TimeNS ) * 1e-9 );
+    if ( seconds <= 0.0 )
+    {
+        return result;
+    }
+    result.Frames = rate( previous.Frames, current.Frames, seconds );
+    result.MissedFrames = rate( previous.MissedFrames, current.MissedFrames, seconds );
+    result.DeviceLostFrames = rate( previous.DeviceLostFrames, current.DeviceLostFrames, seconds );
+    result.Timeouts = rate( previous.Timeouts, current.Timeouts, seconds );
+    result.Errors = rate( previous.Errors, current.Errors, seconds );
+    result.Overflows = rate( previous.Overflows, current.Overflows, seconds );
+    result.SkippedQueries = rate( previous.SkippedQueries, current.SkippedQueries, seconds );
+    result.RingDrops = rate( previous.RingDrops, current.RingDrops, seconds );
+    return result;
+}
@@ -0,0 +1,127 @@
+#include "framePool.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+ftkError setFrameOptions( const FrameOptions& options, ftkFrameQuery* frame )
+{
+    return ftkSetFrameOptions( options.Pixels, options.EventsSize, options.LeftRawDataSize,
+                               options.RightRawDataSize, options.ThreeDFiducialsSize,
+                               options.MarkersSize, frame );
+}
+
+// ----------------------------------------------------------------------------
+
+FramePool::FramePool()
+    : _Count( 0u )
+{
+    for ( uint32 i( 0u ); i < MAX_FRAMES; ++i )
+    {
+        _Frames[ i ] = nullptr;
+    }
+}
+
+FramePool::~FramePool()
+{
+    destroy();
+}
+
+bool FramePool::create( uint32 count, const FrameOptions& options )
+{
+    destroy();
+    if ( count == 0u || count > MAX_FRAMES )
+    {
+        cerr << "invalid frame pool size " << count << endl;
+        return false;
+    }
+
+    _Options = options;
+    for ( ; _Count < count; ++_Count )
+    {
+        ftkFrameQuery* frame( ftkCreateFrame() );
+        if ( frame == nullptr )
+        {
+            cerr << "cannot create frame instance" << endl;
+            destroy();
+            return false;
+        }
+        _Frames[ _Count ] = frame;
+        _FrameOptions[ _Count ] = _Options;
+        if ( setFrameOptions( _Options, frame ) != ftkError::FTK_OK )
+        {
+            cerr << "cannot set frame options" << endl;
+            ++_Count;
+            destroy();
+            return false;
+        }
+        _Free.tryPush( _Count );
+    }
+
+    return true;
+}
+
+void FramePool::destroy()
+{
+    uint32 index;
+    while ( _Free.tryPop( index ) )
+    {
+    }
+    for ( uint32 i( 0u ); i < _Count; ++i )
+    {
+        ftkDeleteFrame( _Frames[ i ] );
+        _Frames[ i ] = nullptr;
+    }
+    _Count = 0u;
+}
+
+uint32 FramePool::acquire()
+{
+    uint32 index( INVALID_INDEX );
+    _Free.tryPop( index );
+    return index;
+}
+
+void FramePool::release( uint32 index )
+{
+    if ( index < _Count )
+    {
+        _Free.tryPush( index );
+    }
+}
+
+ftkFrameQuery* FramePool::frame( uint32 index ) const
+{
+    return index < _Count ? _Frames[ index ] : nullptr;
+}
+
+uint32 FramePool::size() const
+{
+    return _Count;
+}
+
+const FrameOptions& FramePool::options() const
+{
+    return _Options;
+}
+
+const FrameOptions& FramePool::options( uint32 index ) const
+{
+    return _FrameOptions[ index < _Count ? index : 0u ];
+}
+
+bool FramePool::setOptions( uint32 index, const FrameOptions& options )
+{
+    if ( index >= _Count )
+    {
+        return false;
+    }
+    if ( setFrameOptions( options, _Frames[ index ] ) != ftkError::FTK_OK )
+    {
+        return false;
+    }
+    _FrameOptions[ index ] = options;
+    return true;
+}
@@ -0,0 +1,287 @@
+#include "frameRecorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+FrameRecorder::FrameRecorder()
+    : _File( nullptr )
+    , _SerialNumber( 0u )
+    , _StartTimestampUS( 0u )
+    , _ChunkUsed( 0u )
+    , _Offset( 0u )
+    , _Failed( false )
+    , _Running( false )
+    , _Recorded( 0u )
+    , _Dropped( 0u )
+    , _Written( 0u )
+{}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+bool FrameRecorder::open( const string& path, uint64 sn, uint32 chunkSize )
+{
+    close();
+
+    _File = fopen( path.c_str(), "wb" );
+    if ( _File == nullptr )
+    {
+        cerr << "Could not create recording '" << path << "'" << endl;
+        return false;
+    }
+    // Chunks are written in one call, no need for the stdio buffer.
+    setvbuf( _File, nullptr, _IONBF, 0u );
+
+    if ( !_Ring )
+    {
+        _Ring.reset( new SpscRing< Slot, RING_CAPACITY >() );
+    }
+    while ( _Ring->front() != nullptr )
+    {
+        _Ring->popFront();
+    }
+    _Chunk.resize( max( chunkSize, uint32( sizeof( Slot ) ) ) );
+    _ChunkUsed = 0u;
+    _Offset = 0u;
+    _Index.clear();
+    _Index.reserve( 1u << 16u );
+    _Failed = false;
+    _SerialNumber = sn;
+    _StartTimestampUS = 0u;
+    _Recorded.store( 0u );
+    _Dropped.store( 0u );
+    _Written.store( 0u );
+
+    RecordingHeader header( makeHeader() );
+    append( &header, sizeof( header ) );
+
+    _Running.store( true );
+    _Thread = thread( &FrameRecorder::run, this );
+    return true;
+}
+
+bool FrameRecorder::close()
+{
+    if ( _File == nullptr )
+    {
+        return false;
+    }
+
+    _Running.store( false );
+    if ( _Thread.joinable() )
+    {
+        _Thread.join();
+    }
+
+    RecordingFooter footer{};
+    footer.indexOffset = _Offset;
+    footer.frameCount = _Index.size();
+    footer.magic = RECORDING_FOOTER_MAGIC;
+    for ( const RecordingIndexEntry& entry : _Index )
+    {
+        append( &entry, sizeof( entry ) );
+    }
+    append( &footer, sizeof( footer ) );
+    flush();
+
+    // The first timestamp is only known once frames were recorded.
+    if ( !_Failed && _StartTimestampUS != 0u )
+    {
+        RecordingHeader header( makeHeader() );
+        if ( fseek( _File, 0, SEEK_SET ) != 0 ||
+             fwrite( &header, sizeof( header ), 1u, _File ) != 1u )
+        {
+            _Failed = true;
+        }
+    }
+
+    fclose( _File );
+    _File = nullptr;
+    if ( _Failed )
+    {
+        cerr << "Could not write the recording" << endl;
+    }
+    return !_Failed;
+}
+
+bool FrameRecorder::isOpen() const
+{
+    return _File != nullptr;
+}
+
+bool FrameRecorder::record( const ftkFrameQuery& frame )
+{
+    if ( !_Running.load( memory_order_relaxed ) )
+    {
+        return false;
+    }
+
+    Slot* slot( _Ring->beginPush() );
+    if ( slot == nullptr )
+    {
+        _Dropped.fetch_add( 1u, memory_order_relaxed );
+        return false;
+    }
+
+    RecordedFrame& dst( slot->frame );
+    dst.magic = RECORDED_FRAME_MAGIC;
+    dst.timestampUS = frame.imageHeader != nullptr ? frame.imageHeader->timestampUS : 0u;
+    dst.counter = frame.imageHeader != nullptr ? frame.imageHeader->counter : 0u;
+    dst.markersStat = int32( frame.markersStat );
+    dst.fiducialsStat = int32( frame.threeDFiducialsStat );
+    dst.markersCount = frame.markers != nullptr ? min( frame.markersCount, MAX_TRACKED_MARKERS ) : 0u;
+    dst.fiducialsCount =
+      frame.threeDFiducials != nullptr ? min( frame.threeDFiducialsCount, MAX_RECORDED_FIDUCIALS ) : 0u;
+    dst.reserved = 0u;
+    dst.recordSize = sizeof( RecordedFrame ) + dst.markersCount * sizeof( RecordedMarker ) +
+                     dst.fiducialsCount * sizeof( RecordedFiducial );
+
+    for ( uint32 i( 0u ); i < dst.markersCount; ++i )
+    {
+        const ftkMarker& marker( frame.markers[ i ] );
+        RecordedMarker& out( slot->markers[ i ] );
+        out.id = marker.id;
+        out.geometryId = marker.geometryId;
+        out.geometryPresenceMask = marker.geometryPresenceMask;
+        out.registrationErrorMM = static_cast< float32 >( marker.registrationErrorMM );
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            out.translationMM[ r ] = static_cast< float32 >( marker.translationMM[ r ] );
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                out.rotation[ r ][ c ] = static_cast< float32 >( marker.rotation[ r ][ c ] );
+            }
+        }
+    }
+
+    for ( uint32 i( 0u ); i < dst.fiducialsCount; ++i )
+    {
+        const ftk3DFiducial& fiducial( frame.threeDFiducials[ i ] );
+        RecordedFiducial& out( slot->fiducials[ i ] );
+        out.leftIndex = fiducial.leftIndex;
+        out.rightIndex = fiducial.rightIndex;
+        out.positionMM[ 0u ] = static_cast< float32 >( fiducial.positionMM.x );
+        out.positionMM[ 1u ] = static_cast< float32 >( fiducial.positionMM.y );
+        out.positionMM[ 2u ] = static_cast< float32 >( fiducial.positionMM.z );
+        out.epipolarErrorPixels = static_cast< float32 >( fiducial.epipolarErrorPixels );
+        out.triangulationErrorMM = static_cast< float32 >( fiducial.triangulationErrorMM );
+        out.probability = static_cast< float32 >( fiducial.probability );
+    }
+
+    _Ring->commitPush();
+    return true;
+}
+
+uint64 FrameRecorder::recordedFrames() const
+{
+    return _Recorded.load( memory_order_relaxed );
+}
+
+uint64 FrameRecorder::droppedFrames() const
+{
+    return _Dropped.load( memory_order_relaxed );
+}
+
+uint64 FrameRecorder::writtenBytes() const
+{
+    return _Written.load( memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------------
+
+RecordingHeader FrameRecorder::makeHeader() const
+{
+    RecordingHeader header{};
+    header.magic = RECORDING_HEADER_MAGIC;
+    header.version = RECORDING_VERSION;
+    header.headerSize = sizeof( RecordingHeader );
+    header.serialNumber = _SerialNumber;
+    header.startTimestampUS = _StartTimestampUS;
+    header.markerRecordSize = sizeof( RecordedMarker );
+    header.fiducialRecordSize = sizeof( RecordedFiducial );
+    return header;
+}
+
+void FrameRecorder::run()
+{
+    for ( ;; )
+    {
+        const Slot* slot( _Ring->front() );
+        if ( slot == nullptr )
+        {
+            if ( !_Running.load( memory_order_acquire ) && _Ring->empty() )
+            {
+                break;
+            }
+            this_thread::sleep_for( chrono::milliseconds( 1 ) );
+            continue;
+        }
+        append( *slot );
+        _Ring->popFront();
+        _Recorded.fetch_add( 1u, memory_order_relaxed );
+    }
+}
+
+void FrameRecorder::append( const Slot& slot )
+{
+    if ( _StartTimestampUS == 0u )
+    {
+        _StartTimestampUS = slot.frame.timestampUS;
+    }
+
+    RecordingIndexEntry entry{};
+    entry.offset = _Offset;
+    entry.timestampUS = slot.frame.timestampUS;
+    entry.counter = slot.frame.counter;
+    _Index.push_back( entry );
+
+    append( &slot.frame, sizeof( RecordedFrame ) );
+    append( slot.markers, slot.frame.markersCount * sizeof( RecordedMarker ) );
+    append( slot.fiducials, slot.frame.fiducialsCount * sizeof( RecordedFiducial ) );
+}
+
+void FrameRecorder::append( const void* data, uint32 size )
+{
+    const char* src( static_cast< const char* >( data ) );
+    while ( size != 0u )
+    {
+        if ( _ChunkUsed == _Chunk.size() )
+        {
+            flush();
+        }
+        uint32 count( min( size, uint32( _Chunk.size() ) - _ChunkUsed ) );
+        memcpy( _Chunk.data() + _ChunkUsed, src, count );
+        _ChunkUsed += count;
+        _Offset += count;
+        src += count;
+        size -= count;
+    }
+}
+
+void FrameRecorder::flush()
+{
+    if ( _ChunkUsed == 0u )
+    {
+        return;
+    }
+    if ( !_Failed )
+    {
+        if ( fwrite( _Chunk.data(), 1u, _ChunkUsed, _File ) == _ChunkUsed )
+        {
+            _Written.fetch_add( _ChunkUsed, memory_order_relaxed );
+        }
+        else
+        {
+            _Failed = true;
+        }
+    }
+    _ChunkUsed = 0u;
+}
@@ -0,0 +1,215 @@
+#include "frameSource.hpp"
+
+#include "logger.hpp"
+#include "optionHandle.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+DeviceFrameSource::DeviceFrameSource( ftkLibrary lib, uint64 sn )
+    : _Library( lib )
+    , _SerialNumber( sn )
+    , _LostFramesId( 0u )
+{}
+
+ftkError DeviceFrameSource::getLastFrame( ftkFrameQuery* frame, uint32 timeoutMS )
+{
+    return ftkGetLastFrame( _Library, _SerialNumber, frame, timeoutMS );
+}
+
+uint64 DeviceFrameSource::serialNumber() const
+{
+    return _SerialNumber;
+}
+
+bool DeviceFrameSource::enableLostFrames( uint32 optionId )
+{
+    const ftkError err( ftkSetInt32( _Library, _SerialNumber, OPTION_ID_COPY_LOST_FRAMES, 1 ) );
+    if ( err != ftkError::FTK_OK )
+    {
+        LOG_WARNING( "Cannot turn the lost frames copy of 0x{x} on, error {}", _SerialNumber, int32( err ) );
+    }
+    _LostFramesId = optionId;
+    uint64 count( 0u );
+    if ( !lostFrames( count ) )
+    {
+        LOG_WARNING( "0x{x} cannot read option {}, its lost frames are not counted", _SerialNumber, optionId );
+        _LostFramesId = 0u;
+        return false;
+    }
+    return true;
+}
+
+bool DeviceFrameSource::lostFrames( uint64& count )
+{
+    int32 value( 0 );
+    if ( _LostFramesId == 0u ||
+         ftkGetInt32( _Library, _SerialNumber, _LostFramesId, &value, ftkOptionGetter::FTK_VALUE ) != ftkError::FTK_OK )
+    {
+        return false;
+    }
+    count = value < 0 ? 0u : uint64( value );
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+ReplayFrameSource::ReplayFrameSource()
+    : _Speed( 1.0 )
+    , _Loop( false )
+    , _Next( 0u )
+    , _FirstTimestampUS( 0u )
+{}
+
+bool ReplayFrameSource::open( const string& path, float64 speed, bool loop )
+{
+    if ( !_Reader.open( path ) )
+    {
+        return false;
+    }
+    _Speed = speed;
+    _Loop = loop;
+    restart();
+    return true;
+}
+
+bool ReplayFrameSource::finished() const
+{
+    return !_Loop && _Next >= _Reader.frameCount();
+}
+
+ftkError ReplayFrameSource::getLastFrame( ftkFrameQuery* frame, uint32 timeoutMS )
+{
+    if ( frame == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    if ( _Next >= _Reader.frameCount() )
+    {
+        if ( !_Loop || _Reader.frameCount() == 0u )
+        {
+            this_thread::sleep_for( chrono::milliseconds( timeoutMS ) );
+            return ftkError::FTK_WAR_NO_FRAME;
+        }
+        restart();
+    }
+
+    if ( _Speed > 0.0 )
+    {
+        const RecordingIndexEntry& entry( _Reader.entry( _Next ) );
+        const uint64 elapsedUS( entry.timestampUS > _FirstTimestampUS ? entry.timestampUS - _FirstTimestampUS
+                                                                        : 0u );
+        const chrono::steady_clock::time_point due(
+          _Start + chrono::microseconds( static_cast< int64 >( float64( elapsedUS ) / _Speed ) ) );
+        const chrono::steady_clock::time_point deadline(
+          chrono::steady_clock::now() + chrono::milliseconds( timeoutMS ) );
+        if ( due > deadline )
+        {
+            this_thread::sleep_until( deadline );
+            return ftkError::FTK_WAR_NO_FRAME;
+        }
+        this_thread::sleep_until( due );
+    }
+
+    fill( *_Reader.frame( _Next ), frame );
+    ++_Next;
+    return ftkError::FTK_OK;
+}
+
+uint64 ReplayFrameSource::serialNumber() const
+{
+    const RecordingHeader* header( _Reader.header() );
+    return header != nullptr ? header->serialNumber : 0u;
+}
+
+// ----------------------------------------------------------------------------
+
+void ReplayFrameSource::restart()
+{
+    _Next = 0u;
+    _FirstTimestampUS = _Reader.frameCount() != 0u ? _Reader.entry( 0u ).timestampUS : 0u;
+    _Start = chrono::steady_clock::now();
+}
+
+void ReplayFrameSource::fill( const RecordedFrame& recorded, ftkFrameQuery* frame ) const
+{
+    if ( frame->imageHeader != nullptr )
+    {
+        frame->imageHeader->timestampUS = recorded.timestampUS;
+        frame->imageHeader->counter = recorded.counter;
+        frame->imageHeaderStat = ftkQueryStatus::QS_OK;
+    }
+
+    const uint32 markersCapacity( frame->markers != nullptr
+                                    ? frame->markersVersionSize.ReservedSize / sizeof( ftkMarker )
+                                    : 0u );
+    const RecordedMarker* markers( _Reader.markers( recorded ) );
+    frame->markersCount = min( recorded.markersCount, markersCapacity );
+    for ( uint32 i( 0u ); i < frame->markersCount; ++i )
+    {
+        const RecordedMarker& src( markers[ i ] );
+        ftkMarker& dst( frame->markers[ i ] );
+        dst = ftkMarker{};
+        dst.id = src.id;
+        dst.geometryId = src.geometryId;
+        dst.geometryPresenceMask = src.geometryPresenceMask;
+        dst.registrationErrorMM = src.registrationErrorMM;
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            dst.translationMM[ r ] = src.translationMM[ r ];
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                dst.rotation[ r ][ c ] = src.rotation[ r ][ c ];
+            }
+        }
+    }
+    if ( markersCapacity == 0u )
+    {
+        frame->markersStat = ftkQueryStatus::QS_WAR_SKIPPED;
+    }
+    else if ( frame->markersCount < recorded.markersCount )
+    {
+        frame->markersStat = ftkQueryStatus::QS_ERR_OVERFLOW;
+    }
+    else
+    {
+        frame->markersStat = ftkQueryStatus( recorded.markersStat );
+    }
+
+    const uint32 fiducialsCapacity( frame->threeDFiducials != nullptr
+                                      ? frame->threeDFiducialsVersionSize.ReservedSize /
+                                          sizeof( ftk3DFiducial )
+                                      : 0u );
+    const RecordedFiducial* fiducials( _Reader.fiducials( recorded ) );
+    frame->threeDFiducialsCount = min( recorded.fiducialsCount, fiducialsCapacity );
+    for ( uint32 i( 0u ); i < frame->threeDFiducialsCount; ++i )
+    {
+        const RecordedFiducial& src( fiducials[ i ] );
+        ftk3DFiducial& dst( frame->threeDFiducials[ i ] );
+        dst = ftk3DFiducial{};
+        dst.leftIndex = src.leftIndex;
+        dst.rightIndex = src.rightIndex;
+        dst.positionMM.x = src.positionMM[ 0u ];
+        dst.positionMM.y = src.positionMM[ 1u ];
+        dst.positionMM.z = src.positionMM[ 2u ];
+        dst.epipolarErrorPixels = src.epipolarErrorPixels;
+        dst.triangulationErrorMM = src.triangulationErrorMM;
+        dst.probability = src.probability;
+    }
+    if ( fiducialsCapacity == 0u )
+    {
+        frame->threeDFiducialsStat = ftkQueryStatus::QS_WAR_SKIPPED;
+    }
+    else if ( frame->threeDFiducialsCount < recorded.fiducialsCount )
+    {
+        frame->threeDFiducialsStat = ftkQueryStatus::QS_ERR_OVERFLOW;
+    }
+    else
+    {
+        frame->threeDFiducialsStat = ftkQueryStatus( recorded.fiducialsStat );
+    }
+}
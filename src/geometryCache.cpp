@@ -0,0 +1,180 @@
+#include "geometryCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+    bool lessEntry( const GeometryCacheEntry& a, const GeometryCacheEntry& b )
+    {
+        return a.hash != b.hash ? a.hash < b.hash : a.fileSize < b.fileSize;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+GeometryCache::GeometryCache()
+    : _Entries( nullptr )
+    , _Count( 0u )
+{}
+
+bool GeometryCache::open( const string& path )
+{
+    lock_guard< mutex > guard( _Lock );
+    _Path = path;
+    _Entries = nullptr;
+    _Count = 0u;
+    _Pending.clear();
+
+    if ( !_File.open( path ) )
+    {
+        return false;
+    }
+
+    const GeometryCacheHeader* header( reinterpret_cast< const GeometryCacheHeader* >( _File.data() ) );
+    if ( _File.size() < sizeof( GeometryCacheHeader ) || header->magic != GEOMETRY_CACHE_MAGIC ||
+         header->version != GEOMETRY_CACHE_VERSION || header->entrySize != sizeof( GeometryCacheEntry ) ||
+         header->count > ( _File.size() - sizeof( GeometryCacheHeader ) ) / sizeof( GeometryCacheEntry ) )
+    {
+        cerr << "Ignoring invalid geometry cache '" << path << "'" << endl;
+        _File.close();
+        return false;
+    }
+
+    _Entries = reinterpret_cast< const GeometryCacheEntry* >( _File.data() + sizeof( GeometryCacheHeader ) );
+    _Count = header->count;
+    return _Count != 0u;
+}
+
+bool GeometryCache::find( uint64 hash, uint64 fileSize, ftkRigidBody& body ) const
+{
+    const GeometryCacheEntry* entry( mapped( hash, fileSize ) );
+    if ( entry != nullptr )
+    {
+        body = entry->body;
+        return true;
+    }
+
+    lock_guard< mutex > guard( _Lock );
+    for ( const GeometryCacheEntry& pending : _Pending )
+    {
+        if ( pending.hash == hash && pending.fileSize == fileSize )
+        {
+            body = pending.body;
+            return true;
+        }
+    }
+    return false;
+}
+
+void GeometryCache::insert( uint64 hash, uint64 fileSize, const ftkRigidBody& body )
+{
+    if ( mapped( hash, fileSize ) != nullptr )
+    {
+        return;
+    }
+    GeometryCacheEntry entry{};
+    entry.hash = hash;
+    entry.fileSize = fileSize;
+    entry.body = body;
+    lock_guard< mutex > guard( _Lock );
+    _Pending.push_back( entry );
+}
+
+bool GeometryCache::isDirty() const
+{
+    lock_guard< mutex > guard( _Lock );
+    return !_Pending.empty();
+}
+
+bool GeometryCache::save()
+{
+    lock_guard< mutex > guard( _Lock );
+    if ( _Pending.empty() || _Path.empty() )
+    {
+        return true;
+    }
+
+    vector< GeometryCacheEntry > entries( _Entries, _Entries + _Count );
+    entries.insert( entries.end(), _Pending.begin(), _Pending.end() );
+    sort( entries.begin(), entries.end(), lessEntry );
+    entries.erase( unique( entries.begin(), entries.end(),
+                           []( const GeometryCacheEntry& a, const GeometryCacheEntry& b ) {
+                               return a.hash == b.hash && a.fileSize == b.fileSize;
+                           } ),
+                   entries.end() );
+
+    GeometryCacheHeader header{};
+    header.magic = GEOMETRY_CACHE_MAGIC;
+    header.version = GEOMETRY_CACHE_VERSION;
+    header.entrySize = sizeof( GeometryCacheEntry );
+    header.count = entries.size();
+
+    // The new cache is written aside, then moved over the old one.
+    const string temporary( _Path + ".tmp" );
+    FILE* file( fopen( temporary.c_str(), "wb" ) );
+    if ( file == nullptr )
+    {
+        cerr << "Could not create geometry cache '" << temporary << "'" << endl;
+        return false;
+    }
+    bool written( fwrite( &header, sizeof( header ), 1u, file ) == 1u &&
+                  fwrite( entries.data(), sizeof( GeometryCacheEntry ), entries.size(), file ) == entries.size() );
+    written = fclose( file ) == 0 && written;
+    if ( !written )
+    {
+        cerr << "Could not write geometry cache '" << temporary << "'" << endl;
+        remove( temporary.c_str() );
+        return false;
+    }
+
+    _File.close();
+    _Entries = nullptr;
+    _Count = 0u;
+    error_code err;
+    filesystem::rename( temporary, _Path, err );
+    if ( err )
+    {
+        cerr << "Could not replace geometry cache '" << _Path << "'" << endl;
+        remove( temporary.c_str() );
+        return false;
+    }
+    _Pending.clear();
+
+    if ( _File.open( _Path ) && _File.size() == sizeof( header ) + entries.size() * sizeof( GeometryCacheEntry ) )
+    {
+        _Entries = reinterpret_cast< const GeometryCacheEntry* >( _File.data() + sizeof( GeometryCacheHeader ) );
+        _Count = entries.size();
+    }
+    return true;
+}
+
+uint64 GeometryCache::hash( const void* data, uint64 size )
+{
+    const uint8* bytes( static_cast< const uint8* >( data ) );
+    uint64 value( 0xcbf29ce484222325uLL );
+    for ( uint64 i( 0u ); i < size; ++i )
+    {
+        value ^= bytes[ i ];
+        value *= 0x100000001b3uLL;
+    }
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+
+const GeometryCacheEntry* GeometryCache::mapped( uint64 hash, uint64 fileSize ) const
+{
+    // The mapping only changes in open() and save(), which are not called
+    // while geometries are being loaded.
+    GeometryCacheEntry key;
+    key.hash = hash;
+    key.fileSize = fileSize;
+    const GeometryCacheEntry* end( _Entries + _Count );
+    const GeometryCacheEntry* entry( lower_bound( _Entries, end, key, lessEntry ) );
+    return entry != end && entry->hash == hash && entry->fileSize == fileSize ? entry : nullptr;
+}
@@ -1,20 +1,36 @@
 #include "geometryHelper.hpp"
 #include "helpers.hpp"
+#include "mappedFile.hpp"
 #include <ftkInterface.h>
 
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <new>
 #include <string>
+#include <unordered_map>
 
 using namespace std;
 
-void getDataDirOptionId( uint64 sn, void* user, ftkOptionsInfo* oi );
+namespace
+{
+    void getDataDirOptionId( uint64 /* sn */, void* user, ftkOptionsInfo* oi )
+    {
+        uint32* id( reinterpret_cast< uint32* >( user ) );
+        if ( id != nullptr && strcmp( oi->name, "Data Directory" ) == 0 )
+        {
+            *id = oi->id;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
 
 int loadGeometry( ftkLibrary lib, const uint64& sn, const string& fileName, ftkGeometry& geometry )
 {
@@ -53,103 +69,125 @@ int loadRigidBody( ftkLibrary lib, const string& fileName, ftkRigidBody& geometr
 
 bool getFullFilePath( ftkLibrary lib, const string& fileName, string& fullFilePath, bool* fromSystem )
 {
+    // Resolved paths are memoized per file name, a given file is looked for
+    // on disk only once. Only successful resolutions are kept, so that a file
+    // created later is still found. The lock only covers the memo and the
+    // data directory, the options and the disk are read outside of it.
+    static mutex LOCK;
     static uint32 FTK_OPT_DATA_DIR( 0u );
     static string OPT_DIR( "" );
-    if ( FTK_OPT_DATA_DIR == 0u )
+    static unordered_map< string, pair< string, bool > > RESOLVED;
+
+    uint32 dataDirId( 0u );
+    string optDir( "" );
     {
-        if ( ftkEnumerateOptions( lib, 0uLL, getDataDirOptionId, &FTK_OPT_DATA_DIR ) !=
-             ftkError::FTK_WAR_OPT_GLOBAL_ONLY )
+        lock_guard< mutex > guard( LOCK );
+        unordered_map< string, pair< string, bool > >::const_iterator known( RESOLVED.find( fileName ) );
+        if ( known != RESOLVED.end() )
         {
-            cerr << "Could not get the data directory option ID" << endl;
-            return false;
-        }
-        else if ( FTK_OPT_DATA_DIR == 0u )
-        {
-            cerr << "Could not get the data directory option ID" << endl;
-            return false;
+            fullFilePath = known->second.first;
+            if ( fromSystem != nullptr )
+            {
+                *fromSystem = known->second.second;
+            }
+            return true;
         }
+
+        dataDirId = FTK_OPT_DATA_DIR;
+        optDir = OPT_DIR;
     }
-    if ( OPT_DIR.empty() )
+
+    // Only the ID of the data directory option is looked for in the
+    // enumeration, then only its value is read.
+    if ( optDir.empty() )
     {
+        if ( dataDirId == 0u )
+        {
+            const ftkError status( ftkEnumerateOptions( lib, 0uLL, getDataDirOptionId, &dataDirId ) );
+            if ( ( status != ftkError::FTK_OK && status != ftkError::FTK_WAR_OPT_GLOBAL_ONLY ) || dataDirId == 0u )
+            {
+                cerr << "Could not get the data directory option ID" << endl;
+                return false;
+            }
+        }
         ftkBuffer buffer{};
-        if ( ftkGetData( lib, 0uLL, FTK_OPT_DATA_DIR, &buffer ) != ftkError::FTK_OK || buffer.size < 1u )
+        if ( ftkGetData( lib, 0uLL, dataDirId, &buffer ) != ftkError::FTK_OK || buffer.size < 1u )
         {
             return false;
         }
-        OPT_DIR.assign( buffer.data );
+        optDir.assign( buffer.data );
+
+        lock_guard< mutex > guard( LOCK );
+        FTK_OPT_DATA_DIR = dataDirId;
+        OPT_DIR = optDir;
     }
 
-    ifstream input{ fileName };
-    if ( input.is_open() )
+    error_code err;
+    bool fromDataDir( false );
+    if ( filesystem::is_regular_file( fileName, err ) )
     {
         fullFilePath = fileName;
-        if ( fromSystem != nullptr )
-        {
-            *fromSystem = false;
-        }
-        return true;
     }
-    else
+    else if ( filesystem::is_regular_file( optDir + "/" + fileName, err ) )
     {
-        input.open( OPT_DIR + "/" + fileName );
-        if ( input.is_open() )
-        {
 #ifdef ATR_WIN
-            fullFilePath = OPT_DIR + "\\" + fileName;
+        fullFilePath = optDir + "\\" + fileName;
 #else
-            fullFilePath = OPT_DIR + "/" + fileName;
+        fullFilePath = optDir + "/" + fileName;
 #endif
-            if ( fromSystem != nullptr )
-            {
-                *fromSystem = true;
-            }
-            return true;
-        }
+        fromDataDir = true;
+    }
+    else
+    {
+        return false;
     }
 
-    return false;
+    if ( fromSystem != nullptr )
+    {
+        *fromSystem = fromDataDir;
+    }
+    lock_guard< mutex > guard( LOCK );
+    RESOLVED.emplace( fileName, make_pair( fullFilePath, fromDataDir ) );
+    return true;
 }
 
-bool loadFileInBuffer( const string& fullFilePath, ftkBuffer& buffer )
+bool mapGeometryFile( const string& fullFilePath, MappedFile& file )
 {
-    ifstream input( fullFilePath, ios::binary | ios::ate );
-
-    if ( !input.is_open() )
+    if ( !file.open( fullFilePath ) )
     {
         cerr << "Could not open file '" << fullFilePath << "'" << endl;
         return false;
     }
-
-    buffer.reset();
-    streampos pos( input.tellg() );
-    input.seekg( 0u, ios::beg );
-    input.read( buffer.data, static_cast< streamsize >( pos ) );
-    if ( input.fail() )
+    if ( file.size() > sizeof( ftkBuffer::data ) )
     {
-        cerr << "Could not read contents of file '" << fullFilePath << "'" << endl;
+        cerr << "File '" << fullFilePath << "' is too large (" << file.size() << " bytes, at most "
+             << sizeof( ftkBuffer::data ) << ")" << endl;
+        file.close();
         return false;
     }
-    buffer.size = static_cast< uint32 >( pos );
 
     return true;
 }
 
-// ----------------------------------------------------------------------------
-
-void getDataDirOptionId( uint64 sn, void* user, ftkOptionsInfo* oi )
+bool loadFileInBuffer( const string& fullFilePath, ftkBuffer& buffer )
 {
-    uint32_t* ptr( reinterpret_cast< uint32_t* >( user ) );
-    if ( ptr == nullptr )
+    MappedFile file;
+    if ( !mapGeometryFile( fullFilePath, file ) )
     {
-        return;
+        return false;
     }
-    if ( strcmp( oi->name, "Data Directory" ) == 0 )
+
+    buffer.reset();
+    if ( file.size() != 0u )
     {
-        *ptr = oi->id;
+        memcpy( buffer.data, file.data(), static_cast< size_t >( file.size() ) );
     }
-}
+    buffer.size = static_cast< uint32 >( file.size() );
 
+    return true;
+}
 
+// ----------------------------------------------------------------------------
 
 void loadAndSetGeometryFile(ftkLibrary lib,uint64 sn, std::string geomFile, ftkRigidBody* geom)
 {
@@ -0,0 +1,398 @@
+#include "geometryRegistry.hpp"
+
+#include "geometryHelper.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    float64 elapsedUS( chrono::steady_clock::time_point start )
+    {
+        return chrono::duration< float64, micro >( chrono::steady_clock::now() - start ).count();
+    }
+
+    bool isBlank( char c )
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    string trimmed( const char* begin, const char* end )
+    {
+        while ( begin < end && isBlank( *begin ) )
+        {
+            ++begin;
+        }
+        while ( end > begin && isBlank( *( end - 1 ) ) )
+        {
+            --end;
+        }
+        return string( begin, end );
+    }
+
+    bool toUInt32( const string& text, uint32& value )
+    {
+        if ( text.empty() || text.size() > 9u ||
+             text.find_first_not_of( "0123456789" ) != string::npos )
+        {
+            return false;
+        }
+        value = uint32( stoul( text ) );
+        return true;
+    }
+
+    bool toFloat( const string& text, floatXX& value )
+    {
+        if ( text.empty() )
+        {
+            return false;
+        }
+        char* end( nullptr );
+        value = floatXX( strtod( text.c_str(), &end ) );
+        return end == text.c_str() + text.size();
+    }
+
+    /* Parses the plain INI geometries, [geometry] with count and id, then
+     * one [fiducialN] section with x, y and z per point. Unlike
+     * ftkLoadRigidBodyFromFile, it may run on all the workers at once. Any
+     * other section or key, or a repeated one, is left to the SDK, so that
+     * this never accepts a file differently from it.
+     */
+    bool parsePlainGeometry( const char* data, uint64 size, ftkRigidBody& body )
+    {
+        const uint32 NONE( ~0u ), GEOMETRY( FTK_MAX_FIDUCIALS );
+        uint32 section( NONE ), count( 0u ), id( 0u );
+        bool hasCount( false ), hasId( false );
+        uint32 coordinates[ FTK_MAX_FIDUCIALS ] = {};
+        ftkRigidBody result{};
+
+        const char* const end( data + size );
+        for ( const char* line( data ); line < end; )
+        {
+            const char* eol( static_cast< const char* >( memchr( line, '\n', size_t( end - line ) ) ) );
+            eol = eol != nullptr ? eol : end;
+            const string text( trimmed( line, eol ) );
+            line = eol + 1;
+
+            if ( text.empty() || text[ 0u ] == ';' || text[ 0u ] == '#' )
+            {
+                continue;
+            }
+            if ( text[ 0u ] == '[' )
+            {
+                const string name( text.back() == ']' ? text.substr( 1u, text.size() - 2u ) : string() );
+                uint32 index( 0u );
+                if ( name == "geometry" )
+                {
+                    section = GEOMETRY;
+                }
+                else if ( name.compare( 0u, 8u, "fiducial" ) == 0 && toUInt32( name.substr( 8u ), index ) &&
+                          index < FTK_MAX_FIDUCIALS )
+                {
+                    section = index;
+                }
+                else
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            const size_t equal( text.find( '=' ) );
+            if ( equal == string::npos || section == NONE )
+            {
+                return false;
+            }
+            const string key( trimmed( text.data(), text.data() + equal ) );
+            const string value( trimmed( text.data() + equal + 1u, text.data() + text.size() ) );
+            if ( section == GEOMETRY )
+            {
+                bool& has( key == "count" ? hasCount : hasId );
+                if ( ( key != "count" && key != "id" ) || has || !toUInt32( value, key == "count" ? count : id ) )
+                {
+                    return false;
+                }
+                has = true;
+                continue;
+            }
+
+            const uint32 axis( key == "x" ? 0u : ( key == "y" ? 1u : ( key == "z" ? 2u : 3u ) ) );
+            ftk3DPoint& position( result.fiducials[ section ].position );
+            floatXX* const target[ 3u ] = { &position.x, &position.y, &position.z };
+            if ( axis == 3u || ( coordinates[ section ] & ( 1u << axis ) ) != 0u ||
+                 !toFloat( value, *target[ axis ] ) )
+            {
+                return false;
+            }
+            coordinates[ section ] |= 1u << axis;
+        }
+
+        if ( !hasCount || !hasId || count < 3u || count > FTK_MAX_FIDUCIALS )
+        {
+            return false;
+        }
+        for ( uint32 i( 0u ); i < FTK_MAX_FIDUCIALS; ++i )
+        {
+            if ( coordinates[ i ] != ( i < count ? 7u : 0u ) )
+            {
+                return false;
+            }
+        }
+
+        result.geometryId = id;
+        result.pointsCount = count;
+        body = result;
+        return true;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+const ftkRigidBody* GeometryTable::find( uint32 geometryId ) const
+{
+    vector< ftkRigidBody >::const_iterator it(
+      lower_bound( _Bodies.begin(), _Bodies.end(), geometryId,
+                   []( const ftkRigidBody& body, uint32 id ) { return body.geometryId < id; } ) );
+    return it != _Bodies.end() && it->geometryId == geometryId ? &*it : nullptr;
+}
+
+uint32 GeometryTable::size() const
+{
+    return uint32( _Bodies.size() );
+}
+
+const ftkRigidBody& GeometryTable::operator[]( uint32 index ) const
+{
+    return _Bodies[ index ];
+}
+
+// ----------------------------------------------------------------------------
+
+GeometryRegistry::GeometryRegistry( ftkLibrary lib, uint32 threads )
+    : _Library( lib )
+    , _Threads( threads != 0u ? threads : max( thread::hardware_concurrency(), 1u ) )
+    , _Cache( nullptr )
+    , _Table( make_shared< GeometryTable >() )
+    , _LoadUS( 0.0 )
+{}
+
+void GeometryRegistry::setCache( GeometryCache* cache )
+{
+    _Cache = cache;
+}
+
+bool GeometryRegistry::loadFiles( const vector< string >& fileNames )
+{
+    const chrono::steady_clock::time_point start( chrono::steady_clock::now() );
+    _Reports.assign( fileNames.size(), GeometryLoadReport() );
+    vector< ftkRigidBody > bodies( fileNames.size(), ftkRigidBody{} );
+
+    if ( !fileNames.empty() )
+    {
+        atomic< size_t > next( 0u );
+        auto work = [ this, &fileNames, &bodies, &next ]() {
+            for ( size_t i( next++ ); i < fileNames.size(); i = next++ )
+            {
+                loadOne( fileNames[ i ], _Reports[ i ], bodies[ i ] );
+            }
+        };
+
+        vector< thread > workers;
+        const size_t count( min( size_t( _Threads ), fileNames.size() ) );
+        for ( size_t i( 1u ); i < count; ++i )
+        {
+            workers.emplace_back( work );
+        }
+        work();
+        for ( thread& worker : workers )
+        {
+            worker.join();
+        }
+    }
+
+    // Files are gathered in the given order, so that the first file of a
+    // given geometry ID wins.
+    shared_ptr< GeometryTable > table( make_shared< GeometryTable >() );
+    map< uint32, size_t > loaded;
+    bool allLoaded( true );
+    for ( size_t i( 0u ); i < bodies.size(); ++i )
+    {
+        GeometryLoadReport& report( _Reports[ i ] );
+        if ( report.Status > 1 )
+        {
+            allLoaded = false;
+            continue;
+        }
+        pair< map< uint32, size_t >::iterator, bool > added( loaded.emplace( report.GeometryId, i ) );
+        if ( !added.second )
+        {
+            report.Status = 2;
+            report.Error = "geometry ID already loaded from " + _Reports[ added.first->second ].FileName;
+            allLoaded = false;
+            continue;
+        }
+        table->_Bodies.push_back( bodies[ i ] );
+    }
+    sort( table->_Bodies.begin(), table->_Bodies.end(),
+          []( const ftkRigidBody& a, const ftkRigidBody& b ) { return a.geometryId < b.geometryId; } );
+
+    if ( _Cache != nullptr && _Cache->isDirty() )
+    {
+        _Cache->save();
+    }
+
+    _Table = table;
+    _LoadUS = elapsedUS( start );
+    return allLoaded;
+}
+
+bool GeometryRegistry::loadDirectory( const string& directory )
+{
+    vector< string > fileNames;
+    error_code err;
+    for ( filesystem::directory_iterator it( directory, err ), end; !err && it != end; it.increment( err ) )
+    {
+        if ( it->is_regular_file() && it->path().extension() == ".ini" )
+        {
+            fileNames.push_back( it->path().string() );
+        }
+    }
+    if ( err )
+    {
+        cerr << "Could not list directory '" << directory << "'" << endl;
+        return false;
+    }
+    sort( fileNames.begin(), fileNames.end() );
+    return loadFiles( fileNames ) && !fileNames.empty();
+}
+
+bool GeometryRegistry::registerAll( uint64 sn ) const
+{
+    bool ok( true );
+    for ( ftkRigidBody body : _Table->_Bodies )
+    {
+        if ( ftkSetRigidBody( _Library, sn, &body ) != ftkError::FTK_OK )
+        {
+            cerr << "Could not register geometry " << body.geometryId << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+shared_ptr< const GeometryTable > GeometryRegistry::table() const
+{
+    return _Table;
+}
+
+const vector< GeometryLoadReport >& GeometryRegistry::reports() const
+{
+    return _Reports;
+}
+
+float64 GeometryRegistry::loadUS() const
+{
+    return _LoadUS;
+}
+
+void GeometryRegistry::printReport( ostream& out ) const
+{
+    const ios::fmtflags flags( out.flags() );
+    const streamsize precision( out.precision() );
+    out << fixed << setprecision( 1 );
+    for ( const GeometryLoadReport& report : _Reports )
+    {
+        out << report.FileName << ": ";
+        if ( report.Status > 1 )
+        {
+            out << "FAILED (" << report.Error << ")";
+        }
+        else
+        {
+            out << "geometry " << report.GeometryId << ( report.Cached ? " (cached)" : "" );
+        }
+        out << ", resolve " << report.ResolveUS << " us, read " << report.ReadUS << " us, "
+            << ( report.Cached ? "lookup " : "parse " )
+            << report.ParseUS << " us" << endl;
+    }
+    out << _Table->size() << " geometries loaded in " << _LoadUS << " us with " << _Threads << " threads"
+        << endl;
+    out.flags( flags );
+    out.precision( precision );
+}
+
+// ----------------------------------------------------------------------------
+
+void GeometryRegistry::loadOne( const string& fileName, GeometryLoadReport& report, ftkRigidBody& body ) const
+{
+    report.FileName = fileName;
+
+    chrono::steady_clock::time_point start( chrono::steady_clock::now() );
+    bool fromDataDir( false );
+    const bool found( getFullFilePath( _Library, fileName, report.FullPath, &fromDataDir ) );
+    report.ResolveUS = elapsedUS( start );
+    if ( !found )
+    {
+        report.Error = "file not found";
+        return;
+    }
+
+    start = chrono::steady_clock::now();
+    MappedFile file;
+    const bool mapped( mapGeometryFile( report.FullPath, file ) );
+    report.ReadUS = elapsedUS( start );
+    if ( !mapped )
+    {
+        report.Error = "cannot read file";
+        return;
+    }
+
+    // The cache is looked up on the mapped contents, the plain INI files are
+    // parsed from them too; the file is only copied in an ftkBuffer when it
+    // has to go through the SDK.
+    start = chrono::steady_clock::now();
+    const uint64 hash( _Cache != nullptr ? GeometryCache::hash( file.data(), file.size() ) : 0u );
+    report.Cached = _Cache != nullptr && _Cache->find( hash, file.size(), body );
+    if ( !report.Cached )
+    {
+        ftkError err( ftkError::FTK_OK );
+        if ( !parsePlainGeometry( file.data(), file.size(), body ) )
+        {
+            unique_ptr< ftkBuffer > buffer( new ftkBuffer{} );
+            if ( file.size() != 0u )
+            {
+                memcpy( buffer->data, file.data(), static_cast< size_t >( file.size() ) );
+            }
+            buffer->size = static_cast< uint32 >( file.size() );
+
+            // The SDK does not document ftkLoadRigidBodyFromFile as safe to
+            // call concurrently on one library handle.
+            lock_guard< mutex > guard( _ParseMutex );
+            err = ftkLoadRigidBodyFromFile( _Library, buffer.get(), &body );
+        }
+        if ( err != ftkError::FTK_OK )
+        {
+            report.ParseUS = elapsedUS( start );
+            report.Error = "invalid geometry file";
+            return;
+        }
+        if ( _Cache != nullptr )
+        {
+            _Cache->insert( hash, file.size(), body );
+        }
+    }
+    report.ParseUS = elapsedUS( start );
+
+    report.GeometryId = body.geometryId;
+    report.Status = fromDataDir ? 1 : 0;
+}
@@ -12,6 +12,7 @@
 // ============================================================================
 
 #include "helpers.hpp"
+#include "optionCatalog.hpp"
 
 #include <conio.h>
 #include <windows.h>
@@ -60,191 +61,14 @@ void waitForKeyboardHit()
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
-void optionEnumerator(uint64 sn, void* user, ftkOptionsInfo* oi)
-    {
-        cout << "Option " << oi->id << "  " << oi->name << endl;
-
-        switch (oi->component)
-        {
-        case ftkComponent::FTK_LIBRARY:
-            cout << "\tCOMP:  library" << endl;
-            break;
-
-        case ftkComponent::FTK_DEVICE:
-            cout << "\tCOMP:  device" << endl;
-            break;
-
-        case ftkComponent::FTK_DETECTOR:
-            cout << "\tCOMP:  detector" << endl;
-            break;
-
-        case ftkComponent::FTK_MATCH2D3D:
-            cout << "\tCOMP:  matching" << endl;
-            break;
-
-        case ftkComponent::FTK_DEVICE_WIRELESS:
-            cout << "\tCOMP:  wireless management" << endl;
-            break;
-
-        default:
-            cout << "\tCOMP:  ????" << endl;
-            break;
-        }
-
-        cout << "\tDESC:  " << oi->description << endl;
-        if (oi->unit)
-        {
-            cout << "\tUNIT:  " << oi->unit << endl;
-        }
-
-        cout << "\tSTAT:  ";
-        if (oi->status.read)
-        {
-            cout << "(READ)";
-        }
-        if (oi->status.write)
-        {
-            cout << "(WRITE)";
-        }
-        cout << endl;
-
-        switch (oi->type)
-        {
-        case ftkOptionType::FTK_INT32:
-            cout << "\tTYPE:  int32" << endl;
-            if (strcmp(oi->name, "Challenge result") == 0)
-            {
-                break;
-            }
-            if (oi->status.read && oi->status.write)
-            {
-                int32 out;
-                if (ftkGetInt32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MIN_VAL) != ftkError::FTK_OK)
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tMIN:   " << out << endl;
-                if (ftkError::FTK_OK != ftkGetInt32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MAX_VAL))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tMAX:   " << out << endl;
-                if (ftkError::FTK_OK != ftkGetInt32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_DEF_VAL))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tDEF:   " << out << endl;
-                if (ftkError::FTK_OK != ftkGetInt32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_VALUE))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tVAL:   " << out << endl;
-            }
-            else if (oi->status.read)
-            {
-                int32 out;
-                if (ftkError::FTK_OK != ftkGetInt32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_VALUE))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tVAL:   " << out << endl;
-            }
-            else if (oi->status.write)
-            {
-                int32 out;
-                if (ftkError::FTK_OK != ftkGetInt32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MIN_VAL))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tMIN:   " << out << endl;
-                if (ftkError::FTK_OK != ftkGetInt32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MAX_VAL))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tMAX:   " << out << endl;
-            }
-            break;
-
-        case ftkOptionType::FTK_FLOAT32:
-            cout << "\tTYPE:  float32" << endl;
-            if (oi->status.read && oi->status.write)
-            {
-                float32 out;
-                ftkError err(ftkGetFloat32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MIN_VAL));
-                if (err == ftkError::FTK_OK)
-                {
-                    cout << "\tMIN:   " << out << endl;
-                }
-                err = ftkGetFloat32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MAX_VAL);
-                if (err == ftkError::FTK_OK)
-                {
-                    cout << "\tMAX:   " << out << endl;
-                }
-                err = ftkGetFloat32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_DEF_VAL);
-                if (err == ftkError::FTK_OK)
-                {
-                    cout << "\tDEF:   " << out << endl;
-                }
-                if (ftkError::FTK_OK != ftkGetFloat32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_VALUE))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tVAL:   " << out << endl;
-            }
-            else if (oi->status.read)
-            {
-                float32 out;
-                if (ftkError::FTK_OK != ftkGetFloat32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_VALUE))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tVAL:   " << out << endl;
-            }
-            else if (oi->status.write)
-            {
-                float32 out;
-                if (ftkError::FTK_OK != ftkGetFloat32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MIN_VAL))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tMIN:   " << out << endl;
-                if (ftkError::FTK_OK != ftkGetFloat32(lib, sn, oi->id, &out, ftkOptionGetter::FTK_MAX_VAL))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tMAX:   " << out << endl;
-            }
-            break;
-
-        case ftkOptionType::FTK_DATA:
-            cout << "\tTYPE:  data" << endl;
-            if (oi->status.read)
-            {
-                ftkBuffer buffer;
-                if (ftkError::FTK_OK != ftkGetData(lib, sn, oi->id, &buffer))
-                {
-                    checkError(lib, !isNotFromConsole, false);
-                }
-                cout << "\tVAL:   " << buffer.sData << endl;
-            }
-            break;
-
-        default:
-            cout << "\tTYPE:  ????" << endl;
-            break;
-        }
-
-        cout << "" << endl;
-    }
-
-
- void enumerateOptions(ftkLibrary lib, uint64 sn)
+void enumerateOptions(ftkLibrary lib, uint64 sn)
 {
-    ftkError status(ftkEnumerateOptions(lib, sn, optionEnumerator, nullptr));
-    if (status != ftkError::FTK_OK && status != ftkError::FTK_WAR_OPT_GLOBAL_ONLY)
+    OptionCatalog catalog;
+    if (!catalog.build(lib, sn))
     {
         checkError(lib);
     }
+    catalog.print(cout);
 }
 
 void setOptionValue(ftkLibrary lib, uint64 sn, uint32 optID, int32 value)
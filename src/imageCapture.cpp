@@ -0,0 +1,473 @@
+#include "imageCapture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+    // Longest literal and repeat sequences of a control byte.
+    const uint32 MAX_LITERALS( 128u );
+    const uint32 MIN_REPEATS( 3u );
+    const uint32 MAX_REPEATS( 130u );
+
+    uint32 bytesPerPixelOf( ftkPixelFormat format )
+    {
+        return format == ftkPixelFormat::GRAY16 ? 2u : 1u;
+    }
+
+    // Copies the rows of a padded image without their padding.
+    void copyRows( const uint8* src, uint32 rowBytes, uint32 height, int32 stride, uint8* dst )
+    {
+        for ( uint32 y( 0u ); y < height; ++y )
+        {
+            memcpy( dst + size_t( y ) * rowBytes, src + ptrdiff_t( y ) * stride, rowBytes );
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+uint32 maxCompressedSize( uint32 size )
+{
+    return size + ( size + MAX_LITERALS - 1u ) / MAX_LITERALS;
+}
+
+uint32 compressImage( const uint8* pixels, uint32 width, uint32 height, uint32 bytesPerPixel, uint8* residuals,
+                      uint8* out )
+{
+    // Prediction from the left neighbour, from the pixel above on the first
+    // column. Both loops are plain byte subtractions.
+    const uint32 rowBytes( width * bytesPerPixel );
+    const uint32 size( rowBytes * height );
+    for ( uint32 y( 0u ); y < height; ++y )
+    {
+        const uint8* row( pixels + size_t( y ) * rowBytes );
+        const uint8* above( y == 0u ? row : row - rowBytes );
+        uint8* residual( residuals + size_t( y ) * rowBytes );
+        const uint32 first( min( bytesPerPixel, rowBytes ) );
+        for ( uint32 x( 0u ); x < first; ++x )
+        {
+            residual[ x ] = uint8( row[ x ] - ( y == 0u ? 0u : above[ x ] ) );
+        }
+        for ( uint32 x( first ); x < rowBytes; ++x )
+        {
+            residual[ x ] = uint8( row[ x ] - row[ x - bytesPerPixel ] );
+        }
+    }
+
+    uint32 used( 0u ), literals( 0u ), i( 0u );
+    while ( i < size )
+    {
+        const uint8 value( residuals[ i ] );
+        uint32 repeats( 1u );
+        while ( i + repeats < size && repeats < MAX_REPEATS && residuals[ i + repeats ] == value )
+        {
+            ++repeats;
+        }
+        if ( repeats < MIN_REPEATS )
+        {
+            ++literals;
+            ++i;
+            if ( literals == MAX_LITERALS || i == size )
+            {
+                out[ used++ ] = uint8( literals - 1u );
+                memcpy( out + used, residuals + i - literals, literals );
+                used += literals;
+                literals = 0u;
+            }
+            continue;
+        }
+        if ( literals != 0u )
+        {
+            out[ used++ ] = uint8( literals - 1u );
+            memcpy( out + used, residuals + i - literals, literals );
+            used += literals;
+            literals = 0u;
+        }
+        out[ used++ ] = uint8( repeats + 125u );
+        out[ used++ ] = value;
+        i += repeats;
+    }
+    return used;
+}
+
+bool decompressImage( const uint8* data, uint32 size, uint32 width, uint32 height, uint32 bytesPerPixel,
+                      uint8* pixels )
+{
+    const uint32 rowBytes( width * bytesPerPixel );
+    const uint32 total( rowBytes * height );
+    uint32 read( 0u ), written( 0u );
+    while ( read < size )
+    {
+        const uint32 control( data[ read++ ] );
+        if ( control < MAX_LITERALS )
+        {
+            const uint32 literals( control + 1u );
+            if ( read + literals > size || written + literals > total )
+            {
+                return false;
+            }
+            memcpy( pixels + written, data + read, literals );
+            read += literals;
+            written += literals;
+        }
+        else
+        {
+            const uint32 repeats( control - 125u );
+            if ( read == size || written + repeats > total )
+            {
+                return false;
+            }
+            memset( pixels + written, data[ read++ ], repeats );
+            written += repeats;
+        }
+    }
+    if ( written != total )
+    {
+        return false;
+    }
+
+    for ( uint32 y( 0u ); y < height; ++y )
+    {
+        uint8* row( pixels + size_t( y ) * rowBytes );
+        const uint8* above( y == 0u ? row : row - rowBytes );
+        const uint32 first( min( bytesPerPixel, rowBytes ) );
+        for ( uint32 x( 0u ); x < first; ++x )
+        {
+            row[ x ] = uint8( row[ x ] + ( y == 0u ? 0u : above[ x ] ) );
+        }
+        for ( uint32 x( first ); x < rowBytes; ++x )
+        {
+            row[ x ] = uint8( row[ x ] + row[ x - bytesPerPixel ] );
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+ImageCapture::ImageCapture()
+    : _File( nullptr )
+    , _Failed( false )
+    , _NextSequence( 0u )
+    , _Running( false )
+    , _Captured( 0u )
+    , _Written( 0u )
+    , _Dropped( 0u )
+    , _RawBytes( 0u )
+    , _WrittenBytes( 0u )
+{
+    for ( Slot& slot : _Slots )
+    {
+        slot.State.store( SlotState::Free, memory_order_relaxed );
+        slot.Sequence.store( 0u, memory_order_relaxed );
+        slot.Header = CapturedImage{};
+        slot.Pool = nullptr;
+        slot.Index = FramePool::INVALID_INDEX;
+    }
+}
+
+ImageCapture::~ImageCapture()
+{
+    close();
+}
+
+bool ImageCapture::open( const string& path, uint64 sn, const Settings& settings )
+{
+    close();
+
+    _Settings = settings;
+    _Settings.Slots = max( 1u, min( _Settings.Slots, uint32( MAX_SLOTS ) ) );
+    _Settings.Workers = max( 1u, _Settings.Workers );
+
+    for ( uint32 s( 0u ); s < _Settings.Slots; ++s )
+    {
+        _Slots[ s ].State.store( SlotState::Free, memory_order_relaxed );
+    }
+
+    _File = fopen( path.c_str(), "wb" );
+    if ( _File == nullptr )
+    {
+        cerr << "Could not create image capture '" << path << "'" << endl;
+        return false;
+    }
+
+    ImageCaptureHeader header{};
+    header.magic = IMAGE_CAPTURE_MAGIC;
+    header.version = IMAGE_CAPTURE_VERSION;
+    header.headerSize = sizeof( ImageCaptureHeader );
+    header.serialNumber = sn;
+    header.imageRecordSize = sizeof( CapturedImage );
+    _Failed = fwrite( &header, sizeof( header ), 1u, _File ) != 1u;
+
+    _NextSequence = 0u;
+    _Captured.store( 0u );
+    _Written.store( 0u );
+    _Dropped.store( 0u );
+    _RawBytes.store( 0u );
+    _WrittenBytes.store( sizeof( header ) );
+
+    _Running.store( true );
+    for ( uint32 w( 0u ); w < _Settings.Workers; ++w )
+    {
+        _Workers.emplace_back( &ImageCapture::run, this );
+    }
+    return true;
+}
+
+bool ImageCapture::close()
+{
+    if ( _File == nullptr )
+    {
+        return false;
+    }
+
+    _Running.store( false );
+    for ( thread& worker : _Workers )
+    {
+        worker.join();
+    }
+    _Workers.clear();
+
+    // Frames queued after the workers saw the capture stopping are given
+    // back unwritten.
+    for ( uint32 s( 0u ); s < _Settings.Slots; ++s )
+    {
+        Slot& slot( _Slots[ s ] );
+        if ( slot.State.load( memory_order_acquire ) != SlotState::Free )
+        {
+            slot.Pool->release( slot.Index );
+            slot.State.store( SlotState::Free, memory_order_release );
+            _Dropped.fetch_add( 1u, memory_order_relaxed );
+        }
+    }
+
+    fclose( _File );
+    _File = nullptr;
+    if ( _Failed )
+    {
+        cerr << "Could not write the image capture" << endl;
+    }
+    return !_Failed;
+}
+
+bool ImageCapture::isOpen() const
+{
+    return _File != nullptr;
+}
+
+bool ImageCapture::capture( FramePool& pool, uint32 index )
+{
+    const ftkFrameQuery* frame( pool.frame( index ) );
+    if ( frame == nullptr )
+    {
+        if ( _Running.load( memory_order_relaxed ) )
+        {
+            _Dropped.fetch_add( 1u, memory_order_relaxed );
+        }
+        return false;
+    }
+    if ( !_Running.load( memory_order_relaxed ) || frame->imageHeader == nullptr ||
+         frame->imageLeftPixels == nullptr || frame->imageRightPixels == nullptr ||
+         frame->imageLeftStat != ftkQueryStatus::QS_OK || frame->imageRightStat != ftkQueryStatus::QS_OK )
+    {
+        pool.release( index );
+        return false;
+    }
+    const ftkImageHeader& image( *frame->imageHeader );
+    const uint32 bytesPerPixel( bytesPerPixelOf( image.format ) );
+    const uint32 rowBytes( uint32( image.width ) * bytesPerPixel );
+    if ( uint64( rowBytes ) * image.height > _Settings.MaxImageBytes || image.imageStrideInBytes < int32( rowBytes ) )
+    {
+        pool.release( index );
+        _Dropped.fetch_add( 1u, memory_order_relaxed );
+        return false;
+    }
+
+    // A free slot, otherwise the oldest one still waiting for a worker.
+    Slot* slot( nullptr );
+    for ( uint32 s( 0u ); s < _Settings.Slots && slot == nullptr; ++s )
+    {
+        if ( _Slots[ s ].State.load( memory_order_acquire ) == SlotState::Free )
+        {
+            slot = &_Slots[ s ];
+        }
+    }
+    if ( slot == nullptr )
+    {
+        uint64 oldest( ~uint64( 0u ) );
+        for ( uint32 s( 0u ); s < _Settings.Slots; ++s )
+        {
+            const uint64 sequence( _Slots[ s ].Sequence.load( memory_order_relaxed ) );
+            if ( _Slots[ s ].State.load( memory_order_relaxed ) == SlotState::Ready && sequence < oldest )
+            {
+                oldest = sequence;
+                slot = &_Slots[ s ];
+            }
+        }
+        // Either the oldest frame is replaced, or the workers hold every
+        // slot and the new one is given up: one image is lost both ways.
+        _Dropped.fetch_add( 1u, memory_order_relaxed );
+        SlotState ready( SlotState::Ready );
+        if ( slot == nullptr || !slot->State.compare_exchange_strong( ready, SlotState::Writing ) )
+        {
+            pool.release( index );
+            return false;
+        }
+        slot->Pool->release( slot->Index );
+    }
+    else
+    {
+        slot->State.store( SlotState::Writing, memory_order_relaxed );
+    }
+
+    CapturedImage& header( slot->Header );
+    header = CapturedImage{};
+    header.magic = CAPTURED_IMAGE_MAGIC;
+    header.timestampUS = image.timestampUS;
+    header.counter = image.counter;
+    header.format = int32( image.format );
+    header.width = image.width;
+    header.height = image.height;
+    header.bytesPerPixel = bytesPerPixel;
+    header.codec = IMAGE_CODEC_DELTA_RLE;
+    slot->Pool = &pool;
+    slot->Index = index;
+    slot->Sequence.store( _NextSequence++, memory_order_relaxed );
+    slot->State.store( SlotState::Ready, memory_order_release );
+    _Captured.fetch_add( 1u, memory_order_relaxed );
+    return true;
+}
+
+void ImageCapture::flush()
+{
+    for ( uint32 s( 0u ); s < _Settings.Slots && _Running.load( memory_order_acquire ); )
+    {
+        if ( _Slots[ s ].State.load( memory_order_acquire ) == SlotState::Free )
+        {
+            ++s;
+        }
+        else
+        {
+            this_thread::sleep_for( chrono::milliseconds( 1 ) );
+        }
+    }
+}
+
+uint64 ImageCapture::capturedImages() const
+{
+    return _Captured.load( memory_order_relaxed );
+}
+
+uint64 ImageCapture::writtenImages() const
+{
+    return _Written.load( memory_order_relaxed );
+}
+
+uint64 ImageCapture::droppedImages() const
+{
+    return _Dropped.load( memory_order_relaxed );
+}
+
+uint64 ImageCapture::rawBytes() const
+{
+    return _RawBytes.load( memory_order_relaxed );
+}
+
+uint64 ImageCapture::writtenBytes() const
+{
+    return _WrittenBytes.load( memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------------
+
+void ImageCapture::run()
+{
+    // Scratch buffers of this worker, both images are compressed in one
+    // record buffer. Rows are only copied when the frame pads them.
+    const uint32 compressedSize( maxCompressedSize( _Settings.MaxImageBytes ) );
+    vector< uint8 > rows( _Settings.MaxImageBytes );
+    vector< uint8 > residuals( _Settings.MaxImageBytes );
+    vector< uint8 > record( 2u * compressedSize + 8u );
+
+    for ( ;; )
+    {
+        Slot* slot( nullptr );
+        uint64 oldest( ~uint64( 0u ) );
+        for ( uint32 s( 0u ); s < _Settings.Slots; ++s )
+        {
+            const uint64 sequence( _Slots[ s ].Sequence.load( memory_order_relaxed ) );
+            if ( _Slots[ s ].State.load( memory_order_relaxed ) == SlotState::Ready && sequence < oldest )
+            {
+                oldest = sequence;
+                slot = &_Slots[ s ];
+            }
+        }
+        SlotState ready( SlotState::Ready );
+        if ( slot == nullptr || !slot->State.compare_exchange_strong( ready, SlotState::Compressing ) )
+        {
+            if ( slot == nullptr && !_Running.load( memory_order_acquire ) )
+            {
+                break;
+            }
+            this_thread::sleep_for( chrono::milliseconds( 1 ) );
+            continue;
+        }
+
+        CapturedImage header( slot->Header );
+        FramePool& pool( *slot->Pool );
+        const uint32 index( slot->Index );
+        const ftkFrameQuery& frame( *pool.frame( index ) );
+        const uint32 rowBytes( uint32( header.width ) * header.bytesPerPixel );
+        const int32 stride( frame.imageHeader->imageStrideInBytes );
+        const uint8* left( frame.imageLeftPixels );
+        if ( stride != int32( rowBytes ) )
+        {
+            copyRows( left, rowBytes, header.height, stride, rows.data() );
+            left = rows.data();
+        }
+        header.leftSize = compressImage( left, header.width, header.height, header.bytesPerPixel,
+                                         residuals.data(), record.data() );
+        const uint8* right( frame.imageRightPixels );
+        if ( stride != int32( rowBytes ) )
+        {
+            copyRows( right, rowBytes, header.height, stride, rows.data() );
+            right = rows.data();
+        }
+        header.rightSize = compressImage( right, header.width, header.height, header.bytesPerPixel,
+                                          residuals.data(), record.data() + header.leftSize );
+        pool.release( index );
+        slot->State.store( SlotState::Free, memory_order_release );
+
+        const uint32 dataSize( header.leftSize + header.rightSize );
+        const uint32 padded( ( dataSize + 7u ) & ~7u );
+        fill( record.data() + dataSize, record.data() + padded, uint8( 0u ) );
+        header.recordSize = uint32( sizeof( CapturedImage ) ) + padded;
+        if ( write( header, record.data() ) )
+        {
+            _Written.fetch_add( 1u, memory_order_relaxed );
+            _RawBytes.fetch_add( 2u * uint64( header.width ) * header.height * header.bytesPerPixel,
+                                 memory_order_relaxed );
+        }
+    }
+}
+
+bool ImageCapture::write( const CapturedImage& header, const uint8* data )
+{
+    lock_guard< mutex > lock( _FileMutex );
+    const uint32 dataSize( header.recordSize - uint32( sizeof( CapturedImage ) ) );
+    if ( _Failed || fwrite( &header, sizeof( header ), 1u, _File ) != 1u ||
+         fwrite( data, 1u, dataSize, _File ) != dataSize )
+    {
+        _Failed = true;
+        return false;
+    }
+    _WrittenBytes.fetch_add( header.recordSize, memory_order_relaxed );
+    return true;
+}
@@ -0,0 +1,220 @@
+#include "latencyHistogram.hpp"
+
+#include "logger.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+    uint32 highestBit( uint64 value )
+    {
+        uint32 bit( 0u );
+        while ( value >>= 1u )
+        {
+            ++bit;
+        }
+        return bit;
+    }
+
+    uint64 percentile( const uint64* counts, uint64 total, float64 fraction )
+    {
+        // Rank of the value, 1-based, so that p100 is the last value.
+        uint64 rank( uint64( fraction * float64( total ) + 0.5 ) );
+        rank = rank < 1u ? 1u : rank;
+        uint64 seen( 0u );
+        for ( uint32 i( 0u ); i < LatencyHistogram::BUCKET_COUNT; ++i )
+        {
+            seen += counts[ i ];
+            if ( seen >= rank )
+            {
+                return LatencyHistogram::upperBound( i );
+            }
+        }
+        return LatencyHistogram::upperBound( LatencyHistogram::BUCKET_COUNT - 1u );
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram()
+    : _SumNS( 0u )
+    , _MinNS( numeric_limits< uint64 >::max() )
+    , _MaxNS( 0u )
+{
+    for ( std::atomic< uint64 >& count : _Counts )
+    {
+        count.store( 0u, memory_order_relaxed );
+    }
+}
+
+void LatencyHistogram::record( int64 valueNS )
+{
+    const uint64 value( valueNS > 0 ? uint64( valueNS ) : 0u );
+    _Counts[ bucketOf( value ) ].fetch_add( 1u, memory_order_relaxed );
+    _SumNS.fetch_add( value, memory_order_relaxed );
+
+    uint64 current( _MinNS.load( memory_order_relaxed ) );
+    while ( value < current && !_MinNS.compare_exchange_weak( current, value, memory_order_relaxed ) )
+    {
+    }
+    current = _MaxNS.load( memory_order_relaxed );
+    while ( value > current && !_MaxNS.compare_exchange_weak( current, value, memory_order_relaxed ) )
+    {
+    }
+}
+
+LatencySnapshot LatencyHistogram::snapshot( bool reset )
+{
+    // A concurrent record may be counted in its bucket and not yet in the
+    // sum or the extrema, the count is taken from the buckets.
+    uint64 counts[ BUCKET_COUNT ];
+    LatencySnapshot result;
+    for ( uint32 i( 0u ); i < BUCKET_COUNT; ++i )
+    {
+        counts[ i ] = reset ? _Counts[ i ].exchange( 0u, memory_order_relaxed )
+                            : _Counts[ i ].load( memory_order_relaxed );
+        result.Count += counts[ i ];
+    }
+    const uint64 sum( reset ? _SumNS.exchange( 0u, memory_order_relaxed ) : _SumNS.load( memory_order_relaxed ) );
+    const uint64 minimum( reset ? _MinNS.exchange( numeric_limits< uint64 >::max(), memory_order_relaxed )
+                                : _MinNS.load( memory_order_relaxed ) );
+    const uint64 maximum( reset ? _MaxNS.exchange( 0u, memory_order_relaxed ) : _MaxNS.load( memory_order_relaxed ) );
+    if ( result.Count == 0u )
+    {
+        return result;
+    }
+
+    result.MinNS = minimum;
+    result.MaxNS = maximum;
+    result.MeanNS = float64( sum ) / float64( result.Count );
+    result.P50NS = min( percentile( counts, result.Count, 0.5 ), maximum );
+    result.P99NS = min( percentile( counts, result.Count, 0.99 ), maximum );
+    result.P999NS = min( percentile( counts, result.Count, 0.999 ), maximum );
+    return result;
+}
+
+uint32 LatencyHistogram::bucketOf( uint64 valueNS )
+{
+    const uint64 value( min( valueNS, ( uint64( 1u ) << LATENCY_MAX_VALUE_BITS ) - 1u ) );
+    const uint32 bit( highestBit( value ) );
+    const uint32 shift( bit > LATENCY_SUB_BUCKET_BITS ? bit - LATENCY_SUB_BUCKET_BITS : 0u );
+    return ( shift << LATENCY_SUB_BUCKET_BITS ) + uint32( value >> shift );
+}
+
+uint64 LatencyHistogram::upperBound( uint32 bucket )
+{
+    const uint32 shift( bucket < ( 2u << LATENCY_SUB_BUCKET_BITS ) ? 0u
+                                                                   : ( bucket >> LATENCY_SUB_BUCKET_BITS ) - 1u );
+    const uint64 top( bucket - ( shift << LATENCY_SUB_BUCKET_BITS ) );
+    return ( ( top + 1u ) << shift ) - 1u;
+}
+
+// ----------------------------------------------------------------------------
+
+LatencyStats::LatencyStats()
+    : _MinOffsetNS( 0 )
+    , _HasOffset( false )
+{}
+
+void LatencyStats::record( LatencyStage stage, int64 valueNS )
+{
+    _Stages[ uint32( stage ) ].record( valueNS );
+    _Periods[ uint32( stage ) ].record( valueNS );
+}
+
+void LatencyStats::recordFinished( LatencyStage stage, int64 receivedNS )
+{
+    if ( receivedNS != 0 )
+    {
+        record( stage, latencyClockNS() - receivedNS );
+    }
+}
+
+void LatencyStats::recordTransfer( uint64 deviceTimestampUS, int64 receivedNS )
+{
+    if ( deviceTimestampUS == 0u )
+    {
+        return;
+    }
+    const int64 offset( receivedNS - int64( deviceTimestampUS ) * 1000 );
+    if ( !_HasOffset || offset < _MinOffsetNS )
+    {
+        _MinOffsetNS = offset;
+        _HasOffset = true;
+    }
+    record( LatencyStage::Transfer, offset - _MinOffsetNS );
+}
+
+LatencySnapshot LatencyStats::snapshot( LatencyStage stage, bool period )
+{
+    return period ? _Periods[ uint32( stage ) ].snapshot( true ) : _Stages[ uint32( stage ) ].snapshot();
+}
+
+void LatencyStats::log( uint64 sn, bool period )
+{
+    for ( uint32 i( 0u ); i < uint32( LatencyStage::Count ); ++i )
+    {
+        const LatencySnapshot stage( snapshot( LatencyStage( i ), period ) );
+        if ( stage.Count == 0u )
+        {
+            continue;
+        }
+        LOG_INFO( "0x{x} {}: {} frames, p50 {.1} us, p99 {.1} us, p99.9 {.1} us, max {.1} us", sn,
+                  stageName( LatencyStage( i ) ), stage.Count, float64( stage.P50NS ) * 1e-3,
+                  float64( stage.P99NS ) * 1e-3, float64( stage.P999NS ) * 1e-3, float64( stage.MaxNS ) * 1e-3 );
+    }
+}
+
+void LatencyStats::print( ostream& out )
+{
+    const ios::fmtflags flags( out.flags() );
+    const streamsize precision( out.precision() );
+    out << fixed << setprecision( 1 );
+    for ( uint32 i( 0u ); i < uint32( LatencyStage::Count ); ++i )
+    {
+        const LatencySnapshot stage( _Stages[ i ].snapshot() );
+        if ( stage.Count == 0u )
+        {
+            continue;
+        }
+        out << setw( 10 ) << stageName( LatencyStage( i ) ) << ": " << stage.Count << " frames, p50 "
+            << float64( stage.P50NS ) * 1e-3 << " us, p99 " << float64( stage.P99NS ) * 1e-3 << " us, p99.9 "
+            << float64( stage.P999NS ) * 1e-3 << " us, max " << float64( stage.MaxNS ) * 1e-3 << " us\n";
+    }
+    out.flush();
+    out.flags( flags );
+    out.precision( precision );
+}
+
+const char* LatencyStats::stageName( LatencyStage stage )
+{
+    switch ( stage )
+    {
+    case LatencyStage::Query:
+        return "query";
+    case LatencyStage::Transfer:
+        return "transfer";
+    case LatencyStage::Decode:
+        return "decode";
+    case LatencyStage::Filter:
+        return "filter";
+    case LatencyStage::Prediction:
+        return "prediction";
+    case LatencyStage::Share:
+        return "share";
+    case LatencyStage::Stream:
+        return "stream";
+    case LatencyStage::Relative:
+        return "relative";
+    case LatencyStage::Consumer:
+        return "consumer";
+    case LatencyStage::EndToEnd:
+        return "end-to-end";
+    default:
+        return "????";
+    }
+}
@@ -0,0 +1,233 @@
+#include "logger.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace
+{
+    /** Records formatted before a batch is written. */
+    const uint32 BATCH_SIZE( 256u );
+
+    /** Time the background thread sleeps when the ring is empty. */
+    const chrono::milliseconds IDLE_PERIOD( 2 );
+
+    const char* levelName( LogLevel level )
+    {
+        switch ( level )
+        {
+        case LogLevel::Debug:
+            return "DEBUG";
+        case LogLevel::Info:
+            return "INFO ";
+        case LogLevel::Warning:
+            return "WARN ";
+        case LogLevel::Error:
+            return "ERROR";
+        default:
+            return "?????";
+        }
+    }
+
+    void appendArgument( string& out, const LogArgument& argument, bool hex, int32 decimals )
+    {
+        char text[ 64 ];
+        switch ( argument.Type )
+        {
+        case LogArgument::Kind::Signed:
+            if ( decimals >= 0 )
+            {
+                snprintf( text, sizeof( text ), "%.*f", decimals, float64( argument.Signed ) );
+            }
+            else
+            {
+                snprintf( text, sizeof( text ), hex ? "%llx" : "%lld", static_cast< long long >( argument.Signed ) );
+            }
+            break;
+        case LogArgument::Kind::Unsigned:
+            if ( decimals >= 0 )
+            {
+                snprintf( text, sizeof( text ), "%.*f", decimals, float64( argument.Unsigned ) );
+            }
+            else
+            {
+                snprintf( text, sizeof( text ), hex ? "%llx" : "%llu",
+                          static_cast< unsigned long long >( argument.Unsigned ) );
+            }
+            break;
+        case LogArgument::Kind::Float:
+            snprintf( text, sizeof( text ), "%.*f", decimals >= 0 ? decimals : 6, argument.Float );
+            break;
+        case LogArgument::Kind::Text:
+            out += argument.Text != nullptr ? argument.Text : "(null)";
+            return;
+        default:
+            out += "{?}";
+            return;
+        }
+        out += text;
+    }
+
+    void appendRecord( string& out, const LogRecord& record, int64 startNS )
+    {
+        char prefix[ 48 ];
+        snprintf( prefix, sizeof( prefix ), "[%12.6f] %s ", float64( record.TimeNS - startNS ) * 1e-9,
+                  levelName( record.Level ) );
+        out += prefix;
+
+        uint32 next( 0u );
+        for ( const char* c( record.Format ); *c != '\0'; ++c )
+        {
+            if ( *c != '{' )
+            {
+                out += *c;
+                continue;
+            }
+            const char* end( c + 1 );
+            while ( *end != '\0' && *end != '}' )
+            {
+                ++end;
+            }
+            if ( *end == '\0' )
+            {
+                out += c;
+                break;
+            }
+
+            const string spec( c + 1, end );
+            const bool hex( spec == "x" );
+            const int32 decimals( spec.size() > 1u && spec[ 0u ] == '.' ? atoi( spec.c_str() + 1 ) : -1 );
+            if ( next < record.Count )
+            {
+                appendArgument( out, record.Arguments[ next++ ], hex, decimals );
+            }
+            else
+            {
+                out += "{?}";
+            }
+            c = end;
+        }
+        out += '\n';
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+Logger& Logger::instance()
+{
+    static Logger LOGGER;
+    return LOGGER;
+}
+
+Logger::~Logger()
+{
+    _Running.store( false, memory_order_release );
+    if ( _Thread.joinable() )
+    {
+        _Thread.join();
+    }
+}
+
+void Logger::setOutput( ostream& out )
+{
+    lock_guard< mutex > guard( _OutputLock );
+    _Output->flush();
+    _Output = &out;
+}
+
+void Logger::setLevel( LogLevel level )
+{
+    _Level.store( uint32( level ), memory_order_relaxed );
+}
+
+LogLevel Logger::level() const
+{
+    return LogLevel( _Level.load( memory_order_relaxed ) );
+}
+
+void Logger::flush()
+{
+    const uint64 target( _Queued.load( memory_order_acquire ) );
+    while ( _Running.load( memory_order_acquire ) && _Written.load( memory_order_acquire ) < target )
+    {
+        this_thread::sleep_for( IDLE_PERIOD );
+    }
+}
+
+uint64 Logger::droppedRecords() const
+{
+    return _Dropped.load( memory_order_relaxed );
+}
+
+uint64 Logger::writtenRecords() const
+{
+    return _Written.load( memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------------
+
+Logger::Logger()
+    : _Level( uint32( LogLevel::Info ) )
+    , _Queued( 0u )
+    , _Written( 0u )
+    , _Dropped( 0u )
+    , _Running( true )
+    , _Output( &cout )
+    , _StartNS( chrono::duration_cast< chrono::nanoseconds >( chrono::steady_clock::now().time_since_epoch() )
+                  .count() )
+{
+    _Thread = thread( &Logger::run, this );
+}
+
+void Logger::push( const LogRecord& record )
+{
+    if ( _Ring.tryPush( record ) )
+    {
+        _Queued.fetch_add( 1u, memory_order_release );
+    }
+    else
+    {
+        _Dropped.fetch_add( 1u, memory_order_relaxed );
+    }
+}
+
+void Logger::run()
+{
+    string batch;
+    batch.reserve( BATCH_SIZE * 128u );
+    for ( ;; )
+    {
+        // The stop request is read before draining, so that the records
+        // queued before it are all written.
+        const bool stopping( !_Running.load( memory_order_acquire ) );
+        uint32 count( 0u );
+        for ( const LogRecord* record( _Ring.front() ); record != nullptr && count < BATCH_SIZE;
+              record = _Ring.front() )
+        {
+            appendRecord( batch, *record, _StartNS );
+            _Ring.popFront();
+            ++count;
+        }
+
+        if ( count != 0u )
+        {
+            {
+                lock_guard< mutex > guard( _OutputLock );
+                _Output->write( batch.data(), streamsize( batch.size() ) );
+                _Output->flush();
+            }
+            batch.clear();
+            _Written.fetch_add( count, memory_order_release );
+        }
+        else if ( stopping )
+        {
+            break;
+        }
+        else
+        {
+            this_thread::sleep_for( IDLE_PERIOD );
+        }
+    }
+}
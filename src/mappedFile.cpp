@@ -0,0 +1,159 @@
+#include "mappedFile.hpp"
+
+#ifdef ATR_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+MappedFile::MappedFile()
+    : _Data( nullptr )
+    , _Size( 0u )
+    , _Open( false )
+#ifdef ATR_WIN
+    , _File( INVALID_HANDLE_VALUE )
+    , _Mapping( nullptr )
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef ATR_WIN
+
+bool MappedFile::open( const string& path )
+{
+    close();
+
+    _File = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( _File == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( _File, &size ) )
+    {
+        close();
+        return false;
+    }
+    _Size = static_cast< uint64 >( size.QuadPart );
+    _Open = true;
+    if ( _Size == 0u )
+    {
+        return true;
+    }
+
+    _Mapping = CreateFileMappingA( _File, nullptr, PAGE_READONLY, 0u, 0u, nullptr );
+    if ( _Mapping == nullptr )
+    {
+        close();
+        return false;
+    }
+    _Data = static_cast< const char* >( MapViewOfFile( _Mapping, FILE_MAP_READ, 0u, 0u, 0u ) );
+    if ( _Data == nullptr )
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if ( _Data != nullptr )
+    {
+        UnmapViewOfFile( _Data );
+        _Data = nullptr;
+    }
+    if ( _Mapping != nullptr )
+    {
+        CloseHandle( _Mapping );
+        _Mapping = nullptr;
+    }
+    if ( _File != INVALID_HANDLE_VALUE )
+    {
+        CloseHandle( _File );
+        _File = INVALID_HANDLE_VALUE;
+    }
+    _Size = 0u;
+    _Open = false;
+}
+
+#else
+
+bool MappedFile::open( const string& path )
+{
+    close();
+
+    int fd( ::open( path.c_str(), O_RDONLY ) );
+    if ( fd < 0 )
+    {
+        return false;
+    }
+
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 )
+    {
+        ::close( fd );
+        return false;
+    }
+    _Size = static_cast< uint64 >( info.st_size );
+    _Open = true;
+    if ( _Size == 0u )
+    {
+        ::close( fd );
+        return true;
+    }
+
+    void* address( mmap( nullptr, _Size, PROT_READ, MAP_SHARED, fd, 0 ) );
+    ::close( fd );
+    if ( address == MAP_FAILED )
+    {
+        _Size = 0u;
+        _Open = false;
+        return false;
+    }
+    _Data = static_cast< const char* >( address );
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if ( _Data != nullptr )
+    {
+        munmap( const_cast< char* >( _Data ), _Size );
+        _Data = nullptr;
+    }
+    _Size = 0u;
+    _Open = false;
+}
+
+#endif
+
+bool MappedFile::isOpen() const
+{
+    return _Open;
+}
+
+const char* MappedFile::data() const
+{
+    return _Data;
+}
+
+uint64 MappedFile::size() const
+{
+    return _Size;
+}
@@ -0,0 +1,216 @@
+#include "multiDeviceAcquisition.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    const uint32 NO_FRONT( 0xFFFFFFFFu );
+
+    /** Tolerated drift between a device clock and the host clock, in parts
+     * per million, same as PREDICTOR_CLOCK_DRIFT_PPM. */
+    const int64 CLOCK_DRIFT_PPM( 100 );
+}
+
+// ----------------------------------------------------------------------------
+
+MultiDeviceAcquisition::MultiDeviceAcquisition( ftkLibrary lib, const vector< uint64 >& serialNumbers,
+                                                const Settings& settings )
+    : _Settings( settings )
+    , _Front( NO_FRONT )
+{
+    vector< FrameSource* > sources;
+    for ( uint64 sn : serialNumbers )
+    {
+        _DeviceSources.emplace_back( new DeviceFrameSource( lib, sn ) );
+        sources.push_back( _DeviceSources.back().get() );
+    }
+    createEngines( sources );
+}
+
+MultiDeviceAcquisition::MultiDeviceAcquisition( const vector< FrameSource* >& sources, const Settings& settings )
+    : _Settings( settings )
+    , _Front( NO_FRONT )
+{
+    createEngines( sources );
+}
+
+MultiDeviceAcquisition::~MultiDeviceAcquisition()
+{
+    stop();
+}
+
+bool MultiDeviceAcquisition::start()
+{
+    for ( unique_ptr< AcquisitionEngine >& engine : _Engines )
+    {
+        if ( !engine->start() )
+        {
+            stop();
+            return false;
+        }
+    }
+    _LastSeen.assign( _Engines.size(), chrono::steady_clock::now() );
+    _Clocks.assign( _Engines.size(), DeviceClock{ 0, 0u, false } );
+    _Front = NO_FRONT;
+    return true;
+}
+
+void MultiDeviceAcquisition::stop()
+{
+    for ( unique_ptr< AcquisitionEngine >& engine : _Engines )
+    {
+        engine->stop();
+    }
+    _Front = NO_FRONT;
+}
+
+uint32 MultiDeviceAcquisition::deviceCount() const
+{
+    return uint32( _Engines.size() );
+}
+
+AcquisitionEngine& MultiDeviceAcquisition::engine( uint32 device )
+{
+    return *_Engines[ device ];
+}
+
+uint64 MultiDeviceAcquisition::serialNumber( uint32 device ) const
+{
+    return _Sources[ device ]->serialNumber();
+}
+
+const PoseStore* MultiDeviceAcquisition::front()
+{
+    const chrono::steady_clock::time_point now( chrono::steady_clock::now() );
+    const chrono::milliseconds window( _Settings.MergeWindowMS );
+    const PoseStore* oldest( nullptr );
+    int64 oldestNS( 0 );
+    bool waiting( false );
+
+    _Front = NO_FRONT;
+    for ( uint32 i( 0u ); i < _Engines.size(); ++i )
+    {
+        const PoseStore* frame( _Engines[ i ]->front() );
+        if ( frame == nullptr )
+        {
+            // A late device only holds the stream back while it is alive.
+            waiting = waiting || ( _Engines[ i ]->isRunning() && now - _LastSeen[ i ] < window );
+            continue;
+        }
+        _LastSeen[ i ] = now;
+        const int64 frameNS( hostTimeNS( i, *frame ) );
+        if ( oldest == nullptr || frameNS < oldestNS )
+        {
+            oldest = frame;
+            oldestNS = frameNS;
+            _Front = i;
+        }
+    }
+
+    if ( waiting )
+    {
+        _Front = NO_FRONT;
+        return nullptr;
+    }
+    return oldest;
+}
+
+uint32 MultiDeviceAcquisition::frontDevice() const
+{
+    return _Front;
+}
+
+uint64 MultiDeviceAcquisition::frontSerialNumber() const
+{
+    return _Front != NO_FRONT ? serialNumber( _Front ) : 0uLL;
+}
+
+void MultiDeviceAcquisition::popFront()
+{
+    if ( _Front != NO_FRONT )
+    {
+        _Engines[ _Front ]->popFront();
+        _Front = NO_FRONT;
+    }
+}
+
+bool MultiDeviceAcquisition::tryPop( PoseStore& frame, uint32* device )
+{
+    const PoseStore* oldest( front() );
+    if ( oldest == nullptr )
+    {
+        return false;
+    }
+    frame = *oldest;
+    if ( device != nullptr )
+    {
+        *device = _Front;
+    }
+    popFront();
+    return true;
+}
+
+uint64 MultiDeviceAcquisition::acquiredFrames() const
+{
+    uint64 total( 0u );
+    for ( const unique_ptr< AcquisitionEngine >& engine : _Engines )
+    {
+        total += engine->acquiredFrames();
+    }
+    return total;
+}
+
+uint64 MultiDeviceAcquisition::droppedFrames() const
+{
+    uint64 total( 0u );
+    for ( const unique_ptr< AcquisitionEngine >& engine : _Engines )
+    {
+        total += engine->droppedFrames();
+    }
+    return total;
+}
+
+// ----------------------------------------------------------------------------
+
+void MultiDeviceAcquisition::createEngines( const vector< FrameSource* >& sources )
+{
+    const uint32 cores( max( thread::hardware_concurrency(), 1u ) );
+    for ( uint32 i( 0u ); i < sources.size(); ++i )
+    {
+        AcquisitionEngine::Settings settings( _Settings.Engine );
+        settings.Core = _Settings.FirstCore >= 0 ? int32( ( uint32( _Settings.FirstCore ) + i ) % cores ) : -1;
+        _Engines.emplace_back( new AcquisitionEngine( *sources[ i ], settings ) );
+    }
+    _Sources = sources;
+    _LastSeen.assign( _Engines.size(), chrono::steady_clock::now() );
+    _Clocks.assign( _Engines.size(), DeviceClock{ 0, 0u, false } );
+}
+
+int64 MultiDeviceAcquisition::hostTimeNS( uint32 device, const PoseStore& frame )
+{
+    if ( frame.timestampUS == 0u )
+    {
+        return frame.receivedNS;
+    }
+
+    // The smallest offset is the one least delayed by the transfer, it may
+    // grow by the tolerated drift. front() sees the same frame until it is
+    // popped, which leaves the offset unchanged.
+    DeviceClock& clock( _Clocks[ device ] );
+    const int64 offset( frame.receivedNS - int64( frame.timestampUS ) * 1000 );
+    if ( !clock.HasOffset || offset < clock.OffsetNS )
+    {
+        clock.OffsetNS = offset;
+    }
+    else if ( frame.timestampUS > clock.LastTimestampUS )
+    {
+        const int64 drift( int64( frame.timestampUS - clock.LastTimestampUS ) * CLOCK_DRIFT_PPM / 1000 );
+        clock.OffsetNS += min( offset - clock.OffsetNS, drift );
+    }
+    clock.HasOffset = true;
+    clock.LastTimestampUS = max( clock.LastTimestampUS, frame.timestampUS );
+    return int64( frame.timestampUS ) * 1000 + clock.OffsetNS;
+}
@@ -0,0 +1,265 @@
+#include "optionCatalog.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+    // Reading this option starts a new challenge on the device, it is
+    // listed but never read.
+    const char* const CHALLENGE_RESULT( "Challenge result" );
+
+    const char* componentName( ftkComponent component )
+    {
+        switch ( component )
+        {
+        case ftkComponent::FTK_LIBRARY:
+            return "library";
+        case ftkComponent::FTK_DEVICE:
+            return "device";
+        case ftkComponent::FTK_DETECTOR:
+            return "detector";
+        case ftkComponent::FTK_MATCH2D3D:
+            return "matching";
+        case ftkComponent::FTK_DEVICE_WIRELESS:
+            return "wireless management";
+        default:
+            return "????";
+        }
+    }
+
+    void printValue( ostream& out, const char* label, const OptionInfo& option, const OptionValue& value )
+    {
+        out << "\t" << label;
+        if ( option.Type == ftkOptionType::FTK_FLOAT32 )
+        {
+            out << value.Float << "\n";
+        }
+        else
+        {
+            out << value.Int << "\n";
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+OptionCatalog::OptionCatalog()
+    : _Library( nullptr )
+    , _SerialNumber( 0uLL )
+{}
+
+bool OptionCatalog::build( ftkLibrary lib, uint64 sn )
+{
+    _Library = lib;
+    _SerialNumber = sn;
+    _Options.clear();
+    _ById.clear();
+    _ByName.clear();
+
+    // Only the descriptions are copied during the enumeration, the values are
+    // read once it is over.
+    ftkError status( ftkEnumerateOptions( lib, sn, enumerator, &_Options ) );
+    if ( status != ftkError::FTK_OK && status != ftkError::FTK_WAR_OPT_GLOBAL_ONLY )
+    {
+        cerr << "Could not enumerate the options of device 0x" << hex << sn << dec << endl;
+        _Options.clear();
+        return false;
+    }
+
+    _ById.reserve( _Options.size() );
+    _ByName.reserve( _Options.size() );
+    for ( uint32 i( 0u ); i < _Options.size(); ++i )
+    {
+        OptionInfo& option( _Options[ i ] );
+        _ById.emplace( option.Id, i );
+        _ByName.emplace( option.Name, i );
+
+        if ( option.Type == ftkOptionType::FTK_DATA || option.Name == CHALLENGE_RESULT )
+        {
+            continue;
+        }
+        if ( option.Writable )
+        {
+            option.HasMin = readValue( option, ftkOptionGetter::FTK_MIN_VAL, option.Min );
+            option.HasMax = readValue( option, ftkOptionGetter::FTK_MAX_VAL, option.Max );
+        }
+        if ( option.Readable && option.Writable )
+        {
+            option.HasDefault = readValue( option, ftkOptionGetter::FTK_DEF_VAL, option.Default );
+        }
+    }
+    refreshValues();
+
+    return true;
+}
+
+bool OptionCatalog::refreshValue( uint32 id )
+{
+    unordered_map< uint32, uint32 >::const_iterator it( _ById.find( id ) );
+    if ( it == _ById.end() )
+    {
+        return false;
+    }
+    OptionInfo& option( _Options[ it->second ] );
+    if ( !option.Readable || option.Name == CHALLENGE_RESULT )
+    {
+        return false;
+    }
+
+    if ( option.Type == ftkOptionType::FTK_DATA )
+    {
+        ftkBuffer buffer{};
+        option.HasValue = ftkGetData( _Library, _SerialNumber, option.Id, &buffer ) == ftkError::FTK_OK;
+        uint32 size( option.HasValue ? min( buffer.size, uint32( sizeof( buffer.data ) ) ) : 0u );
+        while ( size != 0u && buffer.data[ size - 1u ] == '\0' )
+        {
+            --size;
+        }
+        option.Data.assign( buffer.data, size );
+    }
+    else
+    {
+        option.HasValue = readValue( option, ftkOptionGetter::FTK_VALUE, option.Value );
+    }
+    return option.HasValue;
+}
+
+bool OptionCatalog::refreshValues()
+{
+    bool ok( true );
+    for ( const OptionInfo& option : _Options )
+    {
+        if ( option.Readable && option.Name != CHALLENGE_RESULT && !refreshValue( option.Id ) )
+        {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+const OptionInfo* OptionCatalog::find( uint32 id ) const
+{
+    unordered_map< uint32, uint32 >::const_iterator it( _ById.find( id ) );
+    return it != _ById.end() ? &_Options[ it->second ] : nullptr;
+}
+
+const OptionInfo* OptionCatalog::find( const string& name ) const
+{
+    unordered_map< string, uint32 >::const_iterator it( _ByName.find( name ) );
+    return it != _ByName.end() ? &_Options[ it->second ] : nullptr;
+}
+
+ftkLibrary OptionCatalog::library() const
+{
+    return _Library;
+}
+
+uint64 OptionCatalog::serialNumber() const
+{
+    return _SerialNumber;
+}
+
+uint32 OptionCatalog::size() const
+{
+    return uint32( _Options.size() );
+}
+
+const OptionInfo& OptionCatalog::operator[]( uint32 index ) const
+{
+    return _Options[ index ];
+}
+
+void OptionCatalog::print( ostream& out ) const
+{
+    for ( const OptionInfo& option : _Options )
+    {
+        out << "Option " << option.Id << "  " << option.Name << "\n";
+        out << "\tCOMP:  " << componentName( option.Component ) << "\n";
+        out << "\tDESC:  " << option.Description << "\n";
+        if ( !option.Unit.empty() )
+        {
+            out << "\tUNIT:  " << option.Unit << "\n";
+        }
+        out << "\tSTAT:  " << ( option.Readable ? "(READ)" : "" ) << ( option.Writable ? "(WRITE)" : "" )
+            << "\n";
+
+        switch ( option.Type )
+        {
+        case ftkOptionType::FTK_INT32:
+            out << "\tTYPE:  int32\n";
+            break;
+        case ftkOptionType::FTK_FLOAT32:
+            out << "\tTYPE:  float32\n";
+            break;
+        case ftkOptionType::FTK_DATA:
+            out << "\tTYPE:  data\n";
+            break;
+        default:
+            out << "\tTYPE:  ????\n";
+            break;
+        }
+
+        if ( option.Type == ftkOptionType::FTK_DATA )
+        {
+            if ( option.HasValue )
+            {
+                out << "\tVAL:   " << option.Data << "\n";
+            }
+        }
+        else
+        {
+            if ( option.HasMin )
+            {
+                printValue( out, "MIN:   ", option, option.Min );
+            }
+            if ( option.HasMax )
+            {
+                printValue( out, "MAX:   ", option, option.Max );
+            }
+            if ( option.HasDefault )
+            {
+                printValue( out, "DEF:   ", option, option.Default );
+            }
+            if ( option.HasValue )
+            {
+                printValue( out, "VAL:   ", option, option.Value );
+            }
+        }
+        out << "\n";
+    }
+    out.flush();
+}
+
+// ----------------------------------------------------------------------------
+
+void OptionCatalog::enumerator( uint64 /* sn */, void* user, ftkOptionsInfo* oi )
+{
+    vector< OptionInfo >* options( reinterpret_cast< vector< OptionInfo >* >( user ) );
+    if ( options == nullptr || oi == nullptr )
+    {
+        return;
+    }
+
+    OptionInfo option;
+    option.Id = oi->id;
+    option.Name = oi->name != nullptr ? oi->name : "";
+    option.Description = oi->description != nullptr ? oi->description : "";
+    option.Unit = oi->unit != nullptr ? oi->unit : "";
+    option.Component = oi->component;
+    option.Type = oi->type;
+    option.Readable = oi->status.read != 0u;
+    option.Writable = oi->status.write != 0u;
+    options->push_back( option );
+}
+
+bool OptionCatalog::readValue( const OptionInfo& option, ftkOptionGetter what, OptionValue& value ) const
+{
+    if ( option.Type == ftkOptionType::FTK_FLOAT32 )
+    {
+        return ftkGetFloat32( _Library, _SerialNumber, option.Id, &value.Float, what ) == ftkError::FTK_OK;
+    }
+    return ftkGetInt32( _Library, _SerialNumber, option.Id, &value.Int, what ) == ftkError::FTK_OK;
+}
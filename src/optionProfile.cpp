@@ -0,0 +1,340 @@
+#include "optionProfile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+    string trim( const string& text )
+    {
+        const size_t first( text.find_first_not_of( " \t\r" ) );
+        if ( first == string::npos )
+        {
+            return "";
+        }
+        return text.substr( first, text.find_last_not_of( " \t\r" ) + 1u - first );
+    }
+
+    const OptionInfo* findOption( const OptionCatalog& catalog, const string& option )
+    {
+        if ( !option.empty() && all_of( option.begin(), option.end(), []( char c ) { return c >= '0' && c <= '9'; } ) )
+        {
+            errno = 0;
+            const unsigned long id( strtoul( option.c_str(), nullptr, 10 ) );
+            return errno == 0 && id <= numeric_limits< uint32 >::max() ? catalog.find( uint32( id ) ) : nullptr;
+        }
+        return catalog.find( option );
+    }
+
+    bool parseValue( const OptionInfo& option, const string& text, OptionValue& value )
+    {
+        if ( text.empty() )
+        {
+            return false;
+        }
+        char* end( nullptr );
+        errno = 0;
+        if ( option.Type == ftkOptionType::FTK_FLOAT32 )
+        {
+            value.Float = strtof( text.c_str(), &end );
+            return errno == 0 && *end == '\0' && ( !option.HasMin || value.Float >= option.Min.Float ) &&
+                   ( !option.HasMax || value.Float <= option.Max.Float );
+        }
+        const long number( strtol( text.c_str(), &end, 10 ) );
+        if ( errno != 0 || *end != '\0' || number < numeric_limits< int32 >::min() ||
+             number > numeric_limits< int32 >::max() )
+        {
+            return false;
+        }
+        value.Int = int32( number );
+        return ( !option.HasMin || value.Int >= option.Min.Int ) && ( !option.HasMax || value.Int <= option.Max.Int );
+    }
+
+    bool sameValue( const OptionInfo& option, const OptionValue& value, const string& data )
+    {
+        if ( !option.HasValue )
+        {
+            return false;
+        }
+        switch ( option.Type )
+        {
+        case ftkOptionType::FTK_INT32:
+            return option.Value.Int == value.Int;
+        case ftkOptionType::FTK_FLOAT32:
+            // The device may round the value it stores.
+            return fabs( option.Value.Float - value.Float ) <=
+                   1e-6f * max( 1.0f, fabs( value.Float ) );
+        default:
+            return option.Data == data;
+        }
+    }
+
+    string currentValue( const OptionInfo& option )
+    {
+        if ( !option.HasValue )
+        {
+            return "";
+        }
+        switch ( option.Type )
+        {
+        case ftkOptionType::FTK_INT32:
+            return to_string( option.Value.Int );
+        case ftkOptionType::FTK_FLOAT32:
+        {
+            ostringstream out;
+            out << option.Value.Float;
+            return out.str();
+        }
+        default:
+            return option.Data;
+        }
+    }
+
+    bool writeValue( const OptionCatalog& catalog, const OptionInfo& option, const OptionValue& value,
+                     const string& data )
+    {
+        switch ( option.Type )
+        {
+        case ftkOptionType::FTK_INT32:
+            return ftkSetInt32( catalog.library(), catalog.serialNumber(), option.Id, value.Int ) ==
+                   ftkError::FTK_OK;
+        case ftkOptionType::FTK_FLOAT32:
+            return ftkSetFloat32( catalog.library(), catalog.serialNumber(), option.Id, value.Float ) ==
+                   ftkError::FTK_OK;
+        default:
+        {
+            ftkBuffer buffer{};
+            if ( data.size() >= sizeof( buffer.data ) )
+            {
+                return false;
+            }
+            memcpy( buffer.data, data.c_str(), data.size() + 1u );
+            buffer.size = uint32( data.size() + 1u );
+            return ftkSetData( catalog.library(), catalog.serialNumber(), option.Id, &buffer ) ==
+                   ftkError::FTK_OK;
+        }
+        }
+    }
+
+    const char* statusName( OptionApplyStatus status )
+    {
+        switch ( status )
+        {
+        case OptionApplyStatus::Unchanged:
+            return "unchanged";
+        case OptionApplyStatus::Written:
+            return "written";
+        case OptionApplyStatus::UnknownOption:
+            return "unknown option";
+        case OptionApplyStatus::InvalidValue:
+            return "invalid value";
+        case OptionApplyStatus::ReadOnly:
+            return "read-only option";
+        case OptionApplyStatus::WriteFailed:
+            return "write failed";
+        case OptionApplyStatus::Mismatch:
+            return "value not applied";
+        default:
+            return "????";
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool OptionApplyReport::ok() const
+{
+    return Failed == 0u;
+}
+
+void OptionApplyReport::print( ostream& out ) const
+{
+    for ( const OptionApplyResult& result : Results )
+    {
+        if ( result.Status == OptionApplyStatus::Unchanged )
+        {
+            continue;
+        }
+        out << "Option " << result.Setting.Option;
+        if ( result.Setting.Line != 0u )
+        {
+            out << " (line " << result.Setting.Line << ")";
+        }
+        out << ": " << statusName( result.Status ) << ", requested " << result.Setting.Value;
+        if ( !result.Previous.empty() )
+        {
+            out << ", was " << result.Previous;
+        }
+        if ( result.Status != OptionApplyStatus::Written && !result.Current.empty() )
+        {
+            out << ", is " << result.Current;
+        }
+        out << "\n";
+    }
+    out << "Profile '" << Profile << "': " << Written << " written, " << Unchanged << " unchanged, " << Failed
+        << " failed in " << ApplyUS << " us" << endl;
+}
+
+// ----------------------------------------------------------------------------
+
+bool loadOptionProfiles( const string& fileName, vector< OptionProfile >& profiles )
+{
+    profiles.clear();
+    ifstream input( fileName );
+    if ( !input.is_open() )
+    {
+        return false;
+    }
+    return readOptionProfiles( input, profiles );
+}
+
+bool readOptionProfiles( istream& input, vector< OptionProfile >& profiles )
+{
+    profiles.clear();
+    string line;
+    for ( uint32 number( 1u ); getline( input, line ); ++number )
+    {
+        line = trim( line );
+        if ( line.empty() || line[ 0u ] == '#' || line[ 0u ] == ';' )
+        {
+            continue;
+        }
+        if ( line[ 0u ] == '[' )
+        {
+            if ( line.back() != ']' )
+            {
+                cerr << "Option profiles, line " << number << ": malformed section" << endl;
+                return false;
+            }
+            profiles.push_back( OptionProfile() );
+            profiles.back().Name = trim( line.substr( 1u, line.size() - 2u ) );
+            continue;
+        }
+
+        const size_t equal( line.find( '=' ) );
+        if ( equal == string::npos )
+        {
+            cerr << "Option profiles, line " << number << ": expected 'option = value'" << endl;
+            return false;
+        }
+        if ( profiles.empty() )
+        {
+            profiles.push_back( OptionProfile() );
+            profiles.back().Name = "default";
+        }
+        OptionSetting setting;
+        setting.Option = trim( line.substr( 0u, equal ) );
+        setting.Value = trim( line.substr( equal + 1u ) );
+        setting.Line = number;
+        profiles.back().Settings.push_back( setting );
+    }
+
+    return true;
+}
+
+const OptionProfile* findOptionProfile( const vector< OptionProfile >& profiles, const string& name )
+{
+    for ( const OptionProfile& profile : profiles )
+    {
+        if ( profile.Name == name )
+        {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+OptionApplyReport applyOptionProfile( OptionCatalog& catalog, const OptionProfile& profile )
+{
+    const chrono::steady_clock::time_point start( chrono::steady_clock::now() );
+    OptionApplyReport report;
+    report.Profile = profile.Name;
+    report.Results.resize( profile.Settings.size() );
+    vector< OptionValue > values( profile.Settings.size() );
+
+    // First pass: resolve the options and read their current values.
+    vector< size_t > pending;
+    for ( size_t i( 0u ); i < profile.Settings.size(); ++i )
+    {
+        OptionApplyResult& result( report.Results[ i ] );
+        result.Setting = profile.Settings[ i ];
+        const OptionInfo* option( findOption( catalog, result.Setting.Option ) );
+        if ( option == nullptr )
+        {
+            continue;
+        }
+        result.Id = option->Id;
+        if ( !option->Writable )
+        {
+            result.Status = OptionApplyStatus::ReadOnly;
+            continue;
+        }
+        if ( option->Type != ftkOptionType::FTK_DATA && !parseValue( *option, result.Setting.Value, values[ i ] ) )
+        {
+            result.Status = OptionApplyStatus::InvalidValue;
+            continue;
+        }
+        catalog.refreshValue( option->Id );
+        result.Previous = currentValue( *option );
+        if ( sameValue( *option, values[ i ], result.Setting.Value ) )
+        {
+            result.Status = OptionApplyStatus::Unchanged;
+            result.Current = result.Previous;
+            continue;
+        }
+        pending.push_back( i );
+    }
+
+    // Second pass: write the differing values.
+    vector< size_t > written;
+    for ( size_t i : pending )
+    {
+        OptionApplyResult& result( report.Results[ i ] );
+        if ( !writeValue( catalog, *catalog.find( result.Id ), values[ i ], result.Setting.Value ) )
+        {
+            result.Status = OptionApplyStatus::WriteFailed;
+            continue;
+        }
+        written.push_back( i );
+    }
+
+    // Third pass: read back what was written.
+    for ( size_t i : written )
+    {
+        OptionApplyResult& result( report.Results[ i ] );
+        const OptionInfo& option( *catalog.find( result.Id ) );
+        catalog.refreshValue( option.Id );
+        result.Current = currentValue( option );
+        result.Status = !option.Readable || sameValue( option, values[ i ], result.Setting.Value )
+                          ? OptionApplyStatus::Written
+                          : OptionApplyStatus::Mismatch;
+    }
+
+    for ( const OptionApplyResult& result : report.Results )
+    {
+        if ( result.Status == OptionApplyStatus::Written )
+        {
+            ++report.Written;
+        }
+        else if ( result.Status == OptionApplyStatus::Unchanged )
+        {
+            ++report.Unchanged;
+        }
+        else
+        {
+            ++report.Failed;
+        }
+    }
+    report.ApplyUS = chrono::duration< float64, micro >( chrono::steady_clock::now() - start ).count();
+    return report;
+}
@@ -0,0 +1,242 @@
+#include "poseFilter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+    const float32 TWO_PI( 6.28318531f );
+
+    // Smoothing factor of a first order low-pass filter, 0 when the step is
+    // 0.
+    inline float32 smoothing( float32 cutoffHz, float32 stepS )
+    {
+        const float32 r( TWO_PI * cutoffHz * stepS );
+        return r / ( r + 1.0f );
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+PoseFilter::PoseFilter( const Settings& settings )
+    : _Settings( settings )
+    , _SlotCount( 0u )
+{
+    reset();
+}
+
+void PoseFilter::reset()
+{
+    // Unused slots stay at zero: a zero step and no restart, the vector
+    // passes leave them unchanged.
+    _SlotCount = 0u;
+    fill( _MarkerSlot, _MarkerSlot + MAX_TRACKED_MARKERS, 0u );
+    fill( _LastSeenUS, _LastSeenUS + MAX_FILTERED_GEOMETRIES, 0u );
+    fill( _StepS, _StepS + MAX_FILTERED_GEOMETRIES, 0.0f );
+    fill( _Restart, _Restart + MAX_FILTERED_GEOMETRIES, 0.0f );
+    for ( uint32 k( 0u ); k < POSE_FILTER_CHANNELS; ++k )
+    {
+        fill( _Measured[ k ], _Measured[ k ] + MAX_FILTERED_GEOMETRIES, 0.0f );
+        fill( _Value[ k ], _Value[ k ] + MAX_FILTERED_GEOMETRIES, 0.0f );
+        fill( _Derivative[ k ], _Derivative[ k ] + MAX_FILTERED_GEOMETRIES, 0.0f );
+    }
+}
+
+uint32 PoseFilter::trackedGeometries() const
+{
+    return _SlotCount;
+}
+
+uint32 PoseFilter::slotOf( uint32 geometryId, uint32 marker )
+{
+    // Markers usually come in the same order from frame to frame.
+    const uint32 previous( _MarkerSlot[ marker ] );
+    if ( previous < _SlotCount && _GeometryId[ previous ] == geometryId )
+    {
+        return previous;
+    }
+    for ( uint32 s( 0u ); s < _SlotCount; ++s )
+    {
+        if ( _GeometryId[ s ] == geometryId )
+        {
+            return s;
+        }
+    }
+
+    // New geometry, when all the slots are taken the one not seen for the
+    // longest time is given up.
+    uint32 slot( _SlotCount );
+    if ( _SlotCount < MAX_FILTERED_GEOMETRIES )
+    {
+        ++_SlotCount;
+    }
+    else
+    {
+        slot = uint32( min_element( _LastSeenUS, _LastSeenUS + MAX_FILTERED_GEOMETRIES ) - _LastSeenUS );
+    }
+    _GeometryId[ slot ] = geometryId;
+    _LastSeenUS[ slot ] = 0u;
+    for ( uint32 k( 0u ); k < POSE_FILTER_CHANNELS; ++k )
+    {
+        _Value[ k ][ slot ] = 0.0f;
+        _Derivative[ k ][ slot ] = 0.0f;
+    }
+    return slot;
+}
+
+void PoseFilter::filter( const PoseStore& raw, PoseStore& filtered )
+{
+    const uint32 count( min( raw.count, MAX_TRACKED_MARKERS ) );
+
+    // Gathers the measurements in the slot order.
+    fill( _StepS, _StepS + MAX_FILTERED_GEOMETRIES, 0.0f );
+    fill( _Restart, _Restart + MAX_FILTERED_GEOMETRIES, 0.0f );
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        const uint32 slot( slotOf( raw.geometryId[ i ], i ) );
+        _MarkerSlot[ i ] = slot;
+
+        const uint64 lastSeenUS( _LastSeenUS[ slot ] );
+        if ( lastSeenUS != 0u && raw.timestampUS > lastSeenUS &&
+             raw.timestampUS - lastSeenUS <= _Settings.ReacquireTimeoutUS )
+        {
+            _StepS[ slot ] = float32( raw.timestampUS - lastSeenUS ) * 1e-6f;
+        }
+        else
+        {
+            _Restart[ slot ] = 1.0f;
+        }
+        _LastSeenUS[ slot ] = raw.timestampUS;
+
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            _Measured[ r ][ slot ] = raw.translationMM[ r ][ i ];
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                _Measured[ 3u + 3u * r + c ][ slot ] = raw.rotation[ r ][ c ][ i ];
+            }
+        }
+    }
+
+    // From here every loop runs over all the slots, used or not, without
+    // branch: a fixed trip count lets the compiler vectorise them without
+    // remainder loop. The divisions and square roots are done once per
+    // slot, the loops over the channels are only multiply-adds. A missing
+    // geometry has a zero step, so its smoothing factors are zero and its
+    // state is left unchanged; a restarting one has factors of one and no
+    // speed.
+    const uint32 slots( MAX_FILTERED_GEOMETRIES );
+    for ( uint32 s( 0u ); s < slots; ++s )
+    {
+        const float32 step( _StepS[ s ] );
+        const float32 restart( _Restart[ s ] );
+        const float32 alpha( smoothing( _Settings.DerivativeCutoffHz, step ) );
+        _InverseStep[ s ] = step > 0.0f ? 1.0f / step : 0.0f;
+        _DerivativeAlpha[ s ] = alpha + restart * ( 1.0f - alpha );
+    }
+    for ( uint32 k( 0u ); k < POSE_FILTER_CHANNELS; ++k )
+    {
+        const float32* measured( _Measured[ k ] );
+        const float32* value( _Value[ k ] );
+        float32* derivative( _Derivative[ k ] );
+        for ( uint32 s( 0u ); s < slots; ++s )
+        {
+            const float32 rate( ( measured[ s ] - value[ s ] ) * _InverseStep[ s ] );
+            derivative[ s ] += _DerivativeAlpha[ s ] * ( rate - derivative[ s ] );
+        }
+    }
+
+    for ( uint32 s( 0u ); s < slots; ++s )
+    {
+        _Alpha[ 0u ][ s ] = 0.0f;
+        _Alpha[ 1u ][ s ] = 0.0f;
+    }
+    for ( uint32 k( 0u ); k < POSE_FILTER_CHANNELS; ++k )
+    {
+        const float32* derivative( _Derivative[ k ] );
+        float32* squaredSpeed( _Alpha[ k < 3u ? 0u : 1u ] );
+        for ( uint32 s( 0u ); s < slots; ++s )
+        {
+            squaredSpeed[ s ] += derivative[ s ] * derivative[ s ];
+        }
+    }
+    for ( uint32 s( 0u ); s < slots; ++s )
+    {
+        const float32 step( _StepS[ s ] );
+        const float32 restart( _Restart[ s ] );
+        const float32 translation(
+          smoothing( _Settings.MinCutoffHz + _Settings.Beta * sqrt( _Alpha[ 0u ][ s ] ), step ) );
+        const float32 rotation(
+          smoothing( _Settings.RotationMinCutoffHz + _Settings.RotationBeta * sqrt( _Alpha[ 1u ][ s ] ), step ) );
+        _Alpha[ 0u ][ s ] = translation + restart * ( 1.0f - translation );
+        _Alpha[ 1u ][ s ] = rotation + restart * ( 1.0f - rotation );
+    }
+    for ( uint32 k( 0u ); k < POSE_FILTER_CHANNELS; ++k )
+    {
+        const float32* alpha( _Alpha[ k < 3u ? 0u : 1u ] );
+        const float32* measured( _Measured[ k ] );
+        float32* value( _Value[ k ] );
+        for ( uint32 s( 0u ); s < slots; ++s )
+        {
+            value[ s ] += alpha[ s ] * ( measured[ s ] - value[ s ] );
+        }
+    }
+
+    // Gram-Schmidt on the rows of the filtered rotations, the third row is
+    // the cross product of the first two so that the determinant is +1.
+    float32* m[ 9u ];
+    for ( uint32 e( 0u ); e < 9u; ++e )
+    {
+        m[ e ] = _Value[ 3u + e ];
+    }
+    for ( uint32 s( 0u ); s < slots; ++s )
+    {
+        float32 x0( m[ 0u ][ s ] ), y0( m[ 1u ][ s ] ), z0( m[ 2u ][ s ] );
+        float32 x1( m[ 3u ][ s ] ), y1( m[ 4u ][ s ] ), z1( m[ 5u ][ s ] );
+        const float32 n0( 1.0f / sqrt( max( x0 * x0 + y0 * y0 + z0 * z0, 1e-12f ) ) );
+        x0 *= n0;
+        y0 *= n0;
+        z0 *= n0;
+        const float32 d( x0 * x1 + y0 * y1 + z0 * z1 );
+        x1 -= d * x0;
+        y1 -= d * y0;
+        z1 -= d * z0;
+        const float32 n1( 1.0f / sqrt( max( x1 * x1 + y1 * y1 + z1 * z1, 1e-12f ) ) );
+        x1 *= n1;
+        y1 *= n1;
+        z1 *= n1;
+        m[ 0u ][ s ] = x0;
+        m[ 1u ][ s ] = y0;
+        m[ 2u ][ s ] = z0;
+        m[ 3u ][ s ] = x1;
+        m[ 4u ][ s ] = y1;
+        m[ 5u ][ s ] = z1;
+        m[ 6u ][ s ] = y0 * z1 - z0 * y1;
+        m[ 7u ][ s ] = z0 * x1 - x0 * z1;
+        m[ 8u ][ s ] = x0 * y1 - y0 * x1;
+    }
+
+    // Scatters the filtered poses back in the marker order.
+    filtered.timestampUS = raw.timestampUS;
+    filtered.counter = raw.counter;
+    filtered.markersStat = raw.markersStat;
+    filtered.count = count;
+    filtered.receivedNS = raw.receivedNS;
+    filtered.publishedNS = raw.publishedNS;
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        const uint32 slot( _MarkerSlot[ i ] );
+        filtered.geometryId[ i ] = raw.geometryId[ i ];
+        filtered.registrationErrorMM[ i ] = raw.registrationErrorMM[ i ];
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            filtered.translationMM[ r ][ i ] = _Value[ r ][ slot ];
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                filtered.rotation[ r ][ c ][ i ] = _Value[ 3u + 3u * r + c ][ slot ];
+            }
+        }
+    }
+}
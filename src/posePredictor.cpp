@@ -0,0 +1,271 @@
+#include "posePredictor.hpp"
+
+#include "latencyHistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+    // Rotation vector of a rotation matrix, its norm is the angle.
+    void rotationLog( const float32 r[ 3u ][ 3u ], float32 w[ 3u ] )
+    {
+        const float32 cosine( max( -1.0f, min( 1.0f, 0.5f * ( r[ 0u ][ 0u ] + r[ 1u ][ 1u ] + r[ 2u ][ 2u ] - 1.0f ) ) ) );
+        const float32 angle( acos( cosine ) );
+        const float32 sine( sin( angle ) );
+        const float32 k( sine > 1e-6f ? 0.5f * angle / sine : 0.5f );
+        w[ 0u ] = k * ( r[ 2u ][ 1u ] - r[ 1u ][ 2u ] );
+        w[ 1u ] = k * ( r[ 0u ][ 2u ] - r[ 2u ][ 0u ] );
+        w[ 2u ] = k * ( r[ 1u ][ 0u ] - r[ 0u ][ 1u ] );
+    }
+
+    // Rotation matrix of a rotation vector, Rodrigues' formula.
+    void rotationExp( const float32 w[ 3u ], float32 r[ 3u ][ 3u ] )
+    {
+        // Extrapolations are short, the angle is usually small enough for
+        // the series expansion, which avoids sin and cos.
+        const float32 squared( w[ 0u ] * w[ 0u ] + w[ 1u ] * w[ 1u ] + w[ 2u ] * w[ 2u ] );
+        float32 a( 1.0f - squared / 6.0f * ( 1.0f - squared / 20.0f ) );
+        float32 b( 0.5f - squared / 24.0f * ( 1.0f - squared / 30.0f ) );
+        if ( squared > 0.01f )
+        {
+            const float32 angle( sqrt( squared ) );
+            a = sin( angle ) / angle;
+            b = ( 1.0f - cos( angle ) ) / squared;
+        }
+        const float32 x( w[ 0u ] ), y( w[ 1u ] ), z( w[ 2u ] );
+        r[ 0u ][ 0u ] = 1.0f - b * ( y * y + z * z );
+        r[ 0u ][ 1u ] = b * x * y - a * z;
+        r[ 0u ][ 2u ] = b * x * z + a * y;
+        r[ 1u ][ 0u ] = b * x * y + a * z;
+        r[ 1u ][ 1u ] = 1.0f - b * ( x * x + z * z );
+        r[ 1u ][ 2u ] = b * y * z - a * x;
+        r[ 2u ][ 0u ] = b * x * z - a * y;
+        r[ 2u ][ 1u ] = b * y * z + a * x;
+        r[ 2u ][ 2u ] = 1.0f - b * ( x * x + y * y );
+    }
+
+    // c = a * transpose( b ) when transposeB, a * b otherwise.
+    void multiply( const float32 a[ 3u ][ 3u ], const float32 b[ 3u ][ 3u ], bool transposeB, float32 c[ 3u ][ 3u ] )
+    {
+        for ( uint32 i( 0u ); i < 3u; ++i )
+        {
+            for ( uint32 j( 0u ); j < 3u; ++j )
+            {
+                float32 sum( 0.0f );
+                for ( uint32 k( 0u ); k < 3u; ++k )
+                {
+                    sum += a[ i ][ k ] * ( transposeB ? b[ j ][ k ] : b[ k ][ j ] );
+                }
+                c[ i ][ j ] = sum;
+            }
+        }
+    }
+
+    // Angle of the rotation between two rotation matrices.
+    float32 angleBetween( const float32 a[ 3u ][ 3u ], const float32 b[ 3u ][ 3u ] )
+    {
+        float32 trace( 0.0f );
+        for ( uint32 i( 0u ); i < 3u; ++i )
+        {
+            for ( uint32 j( 0u ); j < 3u; ++j )
+            {
+                trace += a[ i ][ j ] * b[ i ][ j ];
+            }
+        }
+        return acos( max( -1.0f, min( 1.0f, 0.5f * ( trace - 1.0f ) ) ) );
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+PosePredictor::PosePredictor( const Settings& settings )
+    : _Settings( settings )
+    , _ClockOffsetNS( 0 )
+    , _LastTimestampUS( 0u )
+    , _HasOffset( false )
+    , _SlotCount( 0u )
+    , _Motions{}
+    , _PublishedSlots( 0u )
+{
+    for ( std::atomic< uint32 >& id : _GeometryIds )
+    {
+        id.store( 0u, memory_order_relaxed );
+    }
+}
+
+void PosePredictor::update( const PoseStore& poses )
+{
+    // Host time of the frame: the device timestamp is free of the host
+    // scheduling jitter, it is mapped with the smallest offset seen, which
+    // may grow by the tolerated drift.
+    int64 timeNS( poses.receivedNS != 0 ? poses.receivedNS : latencyClockNS() );
+    if ( poses.timestampUS != 0u && poses.receivedNS != 0 )
+    {
+        const int64 offset( poses.receivedNS - int64( poses.timestampUS ) * 1000 );
+        if ( !_HasOffset || offset < _ClockOffsetNS )
+        {
+            _ClockOffsetNS = offset;
+        }
+        else if ( poses.timestampUS > _LastTimestampUS )
+        {
+            const int64 drift( int64( poses.timestampUS - _LastTimestampUS ) * PREDICTOR_CLOCK_DRIFT_PPM / 1000 );
+            _ClockOffsetNS += min( offset - _ClockOffsetNS, drift );
+        }
+        _HasOffset = true;
+        _LastTimestampUS = poses.timestampUS;
+        timeNS = int64( poses.timestampUS ) * 1000 + _ClockOffsetNS;
+    }
+
+    const int64 maxHorizonNS( int64( _Settings.MaxHorizonMS ) * 1000000 );
+    const uint32 count( min( poses.count, MAX_TRACKED_MARKERS ) );
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        const uint32 geometryId( poses.geometryId[ i ] );
+        uint32 slot( 0u );
+        while ( slot < _SlotCount && _Motions[ slot ].GeometryId != geometryId )
+        {
+            ++slot;
+        }
+        if ( slot == _SlotCount )
+        {
+            if ( _SlotCount < MAX_PREDICTED_GEOMETRIES )
+            {
+                ++_SlotCount;
+            }
+            else
+            {
+                slot = 0u;
+                for ( uint32 s( 1u ); s < MAX_PREDICTED_GEOMETRIES; ++s )
+                {
+                    slot = _Motions[ s ].TimeNS < _Motions[ slot ].TimeNS ? s : slot;
+                }
+            }
+            _Motions[ slot ].Samples = 0u;
+            _Motions[ slot ].GeometryId = geometryId;
+            _GeometryIds[ slot ].store( geometryId, memory_order_relaxed );
+        }
+
+        Motion& motion( _Motions[ slot ] );
+        float32 translationMM[ 3u ], rotation[ 3u ][ 3u ];
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            translationMM[ r ] = poses.translationMM[ r ][ i ];
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                rotation[ r ][ c ] = poses.rotation[ r ][ c ][ i ];
+            }
+        }
+
+        const int64 stepNS( timeNS - motion.TimeNS );
+        if ( motion.Samples == 0u || stepNS <= 0 || stepNS > maxHorizonNS )
+        {
+            // First pose, or after a long dropout: no velocity yet.
+            motion.Samples = 1u;
+            motion.IntervalS = 0.0f;
+            motion.SquaredResidualMM = 0.0f;
+            motion.SquaredResidualRad = 0.0f;
+            fill( motion.VelocityMMS, motion.VelocityMMS + 3u, 0.0f );
+            fill( motion.AngularVelocityRadS, motion.AngularVelocityRadS + 3u, 0.0f );
+        }
+        else
+        {
+            const float32 stepS( float32( stepNS ) * 1e-9f );
+            if ( motion.Samples >= 2u )
+            {
+                // Error of the prediction of this pose from the previous
+                // ones.
+                float32 predictedMM[ 3u ], predictedRotation[ 3u ][ 3u ];
+                extrapolate( motion, stepS, predictedMM, predictedRotation );
+                float32 squaredMM( 0.0f );
+                for ( uint32 r( 0u ); r < 3u; ++r )
+                {
+                    squaredMM += ( translationMM[ r ] - predictedMM[ r ] ) * ( translationMM[ r ] - predictedMM[ r ] );
+                }
+                const float32 angle( angleBetween( predictedRotation, rotation ) );
+                const float32 weight( motion.Samples == 2u ? 1.0f : _Settings.ResidualSmoothing );
+                motion.SquaredResidualMM += weight * ( squaredMM - motion.SquaredResidualMM );
+                motion.SquaredResidualRad += weight * ( angle * angle - motion.SquaredResidualRad );
+            }
+
+            float32 relative[ 3u ][ 3u ], angularStep[ 3u ];
+            multiply( rotation, motion.Rotation, true, relative );
+            rotationLog( relative, angularStep );
+            const float32 weight( motion.Samples == 1u ? 1.0f : _Settings.VelocitySmoothing );
+            for ( uint32 r( 0u ); r < 3u; ++r )
+            {
+                const float32 velocity( ( translationMM[ r ] - motion.TranslationMM[ r ] ) / stepS );
+                motion.VelocityMMS[ r ] += weight * ( velocity - motion.VelocityMMS[ r ] );
+                motion.AngularVelocityRadS[ r ] += weight * ( angularStep[ r ] / stepS - motion.AngularVelocityRadS[ r ] );
+            }
+            motion.IntervalS += ( motion.Samples == 1u ? 1.0f : 0.1f ) * ( stepS - motion.IntervalS );
+            ++motion.Samples;
+        }
+        motion.TimeNS = timeNS;
+        copy( translationMM, translationMM + 3u, motion.TranslationMM );
+        copy( &rotation[ 0u ][ 0u ], &rotation[ 0u ][ 0u ] + 9u, &motion.Rotation[ 0u ][ 0u ] );
+
+        _Published[ slot ].store( motion );
+    }
+    _PublishedSlots.store( _SlotCount, memory_order_release );
+}
+
+bool PosePredictor::predict( uint32 geometryId, int64 timeNS, PosePrediction& prediction ) const
+{
+    const uint32 slots( _PublishedSlots.load( memory_order_acquire ) );
+    uint32 slot( 0u );
+    while ( slot < slots && _GeometryIds[ slot ].load( memory_order_relaxed ) != geometryId )
+    {
+        ++slot;
+    }
+    if ( slot == slots )
+    {
+        return false;
+    }
+
+    // The slot may have been given to another geometry meanwhile.
+    const Motion motion( _Published[ slot ].load() );
+    const int64 ageNS( timeNS - motion.TimeNS );
+    if ( motion.GeometryId != geometryId || motion.Samples == 0u ||
+         ageNS > int64( _Settings.MaxHorizonMS ) * 1000000 || ageNS < -int64( _Settings.MaxHorizonMS ) * 1000000 )
+    {
+        return false;
+    }
+
+    const float32 horizonS( float32( ageNS ) * 1e-9f );
+    prediction.GeometryId = geometryId;
+    prediction.TimeNS = timeNS;
+    prediction.AgeNS = ageNS;
+    extrapolate( motion, horizonS, prediction.TranslationMM, prediction.Rotation );
+
+    // The residuals are measured one frame ahead, the error is assumed to
+    // grow linearly with the horizon beyond that.
+    if ( motion.Samples < 3u )
+    {
+        prediction.PositionBoundMM = numeric_limits< float32 >::infinity();
+        prediction.AngleBoundRad = numeric_limits< float32 >::infinity();
+    }
+    else
+    {
+        const float32 scale( _Settings.BoundScale * max( 1.0f, fabs( horizonS ) / motion.IntervalS ) );
+        prediction.PositionBoundMM = scale * sqrt( motion.SquaredResidualMM );
+        prediction.AngleBoundRad = scale * sqrt( motion.SquaredResidualRad );
+    }
+    return true;
+}
+
+void PosePredictor::extrapolate( const Motion& motion, float32 horizonS, float32 translationMM[ 3u ],
+                                 float32 rotation[ 3u ][ 3u ] )
+{
+    float32 angularStep[ 3u ], step[ 3u ][ 3u ];
+    for ( uint32 r( 0u ); r < 3u; ++r )
+    {
+        translationMM[ r ] = motion.TranslationMM[ r ] + motion.VelocityMMS[ r ] * horizonS;
+        angularStep[ r ] = motion.AngularVelocityRadS[ r ] * horizonS;
+    }
+    rotationExp( angularStep, step );
+    multiply( step, motion.Rotation, false, rotation );
+}
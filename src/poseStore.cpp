@@ -0,0 +1,61 @@
+#include "poseStore.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+void PoseStore::clear()
+{
+    timestampUS = 0u;
+    counter = 0u;
+    markersStat = ftkQueryStatus::QS_OK;
+    count = 0u;
+    receivedNS = 0;
+    publishedNS = 0;
+}
+
+void PoseStore::fill( const ftkFrameQuery& frame )
+{
+    if ( frame.imageHeader != nullptr )
+    {
+        timestampUS = frame.imageHeader->timestampUS;
+        counter = frame.imageHeader->counter;
+    }
+    else
+    {
+        timestampUS = 0u;
+        counter = 0u;
+    }
+    markersStat = frame.markersStat;
+    count = min( frame.markersCount, MAX_TRACKED_MARKERS );
+
+    const ftkMarker* markers( frame.markers );
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        const ftkMarker& marker( markers[ i ] );
+        geometryId[ i ] = marker.geometryId;
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            translationMM[ r ][ i ] = static_cast< float32 >( marker.translationMM[ r ] );
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                rotation[ r ][ c ][ i ] = static_cast< float32 >( marker.rotation[ r ][ c ] );
+            }
+        }
+        registrationErrorMM[ i ] = static_cast< float32 >( marker.registrationErrorMM );
+    }
+}
+
+int32 PoseStore::find( uint32 id ) const
+{
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        if ( geometryId[ i ] == id )
+        {
+            return int32( i );
+        }
+    }
+    return -1;
+}
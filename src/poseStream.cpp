@@ -0,0 +1,923 @@
+// winsock2.h must come before any inclusion of windows.h, hence before the
+// SDK headers defining ATR_WIN.
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment( lib, "ws2_32.lib" )
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "poseStream.hpp"
+
+#include "latencyHistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+#ifdef ATR_WIN
+    typedef SOCKET NativeSocket;
+#else
+    typedef int NativeSocket;
+#endif
+
+    /** Value of a closed socket. */
+    const int64 NO_SOCKET( -1 );
+
+    /** Time the background thread sleeps when no frame is pending. */
+    const chrono::microseconds IDLE_PERIOD( 100 );
+
+    /** Longest time a TCP client may block a send, clients slower than this
+     * are disconnected. */
+    const uint32 SEND_TIMEOUT_MS( 100u );
+
+    /** Receive buffer of the UDP clients, absorbs bursts of packets. */
+    const int RECEIVE_BUFFER_SIZE( 1 << 20 );
+
+    /** A packet this far behind the expected sequence number means the
+     * server was restarted. */
+    const uint32 SEQUENCE_RESTART( 1024u );
+
+    /** Scale of the quantized quaternion components. */
+    const float32 QUATERNION_SCALE( 32767.0f );
+
+    NativeSocket native( int64 socket )
+    {
+        return NativeSocket( socket );
+    }
+
+    bool startSockets()
+    {
+#ifdef ATR_WIN
+        static const bool started( []() {
+            WSADATA data;
+            return WSAStartup( MAKEWORD( 2, 2 ), &data ) == 0;
+        }() );
+        return started;
+#else
+        return true;
+#endif
+    }
+
+    int64 createSocket( int type )
+    {
+        const NativeSocket socket( ::socket( AF_INET, type, 0 ) );
+#ifdef ATR_WIN
+        return socket == INVALID_SOCKET ? NO_SOCKET : int64( socket );
+#else
+        return socket < 0 ? NO_SOCKET : int64( socket );
+#endif
+    }
+
+    void closeSocket( int64& socket )
+    {
+        if ( socket == NO_SOCKET )
+        {
+            return;
+        }
+#ifdef ATR_WIN
+        closesocket( native( socket ) );
+#else
+        ::close( native( socket ) );
+#endif
+        socket = NO_SOCKET;
+    }
+
+    void setBlocking( int64 socket, bool blocking )
+    {
+#ifdef ATR_WIN
+        u_long nonBlocking( blocking ? 0u : 1u );
+        ioctlsocket( native( socket ), FIONBIO, &nonBlocking );
+#else
+        const int flags( fcntl( native( socket ), F_GETFL, 0 ) );
+        fcntl( native( socket ), F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK );
+#endif
+    }
+
+    void setOption( int64 socket, int level, int option, int value )
+    {
+        setsockopt( native( socket ), level, option, reinterpret_cast< const char* >( &value ), sizeof( value ) );
+    }
+
+    void setSendTimeout( int64 socket, uint32 timeoutMS )
+    {
+#ifdef ATR_WIN
+        const DWORD timeout( timeoutMS );
+#else
+        timeval timeout;
+        timeout.tv_sec = time_t( timeoutMS / 1000u );
+        timeout.tv_usec = suseconds_t( timeoutMS % 1000u ) * 1000;
+#endif
+        setsockopt( native( socket ), SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast< const char* >( &timeout ),
+                    sizeof( timeout ) );
+    }
+
+    bool resolve( const string& host, uint16 port, sockaddr_in& address )
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        addrinfo* found( nullptr );
+        if ( getaddrinfo( host.c_str(), nullptr, &hints, &found ) != 0 || found == nullptr )
+        {
+            return false;
+        }
+        memcpy( &address, found->ai_addr, sizeof( sockaddr_in ) );
+        address.sin_port = htons( port );
+        freeaddrinfo( found );
+        return true;
+    }
+
+    /** Sends a whole buffer, the TCP stream may take it in several parts. */
+    bool sendAll( int64 socket, const uint8* data, uint32 size )
+    {
+#ifdef MSG_NOSIGNAL
+        const int flags( MSG_NOSIGNAL );
+#else
+        const int flags( 0 );
+#endif
+        while ( size != 0u )
+        {
+            const int sent(
+              int( send( native( socket ), reinterpret_cast< const char* >( data ), int( size ), flags ) ) );
+            if ( sent <= 0 )
+            {
+                return false;
+            }
+            data += sent;
+            size -= uint32( sent );
+        }
+        return true;
+    }
+
+    uint32 poseSize( uint32 encoding )
+    {
+        return encoding == uint32( PoseStreamEncoding::Quantized ) ? uint32( sizeof( QuantizedStreamedPose ) )
+                                                                   : uint32( sizeof( StreamedPose ) );
+    }
+
+    int32 quantize( float32 value, float32 scale )
+    {
+        const float64 scaled( std::round( float64( value ) * scale ) );
+        return int32( max( -2147483647.0, min( 2147483647.0, scaled ) ) );
+    }
+
+    /** Converts a rotation matrix into a unit quaternion (w, x, y, z), w
+     * positive, going through its largest component to stay accurate. */
+    void toQuaternion( const float32 r[ 3u ][ 3u ], float32 q[ 4u ] )
+    {
+        const float32 trace( r[ 0u ][ 0u ] + r[ 1u ][ 1u ] + r[ 2u ][ 2u ] );
+        if ( trace > 0.0f )
+        {
+            const float32 s( 2.0f * std::sqrt( trace + 1.0f ) );
+            q[ 0u ] = 0.25f * s;
+            q[ 1u ] = ( r[ 2u ][ 1u ] - r[ 1u ][ 2u ] ) / s;
+            q[ 2u ] = ( r[ 0u ][ 2u ] - r[ 2u ][ 0u ] ) / s;
+            q[ 3u ] = ( r[ 1u ][ 0u ] - r[ 0u ][ 1u ] ) / s;
+        }
+        else if ( r[ 0u ][ 0u ] > r[ 1u ][ 1u ] && r[ 0u ][ 0u ] > r[ 2u ][ 2u ] )
+        {
+            const float32 s( 2.0f * std::sqrt( 1.0f + r[ 0u ][ 0u ] - r[ 1u ][ 1u ] - r[ 2u ][ 2u ] ) );
+            q[ 0u ] = ( r[ 2u ][ 1u ] - r[ 1u ][ 2u ] ) / s;
+            q[ 1u ] = 0.25f * s;
+            q[ 2u ] = ( r[ 0u ][ 1u ] + r[ 1u ][ 0u ] ) / s;
+            q[ 3u ] = ( r[ 0u ][ 2u ] + r[ 2u ][ 0u ] ) / s;
+        }
+        else if ( r[ 1u ][ 1u ] > r[ 2u ][ 2u ] )
+        {
+            const float32 s( 2.0f * std::sqrt( 1.0f + r[ 1u ][ 1u ] - r[ 0u ][ 0u ] - r[ 2u ][ 2u ] ) );
+            q[ 0u ] = ( r[ 0u ][ 2u ] - r[ 2u ][ 0u ] ) / s;
+            q[ 1u ] = ( r[ 0u ][ 1u ] + r[ 1u ][ 0u ] ) / s;
+            q[ 2u ] = 0.25f * s;
+            q[ 3u ] = ( r[ 1u ][ 2u ] + r[ 2u ][ 1u ] ) / s;
+        }
+        else
+        {
+            const float32 s( 2.0f * std::sqrt( 1.0f + r[ 2u ][ 2u ] - r[ 0u ][ 0u ] - r[ 1u ][ 1u ] ) );
+            q[ 0u ] = ( r[ 1u ][ 0u ] - r[ 0u ][ 1u ] ) / s;
+            q[ 1u ] = ( r[ 0u ][ 2u ] + r[ 2u ][ 0u ] ) / s;
+            q[ 2u ] = ( r[ 1u ][ 2u ] + r[ 2u ][ 1u ] ) / s;
+            q[ 3u ] = 0.25f * s;
+        }
+        const float32 norm(
+          std::sqrt( q[ 0u ] * q[ 0u ] + q[ 1u ] * q[ 1u ] + q[ 2u ] * q[ 2u ] + q[ 3u ] * q[ 3u ] ) );
+        const float32 scale( norm > 0.0f ? ( q[ 0u ] < 0.0f ? -1.0f : 1.0f ) / norm : 0.0f );
+        for ( uint32 k( 0u ); k < 4u; ++k )
+        {
+            q[ k ] *= scale;
+        }
+    }
+
+    /** Converts a quaternion, not necessarily normalised, into a rotation
+     * matrix. */
+    void toMatrix( const float32 q[ 4u ], float32 r[ 3u ][ 3u ] )
+    {
+        const float32 w( q[ 0u ] ), x( q[ 1u ] ), y( q[ 2u ] ), z( q[ 3u ] );
+        const float32 norm( w * w + x * x + y * y + z * z );
+        const float32 s( norm > 0.0f ? 2.0f / norm : 0.0f );
+        r[ 0u ][ 0u ] = 1.0f - s * ( y * y + z * z );
+        r[ 0u ][ 1u ] = s * ( x * y - w * z );
+        r[ 0u ][ 2u ] = s * ( x * z + w * y );
+        r[ 1u ][ 0u ] = s * ( x * y + w * z );
+        r[ 1u ][ 1u ] = 1.0f - s * ( x * x + z * z );
+        r[ 1u ][ 2u ] = s * ( y * z - w * x );
+        r[ 2u ][ 0u ] = s * ( x * z - w * y );
+        r[ 2u ][ 1u ] = s * ( y * z + w * x );
+        r[ 2u ][ 2u ] = 1.0f - s * ( x * x + y * y );
+    }
+
+    /** Encodes the poses of a frame, returns the number of bytes written. */
+    uint32 encodeFrame( const PoseStore& poses, uint64 sn, PoseStreamEncoding encoding, uint8* out )
+    {
+        PoseStreamFrame frame{};
+        frame.serialNumber = sn;
+        frame.timestampUS = poses.timestampUS;
+        frame.receivedNS = poses.receivedNS;
+        frame.counter = poses.counter;
+        frame.count = uint16( min( poses.count, MAX_TRACKED_MARKERS ) );
+        frame.markersStat = int16( poses.markersStat );
+        memcpy( out, &frame, sizeof( frame ) );
+        uint8* pose( out + sizeof( frame ) );
+
+        for ( uint32 i( 0u ); i < frame.count; ++i )
+        {
+            float32 rotation[ 3u ][ 3u ];
+            for ( uint32 r( 0u ); r < 3u; ++r )
+            {
+                for ( uint32 c( 0u ); c < 3u; ++c )
+                {
+                    rotation[ r ][ c ] = poses.rotation[ r ][ c ][ i ];
+                }
+            }
+            if ( encoding == PoseStreamEncoding::Quantized )
+            {
+                QuantizedStreamedPose quantized{};
+                quantized.geometryId = poses.geometryId[ i ];
+                for ( uint32 r( 0u ); r < 3u; ++r )
+                {
+                    quantized.translationUM[ r ] = quantize( poses.translationMM[ r ][ i ], 1000.0f );
+                }
+                float32 q[ 4u ];
+                toQuaternion( rotation, q );
+                for ( uint32 k( 0u ); k < 4u; ++k )
+                {
+                    quantized.quaternion[ k ] = int16( quantize( q[ k ], QUATERNION_SCALE ) );
+                }
+                quantized.registrationErrorUM =
+                  uint16( min( max( quantize( poses.registrationErrorMM[ i ], 1000.0f ), 0 ), 65535 ) );
+                memcpy( pose, &quantized, sizeof( quantized ) );
+                pose += sizeof( quantized );
+            }
+            else
+            {
+                StreamedPose full{};
+                full.geometryId = poses.geometryId[ i ];
+                full.registrationErrorMM = poses.registrationErrorMM[ i ];
+                for ( uint32 r( 0u ); r < 3u; ++r )
+                {
+                    full.translationMM[ r ] = poses.translationMM[ r ][ i ];
+                }
+                memcpy( full.rotation, rotation, sizeof( rotation ) );
+                memcpy( pose, &full, sizeof( full ) );
+                pose += sizeof( full );
+            }
+        }
+        return uint32( pose - out );
+    }
+
+    /** Decodes a frame checked by PoseStreamClient::checkPacket(), returns
+     * the number of bytes read. */
+    uint32 decodeFrame( const uint8* data, uint32 encoding, PoseStore& poses, uint64& sn )
+    {
+        PoseStreamFrame frame;
+        memcpy( &frame, data, sizeof( frame ) );
+        sn = frame.serialNumber;
+        poses.timestampUS = frame.timestampUS;
+        poses.counter = frame.counter;
+        poses.markersStat = ftkQueryStatus( frame.markersStat );
+        poses.count = frame.count;
+        poses.receivedNS = frame.receivedNS;
+        const uint8* pose( data + sizeof( frame ) );
+
+        for ( uint32 i( 0u ); i < frame.count; ++i )
+        {
+            float32 rotation[ 3u ][ 3u ];
+            if ( encoding == uint32( PoseStreamEncoding::Quantized ) )
+            {
+                QuantizedStreamedPose quantized;
+                memcpy( &quantized, pose, sizeof( quantized ) );
+                pose += sizeof( quantized );
+                poses.geometryId[ i ] = quantized.geometryId;
+                poses.registrationErrorMM[ i ] = float32( quantized.registrationErrorUM ) * 1e-3f;
+                for ( uint32 r( 0u ); r < 3u; ++r )
+                {
+                    poses.translationMM[ r ][ i ] = float32( quantized.translationUM[ r ] ) * 1e-3f;
+                }
+                float32 q[ 4u ];
+                for ( uint32 k( 0u ); k < 4u; ++k )
+                {
+                    q[ k ] = float32( quantized.quaternion[ k ] ) / QUATERNION_SCALE;
+                }
+                toMatrix( q, rotation );
+            }
+            else
+            {
+                StreamedPose full;
+                memcpy( &full, pose, sizeof( full ) );
+                pose += sizeof( full );
+                poses.geometryId[ i ] = full.geometryId;
+                poses.registrationErrorMM[ i ] = full.registrationErrorMM;
+                for ( uint32 r( 0u ); r < 3u; ++r )
+                {
+                    poses.translationMM[ r ][ i ] = full.translationMM[ r ];
+                }
+                memcpy( rotation, full.rotation, sizeof( rotation ) );
+            }
+            for ( uint32 r( 0u ); r < 3u; ++r )
+            {
+                for ( uint32 c( 0u ); c < 3u; ++c )
+                {
+                    poses.rotation[ r ][ c ][ i ] = rotation[ r ][ c ];
+                }
+            }
+        }
+        return uint32( pose - data );
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+PoseStreamServer::PoseStreamServer()
+    : _Socket( NO_SOCKET )
+    , _ClientCount( 0u )
+    , _PacketUsed( 0u )
+    , _PacketFrames( 0u )
+    , _BatchStartNS( 0 )
+    , _Sequence( 0u )
+    , _Running( false )
+    , _SentFrames( 0u )
+    , _SentPackets( 0u )
+    , _SentBytes( 0u )
+    , _Dropped( 0u )
+{
+    fill( _Clients, _Clients + MAX_CLIENTS, NO_SOCKET );
+}
+
+PoseStreamServer::~PoseStreamServer()
+{
+    close();
+}
+
+bool PoseStreamServer::open( const Settings& settings )
+{
+    close();
+
+    sockaddr_in address{};
+    if ( !startSockets() || !resolve( settings.Host, settings.Port, address ) )
+    {
+        cerr << "Could not resolve stream address " << settings.Host << endl;
+        return false;
+    }
+
+    const bool tcp( settings.Protocol == PoseStreamProtocol::Tcp );
+    _Socket = createSocket( tcp ? SOCK_STREAM : SOCK_DGRAM );
+    if ( _Socket == NO_SOCKET )
+    {
+        cerr << "Could not create stream socket" << endl;
+        return false;
+    }
+    bool ready( false );
+    const sockaddr* endpoint( reinterpret_cast< const sockaddr* >( &address ) );
+    if ( tcp )
+    {
+        setOption( _Socket, SOL_SOCKET, SO_REUSEADDR, 1 );
+        ready = bind( native( _Socket ), endpoint, sizeof( address ) ) == 0 &&
+                listen( native( _Socket ), int( MAX_CLIENTS ) ) == 0;
+        // Clients are accepted by the background thread between two
+        // packets.
+        setBlocking( _Socket, false );
+    }
+    else
+    {
+        // Connected, the datagrams are sent with send() like on TCP.
+        ready = connect( native( _Socket ), endpoint, sizeof( address ) ) == 0;
+    }
+    if ( !ready )
+    {
+        cerr << "Could not open stream on " << settings.Host << ":" << settings.Port << endl;
+        closeSocket( _Socket );
+        return false;
+    }
+
+    _Settings = settings;
+    _Settings.BatchFrames = max( 1u, min( _Settings.BatchFrames, uint32( RING_CAPACITY ) ) );
+    _Settings.MaxPacketBytes = min( _Settings.MaxPacketBytes, uint32( POSE_STREAM_MAX_PACKET_SIZE ) );
+
+    // The largest frame always fits, alone if needed.
+    const uint32 largestFrame( sizeof( PoseStreamFrame ) + MAX_TRACKED_MARKERS * sizeof( StreamedPose ) );
+    _Packet.assign( max( _Settings.MaxPacketBytes, uint32( sizeof( PoseStreamPacket ) ) + largestFrame ), 0u );
+    _PacketUsed = 0u;
+    _PacketFrames = 0u;
+    _Sequence = 0u;
+    _SentFrames.store( 0u );
+    _SentPackets.store( 0u );
+    _SentBytes.store( 0u );
+    _Dropped.store( 0u );
+    _Ring.reset( new SpscRing< Slot, RING_CAPACITY >() );
+    _Running.store( true, memory_order_release );
+    _Thread = thread( &PoseStreamServer::run, this );
+    return true;
+}
+
+void PoseStreamServer::close()
+{
+    if ( !_Thread.joinable() )
+    {
+        return;
+    }
+    _Running.store( false, memory_order_release );
+    _Thread.join();
+    for ( uint32 c( 0u ); c < _ClientCount.load( memory_order_relaxed ); ++c )
+    {
+        closeSocket( _Clients[ c ] );
+    }
+    _ClientCount.store( 0u );
+    closeSocket( _Socket );
+}
+
+bool PoseStreamServer::isOpen() const
+{
+    return _Running.load( memory_order_relaxed );
+}
+
+bool PoseStreamServer::push( const PoseStore& poses, uint64 sn )
+{
+    if ( !_Running.load( memory_order_relaxed ) )
+    {
+        return false;
+    }
+    Slot* slot( _Ring->beginPush() );
+    if ( slot == nullptr )
+    {
+        _Dropped.fetch_add( 1u, memory_order_relaxed );
+        return false;
+    }
+    slot->serialNumber = sn;
+    slot->poses = poses;
+    _Ring->commitPush();
+    return true;
+}
+
+uint64 PoseStreamServer::sentFrames() const
+{
+    return _SentFrames.load( memory_order_relaxed );
+}
+
+uint64 PoseStreamServer::sentPackets() const
+{
+    return _SentPackets.load( memory_order_relaxed );
+}
+
+uint64 PoseStreamServer::sentBytes() const
+{
+    return _SentBytes.load( memory_order_relaxed );
+}
+
+uint64 PoseStreamServer::droppedFrames() const
+{
+    return _Dropped.load( memory_order_relaxed );
+}
+
+uint32 PoseStreamServer::clientCount() const
+{
+    return _ClientCount.load( memory_order_relaxed );
+}
+
+// ----------------------------------------------------------------------------
+
+void PoseStreamServer::run()
+{
+    const bool tcp( _Settings.Protocol == PoseStreamProtocol::Tcp );
+    const int64 maxDelayNS( int64( _Settings.MaxBatchDelayUS ) * 1000 );
+    for ( ;; )
+    {
+        if ( tcp )
+        {
+            accept();
+        }
+        const Slot* slot( _Ring->front() );
+        if ( slot == nullptr )
+        {
+            if ( _PacketFrames != 0u && latencyClockNS() - _BatchStartNS >= maxDelayNS )
+            {
+                flush();
+            }
+            if ( !_Running.load( memory_order_acquire ) && _Ring->empty() )
+            {
+                flush();
+                break;
+            }
+            this_thread::sleep_for( IDLE_PERIOD );
+            continue;
+        }
+        append( *slot );
+        _Ring->popFront();
+    }
+}
+
+void PoseStreamServer::accept()
+{
+    for ( ;; )
+    {
+        int64 client( int64( ::accept( native( _Socket ), nullptr, nullptr ) ) );
+#ifdef ATR_WIN
+        if ( native( client ) == INVALID_SOCKET )
+#else
+        if ( client < 0 )
+#endif
+        {
+            return;
+        }
+        const uint32 count( _ClientCount.load( memory_order_relaxed ) );
+        if ( count == MAX_CLIENTS )
+        {
+            closeSocket( client );
+            continue;
+        }
+        setBlocking( client, true );
+        setOption( client, IPPROTO_TCP, TCP_NODELAY, 1 );
+        setSendTimeout( client, SEND_TIMEOUT_MS );
+        _Clients[ count ] = client;
+        _ClientCount.store( count + 1u, memory_order_relaxed );
+    }
+}
+
+void PoseStreamServer::append( const Slot& slot )
+{
+    const uint32 count( min( slot.poses.count, MAX_TRACKED_MARKERS ) );
+    const uint32 size( sizeof( PoseStreamFrame ) + count * poseSize( uint32( _Settings.Encoding ) ) );
+    if ( _PacketFrames != 0u && _PacketUsed + size > _Settings.MaxPacketBytes )
+    {
+        flush();
+    }
+    if ( _PacketFrames == 0u )
+    {
+        _PacketUsed = sizeof( PoseStreamPacket );
+        _BatchStartNS = latencyClockNS();
+    }
+    _PacketUsed += encodeFrame( slot.poses, slot.serialNumber, _Settings.Encoding, _Packet.data() + _PacketUsed );
+    if ( ++_PacketFrames == _Settings.BatchFrames )
+    {
+        flush();
+    }
+}
+
+void PoseStreamServer::flush()
+{
+    if ( _PacketFrames == 0u )
+    {
+        return;
+    }
+
+    // Sequence numbers are consumed even when nobody receives the packet,
+    // receivers see it as lost.
+    PoseStreamPacket header{};
+    header.magic = POSE_STREAM_MAGIC;
+    header.version = uint16( POSE_STREAM_VERSION );
+    header.encoding = uint16( _Settings.Encoding );
+    header.sequence = _Sequence++;
+    header.frameCount = uint16( _PacketFrames );
+    header.size = uint16( _PacketUsed );
+    header.sentNS = latencyClockNS();
+    memcpy( _Packet.data(), &header, sizeof( header ) );
+
+    uint32 receivers( 0u );
+    if ( _Settings.Protocol == PoseStreamProtocol::Tcp )
+    {
+        uint32 count( _ClientCount.load( memory_order_relaxed ) );
+        for ( uint32 c( 0u ); c < count; )
+        {
+            if ( sendAll( _Clients[ c ], _Packet.data(), _PacketUsed ) )
+            {
+                ++receivers;
+                ++c;
+                continue;
+            }
+            // A partial packet cannot be recovered from, the client has to
+            // reconnect.
+            closeSocket( _Clients[ c ] );
+            _Clients[ c ] = _Clients[ --count ];
+            _Clients[ count ] = NO_SOCKET;
+            _ClientCount.store( count, memory_order_relaxed );
+        }
+    }
+    else if ( sendAll( _Socket, _Packet.data(), _PacketUsed ) )
+    {
+        receivers = 1u;
+    }
+    if ( receivers != 0u )
+    {
+        _SentPackets.fetch_add( 1u, memory_order_relaxed );
+        _SentFrames.fetch_add( _PacketFrames, memory_order_relaxed );
+        _SentBytes.fetch_add( uint64( receivers ) * _PacketUsed, memory_order_relaxed );
+    }
+    _PacketFrames = 0u;
+    _PacketUsed = 0u;
+}
+
+// ----------------------------------------------------------------------------
+
+PoseStreamClient::PoseStreamClient()
+    : _Socket( NO_SOCKET )
+    , _PacketSize( 0u )
+    , _Received( 0u )
+    , _Offset( 0u )
+    , _FramesLeft( 0u )
+    , _Started( false )
+    , _NextSequence( 0u )
+    , _ReceivedPackets( 0u )
+    , _ReceivedFrames( 0u )
+    , _Lost( 0u )
+    , _Late( 0u )
+    , _Invalid( 0u )
+{}
+
+PoseStreamClient::~PoseStreamClient()
+{
+    close();
+}
+
+bool PoseStreamClient::open( const Settings& settings )
+{
+    close();
+
+    sockaddr_in address{};
+    if ( !startSockets() || !resolve( settings.Host, settings.Port, address ) )
+    {
+        cerr << "Could not resolve stream address " << settings.Host << endl;
+        return false;
+    }
+
+    const bool tcp( settings.Protocol == PoseStreamProtocol::Tcp );
+    _Socket = createSocket( tcp ? SOCK_STREAM : SOCK_DGRAM );
+    if ( _Socket == NO_SOCKET )
+    {
+        cerr << "Could not create stream socket" << endl;
+        return false;
+    }
+    bool ready( false );
+    const sockaddr* endpoint( reinterpret_cast< const sockaddr* >( &address ) );
+    if ( tcp )
+    {
+        ready = connect( native( _Socket ), endpoint, sizeof( address ) ) == 0;
+        setOption( _Socket, IPPROTO_TCP, TCP_NODELAY, 1 );
+    }
+    else
+    {
+        setOption( _Socket, SOL_SOCKET, SO_RCVBUF, RECEIVE_BUFFER_SIZE );
+        ready = bind( native( _Socket ), endpoint, sizeof( address ) ) == 0;
+    }
+    if ( !ready )
+    {
+        cerr << "Could not open stream on " << settings.Host << ":" << settings.Port << endl;
+        closeSocket( _Socket );
+        return false;
+    }
+
+    _Settings = settings;
+    _Packet.assign( POSE_STREAM_MAX_PACKET_SIZE, 0u );
+    _PacketSize = 0u;
+    _Received = 0u;
+    _Offset = 0u;
+    _FramesLeft = 0u;
+    _Started = false;
+    _ReceivedPackets = 0u;
+    _ReceivedFrames = 0u;
+    _Lost = 0u;
+    _Late = 0u;
+    _Invalid = 0u;
+    return true;
+}
+
+void PoseStreamClient::close()
+{
+    closeSocket( _Socket );
+    _FramesLeft = 0u;
+}
+
+bool PoseStreamClient::isOpen() const
+{
+    return _Socket != NO_SOCKET;
+}
+
+bool PoseStreamClient::receive( PoseStore& poses, uint64& sn, uint32 timeoutMS )
+{
+    if ( _FramesLeft == 0u && !nextPacket( timeoutMS ) )
+    {
+        return false;
+    }
+    PoseStreamPacket header;
+    memcpy( &header, _Packet.data(), sizeof( header ) );
+    _Offset += decodeFrame( _Packet.data() + _Offset, header.encoding, poses, sn );
+    poses.publishedNS = header.sentNS;
+    --_FramesLeft;
+    ++_ReceivedFrames;
+    return true;
+}
+
+uint64 PoseStreamClient::receivedPackets() const
+{
+    return _ReceivedPackets;
+}
+
+uint64 PoseStreamClient::receivedFrames() const
+{
+    return _ReceivedFrames;
+}
+
+uint64 PoseStreamClient::lostPackets() const
+{
+    return _Lost;
+}
+
+uint64 PoseStreamClient::latePackets() const
+{
+    return _Late;
+}
+
+uint64 PoseStreamClient::invalidPackets() const
+{
+    return _Invalid;
+}
+
+// ----------------------------------------------------------------------------
+
+bool PoseStreamClient::wait( uint32 timeoutMS )
+{
+    fd_set readable;
+    FD_ZERO( &readable );
+    FD_SET( native( _Socket ), &readable );
+    timeval timeout;
+    timeout.tv_sec = long( timeoutMS / 1000u );
+    timeout.tv_usec = long( timeoutMS % 1000u ) * 1000L;
+    return select( int( _Socket + 1 ), &readable, nullptr, nullptr, &timeout ) > 0;
+}
+
+bool PoseStreamClient::nextPacket( uint32 timeoutMS )
+{
+    const int64 deadlineNS( latencyClockNS() + int64( timeoutMS ) * 1000000 );
+    while ( _Socket != NO_SOCKET )
+    {
+        const int64 leftNS( max( deadlineNS - latencyClockNS(), int64( 0 ) ) );
+        const uint32 leftMS( uint32( ( leftNS + 999999 ) / 1000000 ) );
+        if ( _Settings.Protocol == PoseStreamProtocol::Tcp )
+        {
+            if ( !readStream( leftMS ) )
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if ( !wait( leftMS ) )
+            {
+                return false;
+            }
+            const int size( int( recv( native( _Socket ), reinterpret_cast< char* >( _Packet.data() ),
+                                       int( _Packet.size() ), 0 ) ) );
+            if ( size < 0 )
+            {
+                // Errors reported for previous datagrams do not close the
+                // socket.
+                continue;
+            }
+            _PacketSize = uint32( size );
+        }
+        if ( !checkPacket() )
+        {
+            ++_Invalid;
+        }
+        else if ( acceptPacket() )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PoseStreamClient::readStream( uint32 timeoutMS )
+{
+    const int64 deadlineNS( latencyClockNS() + int64( timeoutMS ) * 1000000 );
+    for ( ;; )
+    {
+        // The header gives the size of the packet, bytes already received
+        // are kept across timeouts.
+        uint32 needed( sizeof( PoseStreamPacket ) );
+        if ( _Received >= needed )
+        {
+            PoseStreamPacket header;
+            memcpy( &header, _Packet.data(), sizeof( header ) );
+            if ( header.magic != POSE_STREAM_MAGIC || header.size < needed )
+            {
+                cerr << "Pose stream out of sync, disconnected" << endl;
+                ++_Invalid;
+                close();
+                return false;
+            }
+            needed = header.size;
+        }
+        if ( _Received == needed )
+        {
+            _PacketSize = needed;
+            _Received = 0u;
+            return true;
+        }
+
+        const int64 leftNS( max( deadlineNS - latencyClockNS(), int64( 0 ) ) );
+        if ( !wait( uint32( ( leftNS + 999999 ) / 1000000 ) ) )
+        {
+            return false;
+        }
+        const int size( int( recv( native( _Socket ), reinterpret_cast< char* >( _Packet.data() + _Received ),
+                                   int( needed - _Received ), 0 ) ) );
+        if ( size <= 0 )
+        {
+            close();
+            return false;
+        }
+        _Received += uint32( size );
+    }
+}
+
+bool PoseStreamClient::checkPacket()
+{
+    PoseStreamPacket header;
+    if ( _PacketSize < sizeof( header ) )
+    {
+        return false;
+    }
+    memcpy( &header, _Packet.data(), sizeof( header ) );
+    if ( header.magic != POSE_STREAM_MAGIC || header.version != POSE_STREAM_VERSION ||
+         header.size != _PacketSize || header.encoding > uint16( PoseStreamEncoding::Quantized ) ||
+         header.frameCount == 0u )
+    {
+        return false;
+    }
+
+    // Every frame must lie inside the packet before any is returned.
+    uint32 offset( sizeof( header ) );
+    for ( uint32 f( 0u ); f < header.frameCount; ++f )
+    {
+        PoseStreamFrame frame;
+        if ( offset + sizeof( frame ) > _PacketSize )
+        {
+            return false;
+        }
+        memcpy( &frame, _Packet.data() + offset, sizeof( frame ) );
+        offset += sizeof( frame ) + frame.count * poseSize( header.encoding );
+        if ( frame.count > MAX_TRACKED_MARKERS || offset > _PacketSize )
+        {
+            return false;
+        }
+    }
+    return offset == _PacketSize;
+}
+
+bool PoseStreamClient::acceptPacket()
+{
+    PoseStreamPacket header;
+    memcpy( &header, _Packet.data(), sizeof( header ) );
+
+    // A packet behind the expected sequence number was reordered by the
+    // network: it is dropped so that the frames keep the order they were
+    // sent in, and stays counted in the gap it left.
+    const uint32 gap( header.sequence - _NextSequence );
+    if ( _Started && gap >= 0x80000000u && _NextSequence - header.sequence <= SEQUENCE_RESTART )
+    {
+        ++_Late;
+        return false;
+    }
+    _Lost += _Started && gap < 0x80000000u ? gap : 0u;
+    _NextSequence = header.sequence + 1u;
+    _Started = true;
+    ++_ReceivedPackets;
+    _Offset = sizeof( header );
+    _FramesLeft = header.frameCount;
+    return true;
+}
@@ -0,0 +1,344 @@
+// =============================================================================
+
+/*!
+ *
+ *   \file poseStreamLoopback.cpp
+ *   \brief Loopback check of the pose stream, without camera nor network.
+ *
+ *   A PoseStreamServer and a PoseStreamClient talk through the local host:
+ *   - with UDP and TCP,
+ *   - with the float and the quantized encodings,
+ *   - with one frame per packet and with batches of frames.
+ *   Every frame must come back in order, with the poses of the sent one
+ *   within the precision of the encoding. Then hand-crafted datagrams with
+ *   a hole in their sequence numbers check that the client counts the lost
+ *   packets, and drops a late one.
+ *
+ *   How to run this check:
+ *   - Build the PoseStreamLoopback project
+ *   - Run the resulting executable, optionally with the first UDP / TCP port
+ *     to use, 5105 by default:
+ *     \code
+ *     PoseStreamLoopback.exe [port]
+ *     \endcode
+ *
+ *   One line is written per case, the process returns EXIT_FAILURE if any
+ *   of them failed.
+ *
+ */
+// =============================================================================
+
+// winsock2.h must come before any inclusion of windows.h, hence before the
+// SDK headers defining ATR_WIN.
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment( lib, "ws2_32.lib" )
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "poseStream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/** \brief Number of frames sent by each stream case.
+ */
+#define LOOPBACK_FRAMES 200u
+
+/** \brief Number of poses in each frame.
+ */
+#define LOOPBACK_POSES 3u
+
+/** \brief Serial number the frames are sent with.
+ */
+#define LOOPBACK_SERIAL_NUMBER 0x5354330000000001uLL
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+#ifdef ATR_WIN
+    typedef SOCKET NativeSocket;
+    const NativeSocket NO_SOCKET( INVALID_SOCKET );
+#else
+    typedef int NativeSocket;
+    const NativeSocket NO_SOCKET( -1 );
+#endif
+
+    /** Longest wait for a frame or a TCP connection, in milliseconds. */
+    const uint32 TIMEOUT_MS( 1000u );
+
+    /** Largest translation and rotation errors of the quantized encoding. */
+    const float32 QUANTIZED_TRANSLATION_MM( 0.001f );
+    const float32 QUANTIZED_ROTATION( 0.001f );
+
+    /** Deterministic poses of frame \c counter, a rotation about z per pose
+     * and a half turn about x for the last one. */
+    void makeFrame( uint32 counter, PoseStore& poses )
+    {
+        poses.clear();
+        poses.counter = counter;
+        poses.timestampUS = 1000u * uint64( counter );
+        poses.markersStat = ftkQueryStatus::QS_OK;
+        poses.count = LOOPBACK_POSES;
+        for ( uint32 i( 0u ); i < LOOPBACK_POSES; ++i )
+        {
+            poses.geometryId[ i ] = 100u + i;
+            poses.registrationErrorMM[ i ] = 0.125f;
+            const float32 angle( 0.01f * float32( counter ) + float32( i ) );
+            const float32 c( cos( angle ) ), s( sin( angle ) );
+            const float32 aboutZ[ 3u ][ 3u ] = { { c, -s, 0.0f }, { s, c, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+            const float32 halfTurn[ 3u ][ 3u ] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } };
+            for ( uint32 r( 0u ); r < 3u; ++r )
+            {
+                poses.translationMM[ r ][ i ] = -123.4567f * float32( r + 1u ) + float32( counter );
+                for ( uint32 k( 0u ); k < 3u; ++k )
+                {
+                    poses.rotation[ r ][ k ][ i ] = i + 1u == LOOPBACK_POSES ? halfTurn[ r ][ k ] : aboutZ[ r ][ k ];
+                }
+            }
+        }
+    }
+
+    const char* nameOf( PoseStreamProtocol protocol )
+    {
+        return protocol == PoseStreamProtocol::Tcp ? "tcp" : "udp";
+    }
+
+    const char* nameOf( PoseStreamEncoding encoding )
+    {
+        return encoding == PoseStreamEncoding::Quantized ? "quantized" : "float";
+    }
+
+    /** Streams LOOPBACK_FRAMES frames and compares what comes back. */
+    bool checkStream( PoseStreamProtocol protocol, PoseStreamEncoding encoding, uint32 batchFrames, uint16 port )
+    {
+        PoseStreamServer::Settings serverSettings;
+        serverSettings.Protocol = protocol;
+        serverSettings.Port = port;
+        serverSettings.Encoding = encoding;
+        serverSettings.BatchFrames = batchFrames;
+        serverSettings.MaxBatchDelayUS = 5000u;
+        PoseStreamClient::Settings clientSettings;
+        clientSettings.Protocol = protocol;
+        clientSettings.Port = port;
+
+        cout << nameOf( protocol ) << " " << nameOf( encoding ) << " batch " << batchFrames << ": ";
+
+        // UDP datagrams are only received once the client is bound, a TCP
+        // client needs a listening server.
+        PoseStreamServer server;
+        PoseStreamClient client;
+        bool opened( false );
+        if ( protocol == PoseStreamProtocol::Udp )
+        {
+            opened = client.open( clientSettings ) && server.open( serverSettings );
+        }
+        else if ( server.open( serverSettings ) && client.open( clientSettings ) )
+        {
+            const chrono::steady_clock::time_point deadline( chrono::steady_clock::now() +
+                                                             chrono::milliseconds( TIMEOUT_MS ) );
+            while ( server.clientCount() == 0u && chrono::steady_clock::now() < deadline )
+            {
+                this_thread::yield();
+            }
+            opened = server.clientCount() != 0u;
+        }
+        if ( !opened )
+        {
+            cout << "FAILED, cannot open the stream" << endl;
+            return false;
+        }
+
+        thread producer( [ &server ]() {
+            PoseStore poses;
+            for ( uint32 counter( 1u ); counter <= LOOPBACK_FRAMES; ++counter )
+            {
+                makeFrame( counter, poses );
+                while ( !server.push( poses, LOOPBACK_SERIAL_NUMBER ) )
+                {
+                    this_thread::yield();
+                }
+            }
+        } );
+
+        PoseStore received, expected;
+        uint64 sn( 0u );
+        uint32 frames( 0u ), lastCounter( 0u );
+        bool valid( true );
+        float32 translationError( 0.0f ), rotationError( 0.0f );
+        while ( frames < LOOPBACK_FRAMES && client.receive( received, sn, TIMEOUT_MS ) )
+        {
+            ++frames;
+            makeFrame( received.counter, expected );
+            valid = valid && received.counter > lastCounter && sn == LOOPBACK_SERIAL_NUMBER &&
+                    received.count == LOOPBACK_POSES && received.timestampUS == expected.timestampUS;
+            lastCounter = received.counter;
+            for ( uint32 i( 0u ); i < min( received.count, LOOPBACK_POSES ); ++i )
+            {
+                valid = valid && received.geometryId[ i ] == expected.geometryId[ i ];
+                for ( uint32 r( 0u ); r < 3u; ++r )
+                {
+                    translationError = max( translationError, fabs( received.translationMM[ r ][ i ] -
+                                                                    expected.translationMM[ r ][ i ] ) );
+                    for ( uint32 k( 0u ); k < 3u; ++k )
+                    {
+                        rotationError = max( rotationError, fabs( received.rotation[ r ][ k ][ i ] -
+                                                                  expected.rotation[ r ][ k ][ i ] ) );
+                    }
+                }
+            }
+        }
+        producer.join();
+        server.close();
+
+        const bool quantized( encoding == PoseStreamEncoding::Quantized );
+        const bool batched( batchFrames == 1u ? client.receivedPackets() == frames
+                                              : client.receivedPackets() < frames );
+        const bool success( valid && frames == LOOPBACK_FRAMES && batched && client.lostPackets() == 0u &&
+                            client.invalidPackets() == 0u &&
+                            translationError <= ( quantized ? QUANTIZED_TRANSLATION_MM : 0.0f ) &&
+                            rotationError <= ( quantized ? QUANTIZED_ROTATION : 0.0f ) );
+        cout << ( success ? "ok" : "FAILED" ) << ", " << frames << " frames in " << client.receivedPackets()
+             << " packets, " << server.sentBytes() << " bytes, max error " << translationError << " mm / "
+             << rotationError << endl;
+        return success;
+    }
+
+    /** Sends one datagram holding a frame without pose, as the server would
+     * have. */
+    bool sendPacket( NativeSocket sender, const sockaddr_in& address, uint32 sequence )
+    {
+        PoseStreamPacket header{};
+        header.magic = POSE_STREAM_MAGIC;
+        header.version = POSE_STREAM_VERSION;
+        header.encoding = uint16( PoseStreamEncoding::Float );
+        header.sequence = sequence;
+        header.frameCount = 1u;
+        header.size = uint16( sizeof( PoseStreamPacket ) + sizeof( PoseStreamFrame ) );
+        PoseStreamFrame frame{};
+        frame.serialNumber = LOOPBACK_SERIAL_NUMBER;
+        frame.counter = sequence;
+
+        uint8 packet[ sizeof( PoseStreamPacket ) + sizeof( PoseStreamFrame ) ];
+        memcpy( packet, &header, sizeof( header ) );
+        memcpy( packet + sizeof( header ), &frame, sizeof( frame ) );
+        return sendto( sender, reinterpret_cast< const char* >( packet ), int( sizeof( packet ) ), 0,
+                       reinterpret_cast< const sockaddr* >( &address ), sizeof( address ) ) == int( sizeof( packet ) );
+    }
+
+    /** Receives the pending frames, returns how many there were. */
+    uint32 drain( PoseStreamClient& client )
+    {
+        PoseStore poses;
+        uint64 sn( 0u );
+        uint32 frames( 0u );
+        while ( client.receive( poses, sn, 100u ) )
+        {
+            ++frames;
+        }
+        return frames;
+    }
+
+    /** Sends packets 0, 1, 2, 5 and 6 then the late packet 3 and packet 7. */
+    bool checkSequenceGap( uint16 port )
+    {
+        cout << "udp sequence gap: ";
+
+        PoseStreamClient::Settings clientSettings;
+        clientSettings.Port = port;
+        PoseStreamClient client;
+        if ( !client.open( clientSettings ) )
+        {
+            cout << "FAILED, cannot open the client" << endl;
+            return false;
+        }
+
+        const NativeSocket sender( socket( AF_INET, SOCK_DGRAM, 0 ) );
+        if ( sender == NO_SOCKET )
+        {
+            cout << "FAILED, cannot create the sender" << endl;
+            return false;
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons( port );
+        inet_pton( AF_INET, "127.0.0.1", &address.sin_addr );
+
+        bool sent( true );
+        for ( uint32 sequence : { 0u, 1u, 2u, 5u, 6u } )
+        {
+            sent = sendPacket( sender, address, sequence ) && sent;
+        }
+        const uint32 frames( drain( client ) );
+        const uint64 lost( client.lostPackets() );
+        sent = sendPacket( sender, address, 3u ) && sent;
+        sent = sendPacket( sender, address, 7u ) && sent;
+        const uint32 next( drain( client ) );
+#ifdef ATR_WIN
+        closesocket( sender );
+#else
+        close( sender );
+#endif
+
+        const bool success( sent && frames == 5u && lost == 2u && next == 1u && client.lostPackets() == 2u &&
+                            client.latePackets() == 1u && client.invalidPackets() == 0u );
+        cout << ( success ? "ok" : "FAILED" ) << ", " << frames << " frames then " << next << ", " << lost
+             << " lost then " << client.lostPackets() << ", " << client.latePackets() << " late" << endl;
+        return success;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// main function
+
+int main( int argc, char** argv )
+{
+    uint16 port( argc > 1 ? uint16( atoi( argv[ 1 ] ) ) : uint16( 5105u ) );
+
+#ifdef ATR_WIN
+    WSADATA data;
+    if ( WSAStartup( MAKEWORD( 2, 2 ), &data ) != 0 )
+    {
+        cerr << "Cannot start the sockets" << endl;
+        return EXIT_FAILURE;
+    }
+#endif
+
+    bool success( true );
+    for ( PoseStreamProtocol protocol : { PoseStreamProtocol::Udp, PoseStreamProtocol::Tcp } )
+    {
+        for ( PoseStreamEncoding encoding : { PoseStreamEncoding::Float, PoseStreamEncoding::Quantized } )
+        {
+            for ( uint32 batchFrames : { 1u, 8u } )
+            {
+                success = checkStream( protocol, encoding, batchFrames, port++ ) && success;
+            }
+        }
+    }
+    success = checkSequenceGap( port ) && success;
+
+#ifdef ATR_WIN
+    WSACleanup();
+#endif
+
+    cout << ( success ? "\tSUCCESS" : "\tFAILED" ) << endl;
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,145 @@
+#include "recordingReader.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+    /** Checks that a whole frame record, with its markers and fiducials,
+     * lies between \c offset and \c end. */
+    bool isValidFrame( const char* data, uint64 offset, uint64 end )
+    {
+        if ( offset < sizeof( RecordingHeader ) || offset > end || end - offset < sizeof( RecordedFrame ) )
+        {
+            return false;
+        }
+        const RecordedFrame* frame( reinterpret_cast< const RecordedFrame* >( data + offset ) );
+        const uint64 recordSize( sizeof( RecordedFrame ) + uint64( frame->markersCount ) * sizeof( RecordedMarker ) +
+                                 uint64( frame->fiducialsCount ) * sizeof( RecordedFiducial ) );
+        return frame->magic == RECORDED_FRAME_MAGIC && frame->recordSize == recordSize &&
+               recordSize <= end - offset;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+RecordingReader::RecordingReader()
+    : _Index( nullptr )
+    , _FrameCount( 0u )
+    , _Complete( false )
+{}
+
+bool RecordingReader::open( const string& path )
+{
+    close();
+
+    if ( !_File.open( path ) )
+    {
+        cerr << "Could not open recording '" << path << "'" << endl;
+        return false;
+    }
+
+    const uint64 size( _File.size() );
+    const RecordingHeader* head( header() );
+    if ( size < sizeof( RecordingHeader ) || head->magic != RECORDING_HEADER_MAGIC ||
+         head->version != RECORDING_VERSION || head->headerSize != sizeof( RecordingHeader ) ||
+         head->markerRecordSize != sizeof( RecordedMarker ) || head->fiducialRecordSize != sizeof( RecordedFiducial ) )
+    {
+        cerr << "'" << path << "' is not a valid recording" << endl;
+        close();
+        return false;
+    }
+
+    if ( size >= sizeof( RecordingHeader ) + sizeof( RecordingFooter ) )
+    {
+        const RecordingFooter* footer(
+          reinterpret_cast< const RecordingFooter* >( _File.data() + size - sizeof( RecordingFooter ) ) );
+        const uint64 indexEnd( size - sizeof( RecordingFooter ) );
+        if ( footer->magic == RECORDING_FOOTER_MAGIC && footer->indexOffset >= sizeof( RecordingHeader ) &&
+             footer->indexOffset <= indexEnd &&
+             ( indexEnd - footer->indexOffset ) % sizeof( RecordingIndexEntry ) == 0u &&
+             footer->frameCount == ( indexEnd - footer->indexOffset ) / sizeof( RecordingIndexEntry ) )
+        {
+            // Every entry is checked once here, so that frame(), markers()
+            // and fiducials() never read past the mapping.
+            const RecordingIndexEntry* index(
+              reinterpret_cast< const RecordingIndexEntry* >( _File.data() + footer->indexOffset ) );
+            uint64 valid( 0u );
+            while ( valid < footer->frameCount &&
+                    isValidFrame( _File.data(), index[ valid ].offset, footer->indexOffset ) )
+            {
+                ++valid;
+            }
+            if ( valid == footer->frameCount )
+            {
+                _Index = index;
+                _FrameCount = footer->frameCount;
+                _Complete = true;
+                return true;
+            }
+            cerr << "The index of '" << path << "' is corrupt, its frames are walked instead" << endl;
+        }
+    }
+
+    // No valid footer, the recording was interrupted: walk the complete
+    // frames.
+    uint64 offset( sizeof( RecordingHeader ) );
+    while ( isValidFrame( _File.data(), offset, size ) )
+    {
+        const RecordedFrame* current( reinterpret_cast< const RecordedFrame* >( _File.data() + offset ) );
+        RecordingIndexEntry entry{};
+        entry.offset = offset;
+        entry.timestampUS = current->timestampUS;
+        entry.counter = current->counter;
+        _RebuiltIndex.push_back( entry );
+        offset += current->recordSize;
+    }
+    _Index = _RebuiltIndex.data();
+    _FrameCount = _RebuiltIndex.size();
+    return true;
+}
+
+void RecordingReader::close()
+{
+    _File.close();
+    _Index = nullptr;
+    _FrameCount = 0u;
+    _Complete = false;
+    _RebuiltIndex.clear();
+}
+
+const RecordingHeader* RecordingReader::header() const
+{
+    return reinterpret_cast< const RecordingHeader* >( _File.data() );
+}
+
+bool RecordingReader::isComplete() const
+{
+    return _Complete;
+}
+
+uint64 RecordingReader::frameCount() const
+{
+    return _FrameCount;
+}
+
+const RecordingIndexEntry& RecordingReader::entry( uint64 index ) const
+{
+    return _Index[ index ];
+}
+
+const RecordedFrame* RecordingReader::frame( uint64 index ) const
+{
+    return reinterpret_cast< const RecordedFrame* >( _File.data() + _Index[ index ].offset );
+}
+
+const RecordedMarker* RecordingReader::markers( const RecordedFrame& frame ) const
+{
+    return reinterpret_cast< const RecordedMarker* >( &frame + 1 );
+}
+
+const RecordedFiducial* RecordingReader::fiducials( const RecordedFrame& frame ) const
+{
+    return reinterpret_cast< const RecordedFiducial* >( markers( frame ) + frame.markersCount );
+}
@@ -0,0 +1,178 @@
+#include "relativePoseEngine.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+int32 RelativePoses::find( uint32 tool, uint32 reference ) const
+{
+    for ( uint32 p( 0u ); p < count; ++p )
+    {
+        if ( toolId[ p ] == tool && referenceId[ p ] == reference )
+        {
+            return int32( p );
+        }
+    }
+    return -1;
+}
+
+// ----------------------------------------------------------------------------
+
+RelativePoseEngine::RelativePoseEngine()
+    : _PairCount( 0u )
+    , _ReferenceCount( 0u )
+{
+    clearPairs();
+}
+
+bool RelativePoseEngine::addPair( uint32 tool, uint32 reference )
+{
+    if ( tool == reference )
+    {
+        return false;
+    }
+    uint32 r( 0u );
+    while ( r < _ReferenceCount && _ReferenceId[ r ] != reference )
+    {
+        ++r;
+    }
+    if ( r < _ReferenceCount )
+    {
+        for ( uint32 p( _ReferenceBegin[ r ] ); p < _ReferenceBegin[ r + 1u ]; ++p )
+        {
+            if ( _ToolId[ p ] == tool )
+            {
+                return true;
+            }
+        }
+    }
+    if ( _PairCount == MAX_RELATIVE_POSES )
+    {
+        return false;
+    }
+    if ( r == _ReferenceCount )
+    {
+        _ReferenceId[ r ] = reference;
+        _ReferenceHint[ r ] = 0u;
+        _ReferenceBegin[ r + 1u ] = _PairCount;
+        ++_ReferenceCount;
+    }
+
+    // The new pair goes at the end of the group of its reference.
+    const uint32 position( _ReferenceBegin[ r + 1u ] );
+    copy_backward( _ToolId + position, _ToolId + _PairCount, _ToolId + _PairCount + 1u );
+    copy_backward( _ToolHint + position, _ToolHint + _PairCount, _ToolHint + _PairCount + 1u );
+    _ToolId[ position ] = tool;
+    _ToolHint[ position ] = 0u;
+    ++_PairCount;
+    for ( uint32 s( r + 1u ); s <= _ReferenceCount; ++s )
+    {
+        ++_ReferenceBegin[ s ];
+    }
+    return true;
+}
+
+void RelativePoseEngine::clearPairs()
+{
+    _PairCount = 0u;
+    _ReferenceCount = 0u;
+    _ReferenceBegin[ 0u ] = 0u;
+}
+
+uint32 RelativePoseEngine::pairCount() const
+{
+    return _PairCount;
+}
+
+int32 RelativePoseEngine::markerOf( const PoseStore& poses, uint32 geometryId, uint32& hint ) const
+{
+    // Markers usually come in the same order from frame to frame.
+    if ( hint < poses.count && poses.geometryId[ hint ] == geometryId )
+    {
+        return int32( hint );
+    }
+    const int32 marker( poses.find( geometryId ) );
+    if ( marker >= 0 )
+    {
+        hint = uint32( marker );
+    }
+    return marker;
+}
+
+void RelativePoseEngine::compute( const PoseStore& poses, RelativePoses& relative )
+{
+    relative.timestampUS = poses.timestampUS;
+    relative.counter = poses.counter;
+    relative.count = _PairCount;
+
+    // Gathers the camera poses of the tools in the pair order.
+    for ( uint32 p( 0u ); p < _PairCount; ++p )
+    {
+        const int32 marker( markerOf( poses, _ToolId[ p ], _ToolHint[ p ] ) );
+        relative.toolId[ p ] = _ToolId[ p ];
+        relative.valid[ p ] = marker >= 0 ? 1u : 0u;
+        const uint32 m( marker >= 0 ? uint32( marker ) : 0u );
+        const float32 scale( marker >= 0 ? 1.0f : 0.0f );
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            _ToolTranslation[ r ][ p ] = scale * poses.translationMM[ r ][ m ];
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                _ToolRotation[ r ][ c ][ p ] = scale * poses.rotation[ r ][ c ][ m ];
+            }
+        }
+    }
+
+    for ( uint32 g( 0u ); g < _ReferenceCount; ++g )
+    {
+        const uint32 begin( _ReferenceBegin[ g ] ), end( _ReferenceBegin[ g + 1u ] );
+        fill( relative.referenceId + begin, relative.referenceId + end, _ReferenceId[ g ] );
+        const int32 marker( markerOf( poses, _ReferenceId[ g ], _ReferenceHint[ g ] ) );
+        if ( marker < 0 )
+        {
+            fill( relative.valid + begin, relative.valid + end, uint8( 0u ) );
+            continue;
+        }
+
+        // Inverse of the reference pose: transposed rotation and rotated
+        // opposite translation, computed once for all its tools.
+        float32 q[ 3u ][ 3u ], u[ 3u ];
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                q[ r ][ c ] = poses.rotation[ c ][ r ][ marker ];
+            }
+        }
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            u[ r ] = -( q[ r ][ 0u ] * poses.translationMM[ 0u ][ marker ] +
+                        q[ r ][ 1u ] * poses.translationMM[ 1u ][ marker ] +
+                        q[ r ][ 2u ] * poses.translationMM[ 2u ][ marker ] );
+        }
+
+        // Rows of the inverse are broadcast against the tool columns: the
+        // loop over the pairs is straight multiply-adds on contiguous floats.
+        const float32 q00( q[ 0u ][ 0u ] ), q01( q[ 0u ][ 1u ] ), q02( q[ 0u ][ 2u ] );
+        const float32 q10( q[ 1u ][ 0u ] ), q11( q[ 1u ][ 1u ] ), q12( q[ 1u ][ 2u ] );
+        const float32 q20( q[ 2u ][ 0u ] ), q21( q[ 2u ][ 1u ] ), q22( q[ 2u ][ 2u ] );
+        for ( uint32 p( begin ); p < end; ++p )
+        {
+            const float32 x( _ToolTranslation[ 0u ][ p ] ), y( _ToolTranslation[ 1u ][ p ] ),
+              z( _ToolTranslation[ 2u ][ p ] );
+            relative.translationMM[ 0u ][ p ] = q00 * x + q01 * y + q02 * z + u[ 0u ];
+            relative.translationMM[ 1u ][ p ] = q10 * x + q11 * y + q12 * z + u[ 1u ];
+            relative.translationMM[ 2u ][ p ] = q20 * x + q21 * y + q22 * z + u[ 2u ];
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                const float32 m0( _ToolRotation[ 0u ][ c ][ p ] ), m1( _ToolRotation[ 1u ][ c ][ p ] ),
+                  m2( _ToolRotation[ 2u ][ c ][ p ] );
+                relative.rotation[ 0u ][ c ][ p ] = q00 * m0 + q01 * m1 + q02 * m2;
+                relative.rotation[ 1u ][ c ][ p ] = q10 * m0 + q11 * m1 + q12 * m2;
+                relative.rotation[ 2u ][ c ][ p ] = q20 * m0 + q21 * m1 + q22 * m2;
+            }
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include "reservationTuner.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+    // Tuned members of FrameOptions, in the order of the tuner arrays.
+    uint32 FrameOptions::* const RESERVATIONS[ TUNED_RESERVATIONS ] = {
+        &FrameOptions::EventsSize, &FrameOptions::LeftRawDataSize, &FrameOptions::RightRawDataSize,
+        &FrameOptions::ThreeDFiducialsSize, &FrameOptions::MarkersSize };
+
+    // Items of each query, 0 when it was not filled.
+    void demand( const ftkFrameQuery& frame, uint32 counts[ TUNED_RESERVATIONS ],
+                 bool overflows[ TUNED_RESERVATIONS ] )
+    {
+        const ftkQueryStatus status[ TUNED_RESERVATIONS ] = { frame.eventsStat, frame.rawDataLeftStat,
+                                                              frame.rawDataRightStat, frame.threeDFiducialsStat,
+                                                              frame.markersStat };
+        counts[ 0u ] = frame.eventsCount;
+        counts[ 1u ] = frame.rawDataLeftCount;
+        counts[ 2u ] = frame.rawDataRightCount;
+        counts[ 3u ] = frame.threeDFiducialsCount;
+        counts[ 4u ] = frame.markersCount;
+        for ( uint32 b( 0u ); b < TUNED_RESERVATIONS; ++b )
+        {
+            overflows[ b ] = status[ b ] == ftkQueryStatus::QS_ERR_OVERFLOW;
+            if ( status[ b ] != ftkQueryStatus::QS_OK && !overflows[ b ] )
+            {
+                counts[ b ] = 0u;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+ReservationTuner::ReservationTuner( const FrameOptions& initial, const Settings& settings )
+    : _Settings( settings )
+    , _Options( initial )
+    , _Grows( 0u )
+    , _Shrinks( 0u )
+{
+    const uint32 caps[ TUNED_RESERVATIONS ] = { _Settings.MaxEventsSize, _Settings.MaxRawDataSize,
+                                                _Settings.MaxRawDataSize, _Settings.MaxThreeDFiducialsSize,
+                                                _Settings.MaxMarkersSize };
+    for ( uint32 b( 0u ); b < TUNED_RESERVATIONS; ++b )
+    {
+        const uint32 reserved( _Options.*RESERVATIONS[ b ] );
+        _Floor[ b ] = min( reserved, _Settings.MinSize );
+        _Cap[ b ] = max( reserved, caps[ b ] );
+        _Quiet[ b ] = 0u;
+        _Peak[ b ] = 0u;
+    }
+}
+
+bool ReservationTuner::observe( const ftkFrameQuery& frame )
+{
+    uint32 counts[ TUNED_RESERVATIONS ];
+    bool overflows[ TUNED_RESERVATIONS ];
+    demand( frame, counts, overflows );
+
+    bool changed( false );
+    for ( uint32 b( 0u ); b < TUNED_RESERVATIONS; ++b )
+    {
+        uint32& reserved( _Options.*RESERVATIONS[ b ] );
+        if ( reserved == 0u )
+        {
+            continue;
+        }
+
+        const uint32 count( counts[ b ] );
+        if ( overflows[ b ] || float32( count ) > _Settings.GrowThreshold * float32( reserved ) )
+        {
+            // An overflow hides the real demand, the reservation is at least
+            // doubled.
+            uint32 size( min( 2u * reserved, _Cap[ b ] ) );
+            while ( size < _Cap[ b ] && float32( count ) > _Settings.GrowThreshold * float32( size ) )
+            {
+                size = min( 2u * size, _Cap[ b ] );
+            }
+            _Quiet[ b ] = 0u;
+            _Peak[ b ] = 0u;
+            if ( size != reserved )
+            {
+                reserved = size;
+                ++_Grows;
+                changed = true;
+            }
+        }
+        else if ( float32( count ) < _Settings.ShrinkThreshold * float32( reserved ) )
+        {
+            _Peak[ b ] = max( _Peak[ b ], count );
+            if ( ++_Quiet[ b ] < _Settings.QuietFrames )
+            {
+                continue;
+            }
+            uint32 size( reserved );
+            while ( size / 2u >= _Floor[ b ] && float32( _Peak[ b ] ) < _Settings.ShrinkThreshold * float32( size ) )
+            {
+                size /= 2u;
+            }
+            _Quiet[ b ] = 0u;
+            _Peak[ b ] = 0u;
+            if ( size != reserved )
+            {
+                reserved = size;
+                ++_Shrinks;
+                changed = true;
+            }
+        }
+        else
+        {
+            _Quiet[ b ] = 0u;
+            _Peak[ b ] = 0u;
+        }
+    }
+    return changed;
+}
+
+const FrameOptions& ReservationTuner::options() const
+{
+    return _Options;
+}
+
+uint64 ReservationTuner::grows() const
+{
+    return _Grows;
+}
+
+uint64 ReservationTuner::shrinks() const
+{
+    return _Shrinks;
+}
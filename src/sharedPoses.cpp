@@ -0,0 +1,306 @@
+#include "sharedPoses.hpp"
+
+#include "latencyHistogram.hpp"
+#include "seqlock.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <new>
+
+#ifdef ATR_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+namespace
+{
+    /** Magic value of an initialised segment, "STKSHM" followed by 0x00
+     * 0x01. */
+    const uint64 SEGMENT_MAGIC( 0x01004d48534b5453uLL );
+
+    /** Reads given up when the publisher seems stuck in a write, e.g. after
+     * it crashed. */
+    const uint32 READ_ATTEMPTS( 100000u );
+
+    /** Layout of the shared memory. */
+    struct SharedSegment
+    {
+        /** Written last by the publisher, readers wait for it. */
+        atomic< uint64 > Magic;
+        uint32 Version;
+        uint32 SegmentSize;
+        Seqlock< SharedPoseFrame > Frame;
+    };
+
+#ifdef ATR_WIN
+    string segmentName( const string& name )
+    {
+        return name;
+    }
+#else
+    string segmentName( const string& name )
+    {
+        return "/" + name;
+    }
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+const SharedPose* SharedPoseFrame::find( uint32 id ) const
+{
+    for ( uint32 i( 0u ); i < count; ++i )
+    {
+        if ( poses[ i ].geometryId == id )
+        {
+            return &poses[ i ];
+        }
+    }
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+
+SharedPosePublisher::SharedPosePublisher()
+    : _Handle( nullptr )
+    , _Segment( nullptr )
+    , _Published( 0u )
+    , _Frame{}
+{}
+
+SharedPosePublisher::~SharedPosePublisher()
+{
+    close();
+}
+
+bool SharedPosePublisher::open( const string& name )
+{
+    close();
+
+    const string path( segmentName( name ) );
+    const uint32 size( sizeof( SharedSegment ) );
+#ifdef ATR_WIN
+    HANDLE mapping( CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0u, size, path.c_str() ) );
+    if ( mapping == nullptr )
+    {
+        cerr << "Could not create shared memory '" << name << "'" << endl;
+        return false;
+    }
+    void* segment( MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0u, 0u, size ) );
+    if ( segment == nullptr )
+    {
+        cerr << "Could not map shared memory '" << name << "'" << endl;
+        CloseHandle( mapping );
+        return false;
+    }
+    _Handle = mapping;
+#else
+    // A segment left by a crashed publisher is replaced.
+    shm_unlink( path.c_str() );
+    const int descriptor( shm_open( path.c_str(), O_CREAT | O_RDWR, 0644 ) );
+    if ( descriptor < 0 )
+    {
+        cerr << "Could not create shared memory '" << name << "'" << endl;
+        return false;
+    }
+    void* segment( nullptr );
+    if ( ftruncate( descriptor, off_t( size ) ) == 0 )
+    {
+        segment = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0 );
+    }
+    ::close( descriptor );
+    if ( segment == nullptr || segment == MAP_FAILED )
+    {
+        cerr << "Could not map shared memory '" << name << "'" << endl;
+        shm_unlink( path.c_str() );
+        return false;
+    }
+#endif
+
+    SharedSegment* shared( new ( segment ) SharedSegment() );
+    shared->Version = SHARED_POSES_VERSION;
+    shared->SegmentSize = size;
+    shared->Magic.store( SEGMENT_MAGIC, memory_order_release );
+    _Segment = segment;
+    _Name = name;
+    _Published = 0u;
+    return true;
+}
+
+void SharedPosePublisher::close()
+{
+    if ( _Segment == nullptr )
+    {
+        return;
+    }
+    SharedSegment* shared( static_cast< SharedSegment* >( _Segment ) );
+    shared->Magic.store( 0u, memory_order_release );
+#ifdef ATR_WIN
+    UnmapViewOfFile( _Segment );
+    CloseHandle( _Handle );
+#else
+    munmap( _Segment, sizeof( SharedSegment ) );
+    shm_unlink( segmentName( _Name ).c_str() );
+#endif
+    _Segment = nullptr;
+    _Handle = nullptr;
+}
+
+bool SharedPosePublisher::isOpen() const
+{
+    return _Segment != nullptr;
+}
+
+void SharedPosePublisher::publish( const PoseStore& poses, uint64 sn )
+{
+    if ( _Segment == nullptr )
+    {
+        return;
+    }
+
+    _Frame.serialNumber = sn;
+    _Frame.timestampUS = poses.timestampUS;
+    _Frame.receivedNS = poses.receivedNS;
+    _Frame.counter = poses.counter;
+    _Frame.markersStat = int32( poses.markersStat );
+    _Frame.count = min( poses.count, MAX_TRACKED_MARKERS );
+    for ( uint32 i( 0u ); i < _Frame.count; ++i )
+    {
+        SharedPose& pose( _Frame.poses[ i ] );
+        pose.geometryId = poses.geometryId[ i ];
+        pose.registrationErrorMM = poses.registrationErrorMM[ i ];
+        for ( uint32 r( 0u ); r < 3u; ++r )
+        {
+            pose.translationMM[ r ] = poses.translationMM[ r ][ i ];
+            for ( uint32 c( 0u ); c < 3u; ++c )
+            {
+                pose.rotation[ r ][ c ] = poses.rotation[ r ][ c ][ i ];
+            }
+        }
+    }
+    _Frame.publishedNS = latencyClockNS();
+    static_cast< SharedSegment* >( _Segment )->Frame.store( _Frame );
+    ++_Published;
+}
+
+uint64 SharedPosePublisher::publishedFrames() const
+{
+    return _Published;
+}
+
+// ----------------------------------------------------------------------------
+
+SharedPoseReader::SharedPoseReader()
+    : _Handle( nullptr )
+    , _Segment( nullptr )
+{}
+
+SharedPoseReader::~SharedPoseReader()
+{
+    close();
+}
+
+bool SharedPoseReader::open( const string& name )
+{
+    close();
+
+    const string path( segmentName( name ) );
+    const uint32 size( sizeof( SharedSegment ) );
+#ifdef ATR_WIN
+    HANDLE mapping( OpenFileMappingA( FILE_MAP_READ, FALSE, path.c_str() ) );
+    if ( mapping == nullptr )
+    {
+        return false;
+    }
+    const void* segment( MapViewOfFile( mapping, FILE_MAP_READ, 0u, 0u, size ) );
+    if ( segment == nullptr )
+    {
+        CloseHandle( mapping );
+        return false;
+    }
+    _Handle = mapping;
+#else
+    const int descriptor( shm_open( path.c_str(), O_RDONLY, 0 ) );
+    if ( descriptor < 0 )
+    {
+        return false;
+    }
+    struct stat status;
+    const void* segment( nullptr );
+    if ( fstat( descriptor, &status ) == 0 && uint64( status.st_size ) >= size )
+    {
+        segment = mmap( nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0 );
+    }
+    ::close( descriptor );
+    if ( segment == nullptr || segment == MAP_FAILED )
+    {
+        return false;
+    }
+#endif
+    _Segment = segment;
+
+    // The publisher may still be initialising the segment.
+    const SharedSegment* shared( static_cast< const SharedSegment* >( _Segment ) );
+    if ( shared->Magic.load( memory_order_acquire ) != SEGMENT_MAGIC || shared->Version != SHARED_POSES_VERSION ||
+         shared->SegmentSize != size )
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SharedPoseReader::close()
+{
+    if ( _Segment == nullptr )
+    {
+        return;
+    }
+#ifdef ATR_WIN
+    UnmapViewOfFile( _Segment );
+    CloseHandle( _Handle );
+#else
+    munmap( const_cast< void* >( _Segment ), sizeof( SharedSegment ) );
+#endif
+    _Segment = nullptr;
+    _Handle = nullptr;
+}
+
+bool SharedPoseReader::isOpen() const
+{
+    return _Segment != nullptr;
+}
+
+uint32 SharedPoseReader::version() const
+{
+    return _Segment != nullptr ? static_cast< const SharedSegment* >( _Segment )->Frame.version() : 0u;
+}
+
+bool SharedPoseReader::read( SharedPoseFrame& frame ) const
+{
+    if ( version() == 0u )
+    {
+        return false;
+    }
+    const Seqlock< SharedPoseFrame >& shared( static_cast< const SharedSegment* >( _Segment )->Frame );
+    for ( uint32 attempt( 0u ); attempt < READ_ATTEMPTS; ++attempt )
+    {
+        if ( shared.tryLoad( frame ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
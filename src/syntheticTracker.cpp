@@ -0,0 +1,1138 @@
+#include "syntheticTracker.hpp"
+
+#include <ftkInterface.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+// Simulation state
+
+namespace
+{
+    const float64 PI( 3.14159265358979323846 );
+
+    const uint64 FIRST_SERIAL_NUMBER( 0x5354330000000001uLL );
+
+    const uint16 IMAGE_WIDTH( 1280u );
+    const uint16 IMAGE_HEIGHT( 800u );
+
+    enum SyntheticOptionId : uint32
+    {
+        OPT_DATA_DIR = 1u,
+        OPT_FRAME_RATE = 1000u,
+        OPT_BODY_COUNT = 1001u,
+        OPT_TRAJECTORY = 1002u,
+        OPT_NOISE_MM = 1003u,
+        OPT_NOISE_DEG = 1004u,
+        OPT_DROPOUT = 1005u,
+        OPT_LOST_FRAMES = 1010u
+    };
+
+    struct OptionDefinition
+    {
+        uint32 id;
+        ftkComponent component;
+        ftkOptionType type;
+        bool write;
+        float64 minimum;
+        float64 maximum;
+        float64 def;
+        const char* name;
+        const char* description;
+        const char* unit;
+    };
+
+    // IDs 10, 11, 30 and 68 are set by the samples on real devices, they are
+    // accepted and stored so that the samples run unchanged.
+    const OptionDefinition OPTIONS[] = {
+        { OPT_DATA_DIR, ftkComponent::FTK_LIBRARY, ftkOptionType::FTK_DATA, false, 0.0, 0.0, 0.0,
+          "Data Directory", "Directory where the geometry files are looked for", nullptr },
+        { 10u, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, true, 0.0, 100000.0, 0.0,
+          "Device option 10", "Stored without effect on the simulation", nullptr },
+        { 11u, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, true, 0.0, 100000.0, 0.0,
+          "Device option 11", "Stored without effect on the simulation", nullptr },
+        { 30u, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, true, 0.0, 100.0, 0.0,
+          "Device option 30", "Stored without effect on the simulation", nullptr },
+        { 68u, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, true, 0.0, 1.0, 0.0,
+          "Device option 68", "Stored without effect on the simulation", nullptr },
+        { OPT_FRAME_RATE, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, true, 0.0, 20000.0, 300.0,
+          "Synthetic frame rate", "Frame rate, 0 for a new frame at each request", "Hz" },
+        { OPT_BODY_COUNT, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, true, 0.0, 1024.0, 4.0,
+          "Synthetic body count", "Number of simulated rigid bodies", nullptr },
+        { OPT_TRAJECTORY, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, true, 0.0, 3.0, 1.0,
+          "Synthetic trajectory", "0: static, 1: circle, 2: Lissajous, 3: linear", nullptr },
+        { OPT_NOISE_MM, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_FLOAT32, true, 0.0, 10.0, 0.05,
+          "Synthetic translation noise", "Standard deviation of the translation noise", "mm" },
+        { OPT_NOISE_DEG, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_FLOAT32, true, 0.0, 10.0, 0.02,
+          "Synthetic rotation noise", "Standard deviation of the rotation noise", "deg" },
+        { OPT_DROPOUT, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_FLOAT32, true, 0.0, 1.0, 0.0,
+          "Synthetic dropout probability", "Probability for a body to be missing in a frame", nullptr },
+        { OPT_LOST_FRAMES, ftkComponent::FTK_DEVICE, ftkOptionType::FTK_INT32, false, 0.0, 2147483647.0, 0.0,
+          "Lost frames counter", "Number of frames produced but never retrieved", nullptr },
+    };
+
+    const OptionDefinition* findOption( uint32 id )
+    {
+        for ( const OptionDefinition& option : OPTIONS )
+        {
+            if ( option.id == id )
+            {
+                return &option;
+            }
+        }
+        return nullptr;
+    }
+
+    SyntheticTrackerConfig& pendingConfig()
+    {
+        static SyntheticTrackerConfig config;
+        return config;
+    }
+
+    struct SyntheticDevice
+    {
+        uint64 serialNumber;
+        mutex lock;
+        chrono::steady_clock::time_point start;
+        bool started;
+        uint64 lastIndex;
+        atomic< uint64 > lostFrames;
+        uint64 cachedVersion;
+        SyntheticTrackerConfig config;
+        vector< ftkRigidBody > bodies;
+    };
+
+    struct SyntheticFrame
+    {
+        ftkImageHeader header;
+        vector< ftkMarker > markers;
+        vector< ftk3DFiducial > fiducials;
+        vector< ftkRawData > rawLeft;
+        vector< ftkRawData > rawRight;
+        vector< ftkEvent* > events;
+        vector< uint8 > left;
+        vector< uint8 > right;
+    };
+
+    mutex framesLock;
+    map< ftkFrameQuery*, SyntheticFrame* > frames;
+
+    // ------------------------------------------------------------------------
+    // Reproducible noise: every value is a hash of its coordinates.
+
+    uint64 mix( uint64 value )
+    {
+        value += 0x9e3779b97f4a7c15uLL;
+        value = ( value ^ ( value >> 30u ) ) * 0xbf58476d1ce4e5b9uLL;
+        value = ( value ^ ( value >> 27u ) ) * 0x94d049bb133111ebuLL;
+        return value ^ ( value >> 31u );
+    }
+
+    float64 uniform( uint64 key )
+    {
+        return ( float64( mix( key ) >> 11u ) + 0.5 ) / 9007199254740992.0;
+    }
+
+    float64 gaussian( uint64 key )
+    {
+        const float64 u1( uniform( key ) ), u2( uniform( key ^ 0x5bd1e995uLL ) );
+        return sqrt( -2.0 * log( u1 ) ) * cos( 2.0 * PI * u2 );
+    }
+
+    uint64 noiseKey( uint32 seed, uint64 sn, uint64 index, uint32 body, uint32 what )
+    {
+        return mix( mix( mix( uint64( seed ) ^ sn ) ^ index ) ^ ( uint64( body ) << 8u | what ) );
+    }
+
+    // ------------------------------------------------------------------------
+
+    void rotationFromAngles( float64 yaw, float64 pitch, float64 roll, float64 r[ 3u ][ 3u ] )
+    {
+        const float64 cy( cos( yaw ) ), sy( sin( yaw ) );
+        const float64 cp( cos( pitch ) ), sp( sin( pitch ) );
+        const float64 cr( cos( roll ) ), sr( sin( roll ) );
+        r[ 0u ][ 0u ] = cy * cp;
+        r[ 0u ][ 1u ] = cy * sp * sr - sy * cr;
+        r[ 0u ][ 2u ] = cy * sp * cr + sy * sr;
+        r[ 1u ][ 0u ] = sy * cp;
+        r[ 1u ][ 1u ] = sy * sp * sr + cy * cr;
+        r[ 1u ][ 2u ] = sy * sp * cr - cy * sr;
+        r[ 2u ][ 0u ] = -sp;
+        r[ 2u ][ 1u ] = cp * sr;
+        r[ 2u ][ 2u ] = cp * cr;
+    }
+
+    void trajectory( const SyntheticTrackerConfig& config, uint32 body, float64 seconds, float64 t[ 3u ],
+                     float64 r[ 3u ][ 3u ] )
+    {
+        const float64 phase( 2.0 * PI * float64( body ) / 7.0 );
+        const float64 omega( 2.0 * PI * config.FrequencyHz * ( 1.0 + 0.1 * float64( body % 5u ) ) );
+        const float64 angle( omega * seconds + phase );
+        const float64 amplitude( config.AmplitudeMM );
+
+        t[ 0u ] = ( float64( body ) - 0.5 * float64( config.BodyCount - 1u ) ) * 120.0;
+        t[ 1u ] = 0.0;
+        t[ 2u ] = 1200.0;
+        switch ( config.Trajectory )
+        {
+        case SyntheticTrajectory::Circle:
+            t[ 0u ] += amplitude * cos( angle );
+            t[ 1u ] += amplitude * sin( angle );
+            break;
+        case SyntheticTrajectory::Lissajous:
+            t[ 0u ] += amplitude * sin( angle );
+            t[ 1u ] += amplitude * sin( 2.0 * angle + 0.25 * PI );
+            t[ 2u ] += 0.5 * amplitude * sin( 3.0 * angle );
+            break;
+        case SyntheticTrajectory::Linear:
+        {
+            const float64 cycle( angle / ( 2.0 * PI ) );
+            t[ 0u ] += amplitude * ( 4.0 * fabs( cycle - floor( cycle + 0.5 ) ) - 1.0 );
+            break;
+        }
+        default:
+            break;
+        }
+
+        if ( config.Trajectory == SyntheticTrajectory::Static )
+        {
+            rotationFromAngles( phase, 0.0, 0.0, r );
+        }
+        else
+        {
+            rotationFromAngles( 0.5 * angle, 0.3 * sin( angle ), 0.2 * cos( 0.5 * angle ), r );
+        }
+    }
+
+    void waitUntil( chrono::steady_clock::time_point when )
+    {
+        // Sleeping is too coarse on some platforms for kHz rates, the last
+        // millisecond is spent yielding.
+        for ( chrono::steady_clock::time_point now( chrono::steady_clock::now() ); now < when;
+              now = chrono::steady_clock::now() )
+        {
+            if ( when - now > chrono::milliseconds( 2 ) )
+            {
+                this_thread::sleep_for( when - now - chrono::milliseconds( 1 ) );
+            }
+            else
+            {
+                this_thread::yield();
+            }
+        }
+    }
+
+    void drawFiducial( uint8* image, float64 x, float64 y )
+    {
+        const int32 cx( static_cast< int32 >( x ) ), cy( static_cast< int32 >( y ) );
+        for ( int32 v( max( cy - 2, 0 ) ); v <= min( cy + 2, int32( IMAGE_HEIGHT ) - 1 ); ++v )
+        {
+            for ( int32 u( max( cx - 2, 0 ) ); u <= min( cx + 2, int32( IMAGE_WIDTH ) - 1 ); ++u )
+            {
+                image[ size_t( v ) * IMAGE_WIDTH + size_t( u ) ] = 255u;
+            }
+        }
+    }
+}
+
+struct ftkLibraryImp
+{
+    mutex lock;
+    SyntheticTrackerConfig config;
+    uint64 version;
+    vector< ftkRigidBody > bodies;
+    map< pair< uint64, uint32 >, float64 > values;
+    string dataDirectory;
+    int32 lastError;
+    string lastMessage;
+    vector< SyntheticDevice* > devices;
+};
+
+namespace
+{
+    ftkError fail( ftkLibrary lib, ftkError err, const string& message )
+    {
+        lock_guard< mutex > guard( lib->lock );
+        lib->lastError = int32( err );
+        lib->lastMessage = message;
+        return err;
+    }
+
+    SyntheticDevice* findDevice( ftkLibrary lib, uint64 sn )
+    {
+        for ( SyntheticDevice* device : lib->devices )
+        {
+            if ( device->serialNumber == sn )
+            {
+                return device;
+            }
+        }
+        return nullptr;
+    }
+
+    void applyOption( SyntheticDevice& device, uint32 id, float64 value )
+    {
+        switch ( id )
+        {
+        case OPT_FRAME_RATE:
+            device.config.FrameRateHz = uint32( value );
+            break;
+        case OPT_BODY_COUNT:
+            device.config.BodyCount = uint32( value );
+            break;
+        case OPT_TRAJECTORY:
+            device.config.Trajectory = SyntheticTrajectory( uint32( value ) );
+            break;
+        case OPT_NOISE_MM:
+            device.config.NoiseMM = float32( value );
+            break;
+        case OPT_NOISE_DEG:
+            device.config.NoiseDeg = float32( value );
+            break;
+        case OPT_DROPOUT:
+            device.config.DropoutProbability = float32( value );
+            break;
+        default:
+            break;
+        }
+    }
+
+    float64 currentValue( ftkLibraryImp& lib, uint64 sn, const OptionDefinition& option )
+    {
+        const SyntheticDevice* device( option.component == ftkComponent::FTK_DEVICE ? findDevice( &lib, sn )
+                                                                                     : nullptr );
+        if ( device != nullptr )
+        {
+            switch ( option.id )
+            {
+            case OPT_FRAME_RATE:
+                return device->config.FrameRateHz;
+            case OPT_BODY_COUNT:
+                return device->config.BodyCount;
+            case OPT_TRAJECTORY:
+                return float64( uint32( device->config.Trajectory ) );
+            case OPT_NOISE_MM:
+                return device->config.NoiseMM;
+            case OPT_NOISE_DEG:
+                return device->config.NoiseDeg;
+            case OPT_DROPOUT:
+                return device->config.DropoutProbability;
+            case OPT_LOST_FRAMES:
+                return float64( min( device->lostFrames.load(), uint64( 2147483647u ) ) );
+            default:
+                break;
+            }
+        }
+        map< pair< uint64, uint32 >, float64 >::const_iterator it( lib.values.find( make_pair( sn, option.id ) ) );
+        return it != lib.values.end() ? it->second : option.def;
+    }
+
+    ftkError getOption( ftkLibrary lib, uint64 sn, uint32 optID, ftkOptionGetter what, ftkOptionType type,
+                        float64& out )
+    {
+        if ( lib == nullptr )
+        {
+            return ftkError::FTK_ERR_INV_PTR;
+        }
+        const OptionDefinition* option( findOption( optID ) );
+        if ( option == nullptr || option->type != type )
+        {
+            return fail( lib, ftkError::FTK_ERR_INV_OPT, "Unknown option" );
+        }
+        if ( option->component != ftkComponent::FTK_LIBRARY && findDevice( lib, sn ) == nullptr )
+        {
+            return fail( lib, ftkError::FTK_ERR_INV_SN, "Unknown serial number" );
+        }
+        lock_guard< mutex > guard( lib->lock );
+        switch ( what )
+        {
+        case ftkOptionGetter::FTK_MIN_VAL:
+            out = option->minimum;
+            break;
+        case ftkOptionGetter::FTK_MAX_VAL:
+            out = option->maximum;
+            break;
+        case ftkOptionGetter::FTK_DEF_VAL:
+            out = option->def;
+            break;
+        default:
+            out = currentValue( *lib, sn, *option );
+            break;
+        }
+        return ftkError::FTK_OK;
+    }
+
+    ftkError setOption( ftkLibrary lib, uint64 sn, uint32 optID, ftkOptionType type, float64 value )
+    {
+        if ( lib == nullptr )
+        {
+            return ftkError::FTK_ERR_INV_PTR;
+        }
+        const OptionDefinition* option( findOption( optID ) );
+        if ( option == nullptr || option->type != type || !option->write )
+        {
+            return fail( lib, ftkError::FTK_ERR_INV_OPT, "Unknown or read-only option" );
+        }
+        if ( value < option->minimum || value > option->maximum )
+        {
+            return fail( lib, ftkError::FTK_ERR_INV_OPT_PAR, "Option value out of range" );
+        }
+        SyntheticDevice* device( findDevice( lib, sn ) );
+        if ( device == nullptr )
+        {
+            return fail( lib, ftkError::FTK_ERR_INV_SN, "Unknown serial number" );
+        }
+        // Both locks are held, ftkGetLastFrame reads the configuration under
+        // the device one and getOption under the library one.
+        lock_guard< mutex > deviceGuard( device->lock );
+        lock_guard< mutex > guard( lib->lock );
+        lib->values[ make_pair( sn, optID ) ] = value;
+        applyOption( *device, optID, value );
+        return ftkError::FTK_OK;
+    }
+
+    void fillFrame( const SyntheticDevice& device, uint64 index, float64 seconds, ftkFrameQuery* frame )
+    {
+        const SyntheticTrackerConfig& config( device.config );
+        const uint32 markersCapacity( frame->markersVersionSize.ReservedSize / sizeof( ftkMarker ) );
+        const uint32 fiducialsCapacity( frame->threeDFiducialsVersionSize.ReservedSize / sizeof( ftk3DFiducial ) );
+        const bool pixels( frame->imageLeftPixels != nullptr && frame->imageRightPixels != nullptr );
+        const float64 noiseRad( config.NoiseDeg * PI / 180.0 );
+        uint32 markersCount( 0u ), fiducialsCount( 0u );
+        bool markersOverflow( false ), fiducialsOverflow( false );
+
+        if ( pixels )
+        {
+            memset( frame->imageLeftPixels, 0, size_t( IMAGE_WIDTH ) * IMAGE_HEIGHT );
+            memset( frame->imageRightPixels, 0, size_t( IMAGE_WIDTH ) * IMAGE_HEIGHT );
+        }
+
+        for ( uint32 body( 0u ); body < config.BodyCount; ++body )
+        {
+            if ( config.DropoutProbability > 0.0f &&
+                 uniform( noiseKey( config.Seed, device.serialNumber, index, body, 0u ) ) <
+                   config.DropoutProbability )
+            {
+                continue;
+            }
+
+            float64 t[ 3u ], r[ 3u ][ 3u ], n[ 3u ][ 3u ];
+            trajectory( config, body, seconds, t, r );
+            for ( uint32 i( 0u ); i < 3u; ++i )
+            {
+                t[ i ] += config.NoiseMM * gaussian( noiseKey( config.Seed, device.serialNumber, index, body, 1u + i ) );
+            }
+            rotationFromAngles( noiseRad * gaussian( noiseKey( config.Seed, device.serialNumber, index, body, 4u ) ),
+                                noiseRad * gaussian( noiseKey( config.Seed, device.serialNumber, index, body, 5u ) ),
+                                noiseRad * gaussian( noiseKey( config.Seed, device.serialNumber, index, body, 6u ) ),
+                                n );
+
+            ftkRigidBody geometry{};
+            if ( body < device.bodies.size() )
+            {
+                geometry = device.bodies[ body ];
+            }
+            else
+            {
+                geometry.geometryId = 1000u + body;
+                geometry.pointsCount = 4u;
+                const float64 square[ 4u ][ 2u ] = { { 0.0, 0.0 }, { 50.0, 0.0 }, { 50.0, 50.0 }, { 0.0, 75.0 } };
+                for ( uint32 i( 0u ); i < 4u; ++i )
+                {
+                    geometry.fiducials[ i ].position.x = floatXX( square[ i ][ 0u ] );
+                    geometry.fiducials[ i ].position.y = floatXX( square[ i ][ 1u ] );
+                    geometry.fiducials[ i ].position.z = 0;
+                }
+            }
+
+            float64 rotation[ 3u ][ 3u ];
+            for ( uint32 i( 0u ); i < 3u; ++i )
+            {
+                for ( uint32 j( 0u ); j < 3u; ++j )
+                {
+                    rotation[ i ][ j ] = r[ i ][ 0u ] * n[ 0u ][ j ] + r[ i ][ 1u ] * n[ 1u ][ j ] +
+                                         r[ i ][ 2u ] * n[ 2u ][ j ];
+                }
+            }
+
+            uint32 firstFiducial( fiducialsCount );
+            for ( uint32 p( 0u ); p < geometry.pointsCount && p < FTK_MAX_FIDUCIALS; ++p )
+            {
+                const ftk3DPoint& local( geometry.fiducials[ p ].position );
+                float64 world[ 3u ];
+                for ( uint32 i( 0u ); i < 3u; ++i )
+                {
+                    world[ i ] = rotation[ i ][ 0u ] * local.x + rotation[ i ][ 1u ] * local.y +
+                                 rotation[ i ][ 2u ] * local.z + t[ i ];
+                }
+                if ( pixels )
+                {
+                    // Crude pinhole projection, the right camera being 60 mm on
+                    // the right of the left one.
+                    const float64 v( IMAGE_HEIGHT * 0.5 + 1000.0 * world[ 1u ] / world[ 2u ] );
+                    drawFiducial( frame->imageLeftPixels, IMAGE_WIDTH * 0.5 + 1000.0 * world[ 0u ] / world[ 2u ], v );
+                    drawFiducial( frame->imageRightPixels,
+                                  IMAGE_WIDTH * 0.5 + 1000.0 * ( world[ 0u ] - 60.0 ) / world[ 2u ], v );
+                }
+                if ( frame->threeDFiducials == nullptr )
+                {
+                    continue;
+                }
+                if ( fiducialsCount == fiducialsCapacity )
+                {
+                    fiducialsOverflow = true;
+                    continue;
+                }
+                ftk3DFiducial& fiducial( frame->threeDFiducials[ fiducialsCount++ ] );
+                fiducial = ftk3DFiducial{};
+                fiducial.leftIndex = fiducialsCount - 1u;
+                fiducial.rightIndex = fiducialsCount - 1u;
+                fiducial.positionMM.x = floatXX( world[ 0u ] );
+                fiducial.positionMM.y = floatXX( world[ 1u ] );
+                fiducial.positionMM.z = floatXX( world[ 2u ] );
+                fiducial.epipolarErrorPixels = floatXX(
+                  0.1 * fabs( gaussian( noiseKey( config.Seed, device.serialNumber, index, body, 16u + p ) ) ) );
+                fiducial.triangulationErrorMM = floatXX( config.NoiseMM );
+                fiducial.probability = 1;
+            }
+
+            if ( frame->markers == nullptr )
+            {
+                continue;
+            }
+            if ( markersCount == markersCapacity )
+            {
+                markersOverflow = true;
+                continue;
+            }
+            ftkMarker& marker( frame->markers[ markersCount ] );
+            marker = ftkMarker{};
+            marker.id = markersCount++;
+            marker.geometryId = geometry.geometryId;
+            marker.geometryPresenceMask = ( 1u << min( geometry.pointsCount, 31u ) ) - 1u;
+            for ( uint32 p( 0u ); p < FTK_MAX_FIDUCIALS; ++p )
+            {
+                marker.fiducialCorresp[ p ] = p < geometry.pointsCount && firstFiducial + p < fiducialsCount
+                                                ? firstFiducial + p
+                                                : 0xFFFFFFFFu;
+            }
+            for ( uint32 i( 0u ); i < 3u; ++i )
+            {
+                marker.translationMM[ i ] = floatXX( t[ i ] );
+                for ( uint32 j( 0u ); j < 3u; ++j )
+                {
+                    marker.rotation[ i ][ j ] = floatXX( rotation[ i ][ j ] );
+                }
+            }
+            marker.registrationErrorMM = floatXX(
+              config.NoiseMM * fabs( gaussian( noiseKey( config.Seed, device.serialNumber, index, body, 7u ) ) ) );
+        }
+
+        frame->markersCount = markersCount;
+        frame->markersStat = frame->markers == nullptr
+                               ? ftkQueryStatus::QS_WAR_SKIPPED
+                               : ( markersOverflow ? ftkQueryStatus::QS_ERR_OVERFLOW : ftkQueryStatus::QS_OK );
+        frame->threeDFiducialsCount = fiducialsCount;
+        frame->threeDFiducialsStat =
+          frame->threeDFiducials == nullptr
+            ? ftkQueryStatus::QS_WAR_SKIPPED
+            : ( fiducialsOverflow ? ftkQueryStatus::QS_ERR_OVERFLOW : ftkQueryStatus::QS_OK );
+        frame->rawDataLeftCount = 0u;
+        frame->rawDataLeftStat = frame->rawDataLeft == nullptr ? ftkQueryStatus::QS_WAR_SKIPPED : ftkQueryStatus::QS_OK;
+        frame->rawDataRightCount = 0u;
+        frame->rawDataRightStat =
+          frame->rawDataRight == nullptr ? ftkQueryStatus::QS_WAR_SKIPPED : ftkQueryStatus::QS_OK;
+        frame->eventsCount = 0u;
+        frame->eventsStat = frame->events == nullptr ? ftkQueryStatus::QS_WAR_SKIPPED : ftkQueryStatus::QS_OK;
+        frame->imageLeftStat = pixels ? ftkQueryStatus::QS_OK : ftkQueryStatus::QS_WAR_SKIPPED;
+        frame->imageRightStat = pixels ? ftkQueryStatus::QS_OK : ftkQueryStatus::QS_WAR_SKIPPED;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Configuration
+
+void setSyntheticTrackerConfig( const SyntheticTrackerConfig& config )
+{
+    pendingConfig() = config;
+}
+
+bool loadSyntheticTrackerConfig( const string& path, SyntheticTrackerConfig& config )
+{
+    ifstream input( path );
+    if ( !input.is_open() )
+    {
+        return false;
+    }
+
+    string line;
+    while ( getline( input, line ) )
+    {
+        size_t first( line.find_first_not_of( " \t\r" ) );
+        if ( first == string::npos || line[ first ] == '#' )
+        {
+            continue;
+        }
+        size_t equal( line.find( '=' ) );
+        if ( equal == string::npos )
+        {
+            return false;
+        }
+        string key( line.substr( first, equal - first ) );
+        key.erase( key.find_last_not_of( " \t" ) + 1u );
+        istringstream value( line.substr( equal + 1u ) );
+        float64 number( 0.0 );
+        if ( !( value >> number ) )
+        {
+            return false;
+        }
+
+        if ( key == "DeviceCount" )
+        {
+            config.DeviceCount = uint32( number );
+        }
+        else if ( key == "FrameRateHz" )
+        {
+            config.FrameRateHz = uint32( number );
+        }
+        else if ( key == "BodyCount" )
+        {
+            config.BodyCount = uint32( number );
+        }
+        else if ( key == "Trajectory" )
+        {
+            config.Trajectory = SyntheticTrajectory( uint32( number ) );
+        }
+        else if ( key == "AmplitudeMM" )
+        {
+            config.AmplitudeMM = float32( number );
+        }
+        else if ( key == "FrequencyHz" )
+        {
+            config.FrequencyHz = float32( number );
+        }
+        else if ( key == "NoiseMM" )
+        {
+            config.NoiseMM = float32( number );
+        }
+        else if ( key == "NoiseDeg" )
+        {
+            config.NoiseDeg = float32( number );
+        }
+        else if ( key == "DropoutProbability" )
+        {
+            config.DropoutProbability = float32( number );
+        }
+        else if ( key == "Seed" )
+        {
+            config.Seed = uint32( number );
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Library and devices
+
+ftkLibrary ftkInit()
+{
+    ftkLibraryImp* lib( new ftkLibraryImp() );
+    lib->config = pendingConfig();
+    lib->version = 1u;
+    lib->dataDirectory = ".";
+    lib->lastError = int32( ftkError::FTK_OK );
+    for ( uint32 i( 0u ); i < lib->config.DeviceCount; ++i )
+    {
+        SyntheticDevice* device( new SyntheticDevice() );
+        device->serialNumber = FIRST_SERIAL_NUMBER + i;
+        device->started = false;
+        device->lastIndex = 0u;
+        device->lostFrames = 0u;
+        device->cachedVersion = 0u;
+        device->config = lib->config;
+        lib->devices.push_back( device );
+    }
+    return lib;
+}
+
+ftkLibrary ftkInitExt( const char* fileName, ftkBuffer* errs )
+{
+    if ( fileName != nullptr )
+    {
+        SyntheticTrackerConfig config( pendingConfig() );
+        if ( !loadSyntheticTrackerConfig( fileName, config ) )
+        {
+            if ( errs != nullptr )
+            {
+                errs->reset();
+                snprintf( errs->data, sizeof( errs->data ), "Cannot read synthetic configuration '%s'", fileName );
+                errs->size = uint32( strlen( errs->data ) + 1u );
+            }
+            return nullptr;
+        }
+        pendingConfig() = config;
+    }
+    return ftkInit();
+}
+
+ftkError ftkClose( ftkLibrary* lib )
+{
+    if ( lib == nullptr || *lib == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    for ( SyntheticDevice* device : ( *lib )->devices )
+    {
+        delete device;
+    }
+    delete *lib;
+    *lib = nullptr;
+    return ftkError::FTK_OK;
+}
+
+ftkError ftkEnumerateDevices( ftkLibrary lib, ftkDeviceEnumCallback cb, void* user )
+{
+    if ( lib == nullptr || cb == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    for ( SyntheticDevice* device : lib->devices )
+    {
+        cb( device->serialNumber, user, ftkDeviceType::DEV_SPRYTRACK_300 );
+    }
+    return ftkError::FTK_OK;
+}
+
+ftkError ftkGetLastErrorString( ftkLibrary lib, size_t strSize, char str[] )
+{
+    if ( lib == nullptr || str == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    ostringstream text;
+    {
+        lock_guard< mutex > guard( lib->lock );
+        text << "<ftkError>\n<errors>";
+        if ( lib->lastError > 0 )
+        {
+            text << lib->lastError << ": " << lib->lastMessage;
+        }
+        else
+        {
+            text << "No errors";
+        }
+        text << "</errors>\n<warnings>";
+        if ( lib->lastError < 0 )
+        {
+            text << lib->lastError << ": " << lib->lastMessage;
+        }
+        text << "</warnings>\n<messages />\n</ftkError>";
+    }
+    if ( strSize == 0u )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    const string result( text.str() );
+    strncpy( str, result.c_str(), strSize - 1u );
+    str[ strSize - 1u ] = '\0';
+    return ftkError::FTK_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Frames
+
+ftkFrameQuery* ftkCreateFrame()
+{
+    ftkFrameQuery* query( new ftkFrameQuery{} );
+    SyntheticFrame* storage( new SyntheticFrame() );
+    storage->header = ftkImageHeader{};
+    query->imageHeader = &storage->header;
+    query->imageHeaderStat = ftkQueryStatus::QS_OK;
+    lock_guard< mutex > guard( framesLock );
+    frames[ query ] = storage;
+    return query;
+}
+
+ftkError ftkDeleteFrame( ftkFrameQuery* frame )
+{
+    if ( frame == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    SyntheticFrame* storage( nullptr );
+    {
+        lock_guard< mutex > guard( framesLock );
+        map< ftkFrameQuery*, SyntheticFrame* >::iterator it( frames.find( frame ) );
+        if ( it == frames.end() )
+        {
+            return ftkError::FTK_ERR_INV_PTR;
+        }
+        storage = it->second;
+        frames.erase( it );
+    }
+    delete storage;
+    delete frame;
+    return ftkError::FTK_OK;
+}
+
+ftkError ftkSetFrameOptions( bool pixels, uint32 eventsSize, uint32 leftRawDataSize, uint32 rightRawDataSize,
+                             uint32 threeDFiducialsSize, uint32 markersSize, ftkFrameQuery* frame )
+{
+    if ( frame == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    SyntheticFrame* storage( nullptr );
+    {
+        lock_guard< mutex > guard( framesLock );
+        map< ftkFrameQuery*, SyntheticFrame* >::iterator it( frames.find( frame ) );
+        if ( it == frames.end() )
+        {
+            return ftkError::FTK_ERR_INV_PTR;
+        }
+        storage = it->second;
+    }
+
+    storage->events.assign( eventsSize, nullptr );
+    storage->rawLeft.assign( leftRawDataSize, ftkRawData{} );
+    storage->rawRight.assign( rightRawDataSize, ftkRawData{} );
+    storage->fiducials.assign( threeDFiducialsSize, ftk3DFiducial{} );
+    storage->markers.assign( markersSize, ftkMarker{} );
+    storage->left.assign( pixels ? size_t( IMAGE_WIDTH ) * IMAGE_HEIGHT : 0u, 0u );
+    storage->right.assign( pixels ? size_t( IMAGE_WIDTH ) * IMAGE_HEIGHT : 0u, 0u );
+
+    frame->events = eventsSize != 0u ? storage->events.data() : nullptr;
+    frame->eventsCount = 0u;
+    frame->eventsVersionSize.ReservedSize = eventsSize * uint32( sizeof( ftkEvent* ) );
+    frame->rawDataLeft = leftRawDataSize != 0u ? storage->rawLeft.data() : nullptr;
+    frame->rawDataLeftCount = 0u;
+    frame->rawDataLeftVersionSize.ReservedSize = leftRawDataSize * uint32( sizeof( ftkRawData ) );
+    frame->rawDataRight = rightRawDataSize != 0u ? storage->rawRight.data() : nullptr;
+    frame->rawDataRightCount = 0u;
+    frame->rawDataRightVersionSize.ReservedSize = rightRawDataSize * uint32( sizeof( ftkRawData ) );
+    frame->threeDFiducials = threeDFiducialsSize != 0u ? storage->fiducials.data() : nullptr;
+    frame->threeDFiducialsCount = 0u;
+    frame->threeDFiducialsVersionSize.ReservedSize = threeDFiducialsSize * uint32( sizeof( ftk3DFiducial ) );
+    frame->markers = markersSize != 0u ? storage->markers.data() : nullptr;
+    frame->markersCount = 0u;
+    frame->markersVersionSize.ReservedSize = markersSize * uint32( sizeof( ftkMarker ) );
+    frame->imageLeftPixels = pixels ? storage->left.data() : nullptr;
+    frame->imageLeftVersionSize.ReservedSize = uint32( storage->left.size() );
+    frame->imageRightPixels = pixels ? storage->right.data() : nullptr;
+    frame->imageRightVersionSize.ReservedSize = uint32( storage->right.size() );
+    storage->header.width = pixels ? IMAGE_WIDTH : 0u;
+    storage->header.height = pixels ? IMAGE_HEIGHT : 0u;
+    storage->header.imageStrideInBytes = pixels ? int32( IMAGE_WIDTH ) : 0;
+    storage->header.format = ftkPixelFormat::GRAY8;
+    return ftkError::FTK_OK;
+}
+
+ftkError ftkGetLastFrame( ftkLibrary lib, uint64 sn, ftkFrameQuery* frame, uint32 timeoutMS )
+{
+    if ( lib == nullptr || frame == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    SyntheticDevice* device( findDevice( lib, sn ) );
+    if ( device == nullptr )
+    {
+        return fail( lib, ftkError::FTK_ERR_INV_SN, "Unknown serial number" );
+    }
+
+    lock_guard< mutex > deviceGuard( device->lock );
+    {
+        lock_guard< mutex > guard( lib->lock );
+        if ( device->cachedVersion != lib->version )
+        {
+            device->bodies = lib->bodies;
+            device->cachedVersion = lib->version;
+        }
+    }
+
+    const chrono::steady_clock::time_point now( chrono::steady_clock::now() );
+    if ( !device->started )
+    {
+        device->start = now;
+        device->started = true;
+    }
+
+    uint64 index( 0u );
+    float64 seconds( 0.0 );
+    uint64 timestampUS( 0u );
+    if ( device->config.FrameRateHz == 0u )
+    {
+        index = device->lastIndex + 1u;
+        timestampUS = uint64( chrono::duration_cast< chrono::microseconds >( now - device->start ).count() );
+        seconds = float64( timestampUS ) * 1.0e-6;
+    }
+    else
+    {
+        const float64 periodUS( 1.0e6 / float64( device->config.FrameRateHz ) );
+        const float64 elapsedUS(
+          float64( chrono::duration_cast< chrono::nanoseconds >( now - device->start ).count() ) * 1.0e-3 );
+        index = uint64( elapsedUS / periodUS ) + 1u;
+        if ( index <= device->lastIndex )
+        {
+            index = device->lastIndex + 1u;
+            const chrono::steady_clock::time_point due(
+              device->start + chrono::nanoseconds( int64( float64( index - 1u ) * periodUS * 1.0e3 ) ) );
+            if ( due > now + chrono::milliseconds( timeoutMS ) )
+            {
+                waitUntil( now + chrono::milliseconds( timeoutMS ) );
+                return ftkError::FTK_WAR_NO_FRAME;
+            }
+            waitUntil( due );
+        }
+        seconds = float64( index - 1u ) * periodUS * 1.0e-6;
+        timestampUS = uint64( float64( index - 1u ) * periodUS );
+    }
+
+    if ( device->lastIndex != 0u && index > device->lastIndex + 1u )
+    {
+        device->lostFrames += index - device->lastIndex - 1u;
+    }
+    device->lastIndex = index;
+
+    if ( frame->imageHeader != nullptr )
+    {
+        frame->imageHeader->timestampUS = 1000000u + timestampUS;
+        frame->imageHeader->counter = uint32( index );
+        frame->imageHeaderStat = ftkQueryStatus::QS_OK;
+    }
+    fillFrame( *device, index, seconds, frame );
+    return ftkError::FTK_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Geometries
+
+ftkError ftkSetRigidBody( ftkLibrary lib, uint64 /* sn */, ftkRigidBody* geometryIn )
+{
+    if ( lib == nullptr || geometryIn == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    lock_guard< mutex > guard( lib->lock );
+    vector< ftkRigidBody >::iterator it( find_if( lib->bodies.begin(), lib->bodies.end(),
+                                                  [ geometryIn ]( const ftkRigidBody& body ) {
+                                                      return body.geometryId == geometryIn->geometryId;
+                                                  } ) );
+    if ( it != lib->bodies.end() )
+    {
+        *it = *geometryIn;
+    }
+    else
+    {
+        lib->bodies.push_back( *geometryIn );
+    }
+    ++lib->version;
+    return ftkError::FTK_OK;
+}
+
+ftkError ftkClearRigidBody( ftkLibrary lib, uint64 /* sn */, uint32 geometryId )
+{
+    if ( lib == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    lock_guard< mutex > guard( lib->lock );
+    lib->bodies.erase( remove_if( lib->bodies.begin(), lib->bodies.end(),
+                                  [ geometryId ]( const ftkRigidBody& body ) {
+                                      return body.geometryId == geometryId;
+                                  } ),
+                       lib->bodies.end() );
+    ++lib->version;
+    return ftkError::FTK_OK;
+}
+
+ftkError ftkLoadRigidBodyFromFile( ftkLibrary lib, const ftkBuffer* fileContent, ftkRigidBody* geometry )
+{
+    if ( lib == nullptr || fileContent == nullptr || geometry == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+
+    // Minimal reader of the INI geometry files: [geometry] count / id and
+    // [fiducialN] x / y / z.
+    istringstream input( string( fileContent->data, min( size_t( fileContent->size ), sizeof( fileContent->data ) ) ) );
+    *geometry = ftkRigidBody{};
+    string line, section;
+    bool hasId( false );
+    while ( getline( input, line ) )
+    {
+        line.erase( remove_if( line.begin(), line.end(), []( char c ) { return c == ' ' || c == '\t' || c == '\r'; } ),
+                    line.end() );
+        if ( line.empty() || line[ 0u ] == ';' || line[ 0u ] == '#' )
+        {
+            continue;
+        }
+        if ( line[ 0u ] == '[' )
+        {
+            section = line.substr( 1u, line.find( ']' ) - 1u );
+            continue;
+        }
+        size_t equal( line.find( '=' ) );
+        if ( equal == string::npos )
+        {
+            continue;
+        }
+        const string key( line.substr( 0u, equal ) );
+        const float64 value( atof( line.c_str() + equal + 1u ) );
+        if ( section == "geometry" )
+        {
+            if ( key == "count" )
+            {
+                geometry->pointsCount = min( uint32( value ), uint32( FTK_MAX_FIDUCIALS ) );
+            }
+            else if ( key == "id" )
+            {
+                geometry->geometryId = uint32( value );
+                hasId = true;
+            }
+        }
+        else if ( section.compare( 0u, 8u, "fiducial" ) == 0 )
+        {
+            const uint32 index( uint32( atoi( section.c_str() + 8u ) ) );
+            if ( index >= FTK_MAX_FIDUCIALS )
+            {
+                continue;
+            }
+            ftk3DPoint& point( geometry->fiducials[ index ].position );
+            if ( key == "x" )
+            {
+                point.x = floatXX( value );
+            }
+            else if ( key == "y" )
+            {
+                point.y = floatXX( value );
+            }
+            else if ( key == "z" )
+            {
+                point.z = floatXX( value );
+            }
+        }
+    }
+
+    if ( !hasId || geometry->pointsCount < 3u )
+    {
+        return fail( lib, ftkError::FTK_ERR_INV_INI_FILE, "Invalid geometry file" );
+    }
+    return ftkError::FTK_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Options
+
+ftkError ftkEnumerateOptions( ftkLibrary lib, uint64 sn, ftkOptionsEnumCallback cb, void* user )
+{
+    if ( lib == nullptr || cb == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    const bool globalOnly( sn == 0uLL );
+    if ( !globalOnly && findDevice( lib, sn ) == nullptr )
+    {
+        return fail( lib, ftkError::FTK_ERR_INV_SN, "Unknown serial number" );
+    }
+    for ( const OptionDefinition& option : OPTIONS )
+    {
+        if ( globalOnly != ( option.component == ftkComponent::FTK_LIBRARY ) )
+        {
+            continue;
+        }
+        ftkOptionsInfo info{};
+        info.id = option.id;
+        info.component = option.component;
+        info.type = option.type;
+        info.status.read = 1u;
+        info.status.write = option.write ? 1u : 0u;
+        info.name = option.name;
+        info.description = option.description;
+        info.unit = option.unit;
+        cb( sn, user, &info );
+    }
+    return globalOnly ? ftkError::FTK_WAR_OPT_GLOBAL_ONLY : ftkError::FTK_OK;
+}
+
+ftkError ftkGetInt32( ftkLibrary lib, uint64 sn, uint32 optID, int32* out, ftkOptionGetter what )
+{
+    if ( out == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    float64 value( 0.0 );
+    ftkError err( getOption( lib, sn, optID, what, ftkOptionType::FTK_INT32, value ) );
+    if ( err == ftkError::FTK_OK )
+    {
+        *out = int32( value );
+    }
+    return err;
+}
+
+ftkError ftkSetInt32( ftkLibrary lib, uint64 sn, uint32 optID, int32 val )
+{
+    return setOption( lib, sn, optID, ftkOptionType::FTK_INT32, float64( val ) );
+}
+
+ftkError ftkGetFloat32( ftkLibrary lib, uint64 sn, uint32 optID, float32* out, ftkOptionGetter what )
+{
+    if ( out == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    float64 value( 0.0 );
+    ftkError err( getOption( lib, sn, optID, what, ftkOptionType::FTK_FLOAT32, value ) );
+    if ( err == ftkError::FTK_OK )
+    {
+        *out = float32( value );
+    }
+    return err;
+}
+
+ftkError ftkSetFloat32( ftkLibrary lib, uint64 sn, uint32 optID, float32 val )
+{
+    return setOption( lib, sn, optID, ftkOptionType::FTK_FLOAT32, float64( val ) );
+}
+
+ftkError ftkGetData( ftkLibrary lib, uint64 /* sn */, uint32 optID, ftkBuffer* dataOut )
+{
+    if ( lib == nullptr || dataOut == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    if ( optID != OPT_DATA_DIR )
+    {
+        return fail( lib, ftkError::FTK_ERR_INV_OPT, "Unknown option" );
+    }
+    lock_guard< mutex > guard( lib->lock );
+    dataOut->reset();
+    strncpy( dataOut->data, lib->dataDirectory.c_str(), sizeof( dataOut->data ) - 1u );
+    dataOut->size = uint32( strlen( dataOut->data ) + 1u );
+    return ftkError::FTK_OK;
+}
+
+ftkError ftkSetData( ftkLibrary lib, uint64 /* sn */, uint32 /* optID */, ftkBuffer* dataIn )
+{
+    if ( lib == nullptr || dataIn == nullptr )
+    {
+        return ftkError::FTK_ERR_INV_PTR;
+    }
+    return fail( lib, ftkError::FTK_ERR_INV_OPT, "Read-only option" );
+}